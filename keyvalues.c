@@ -66,9 +66,67 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <ctype.h>
 #include <errno.h>
 #include <assert.h>
+#include <time.h>
+#include <limits.h>
+#include <locale.h>
 
 #include "keyvalues.h"
 
+/* Vectorized scanning on x86 */
+#if !defined(VDF_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define KV_USE_SSE2 1
+  #include <emmintrin.h>
+
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #endif
+
+  /* AVX2 functions are compiled separately and selected at runtime */
+  #if (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)) && (defined(__x86_64__) || defined(__i386__))
+    #define KV_USE_AVX2 1
+    #include <immintrin.h>
+  #endif
+#endif
+
+/* Open files using POSIX functions where available */
+#if defined(__unix__) || defined(__APPLE__)
+  #define KV_USE_POSIX_IO 1
+
+  #include <sys/types.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+
+  /* Map files into memory instead of reading them */
+  #ifndef VDF_NO_MMAP
+    #define KV_USE_MMAP 1
+    #include <sys/mman.h>
+  #endif
+
+  /* Load included files on worker threads */
+  #ifndef VDF_NO_THREADS
+    #define KV_USE_PTHREADS 1
+    #include <pthread.h>
+  #endif
+
+#elif defined(_WIN32)
+  /* Modification times of cached include files */
+  #include <sys/types.h>
+  #include <sys/stat.h>
+
+  /* Writing into file descriptors */
+  #include <io.h>
+#endif
+
+/* Separate error messages for each thread that may be parsing files */
+#if !defined(KV_USE_PTHREADS)
+  #define KV_THREAD_LOCAL
+#elif defined(__GNUC__) || defined(__clang__)
+  #define KV_THREAD_LOCAL __thread
+#else
+  #define KV_THREAD_LOCAL _Thread_local
+#endif
+
 #ifdef VDF_MANAGE_MEMORY
   void *(*KV_malloc)(size_t bytes)                = malloc;
   void *(*KV_calloc)(size_t ct, size_t elemSize)  = calloc;
@@ -95,19 +153,51 @@ KV_INLINE KV_bool IsPathStringAbsolute(const char *str) {
  * Key-value types
  *********************************************************************************************************************************/
 
+/* Pair storage flags */
+#define KV_PAIR_ARENA  0x01 /* The pair itself is allocated by a document and is freed together with it */
+#define KV_PAIR_KEYREF 0x02 /* The key string isn't owned by the pair and shouldn't be freed */
+#define KV_PAIR_STRREF 0x04 /* The string value isn't owned by the pair and shouldn't be freed */
+#define KV_PAIR_DIRTY  0x08 /* The document pair or some of its subpairs hold heap memory that needs to be freed */
+#define KV_PAIR_KEYSYM 0x10 /* The key string is interned in the symbol table, which implies KV_PAIR_KEYREF */
+#define KV_PAIR_LAZY   0x20 /* The list hasn't been parsed yet and only references its contents, see KV_ContextSetLazy() */
+#define KV_PAIR_POOL    0x40  /* The pair itself is allocated by a pool and is returned to it when destroyed */
+#define KV_PAIR_KEYPOOL 0x80  /* The key string is allocated by a pool, see KV_PoolCopyString() */
+#define KV_PAIR_STRPOOL 0x100 /* The string value is allocated by a pool, see KV_PoolCopyString() */
+
+typedef struct _KV_Index KV_Index;
+
 struct _KV_Pair {
   char *_key; /* Name of the key (NULL for a root pair) */
   KV_DataType _type; /* Data type of a stored value */
+  unsigned int _flags; /* Storage flags of the pair and its data */
 
   union {
     char *str; /* A single value as a string */
 
+    /* Typed values */
+    int i;
+    float f;
+    void *ptr;
+    KV_Color color;
+    KV_uint64 u64;
+
     /* A list of subpairs */
     struct {
       /* If there's only one subpair, both pointers reference the same one */
       KV_Pair *head;
       KV_Pair *tail;
+
+      size_t count; /* Amount of subpairs */
+      struct _KV_Index *index; /* Indices of subpairs in wide lists or NULL, see KV_SetIndexThreshold() */
     };
+
+    /* Unparsed contents of a list with KV_PAIR_LAZY */
+    struct {
+      const char *begin; /* First character after the opening brace */
+      size_t length; /* Amount of characters until the closing brace */
+      size_t line; /* Line that the contents begin on */
+      struct _KV_LazySource *source;
+    } lazy;
   } _value;
 
   KV_Pair *_parent; /* Pair that owns this subpair in a list */
@@ -115,87 +205,160 @@ struct _KV_Pair {
   KV_Pair *_next; /* Next neighboring pair or NULL for the tail */
 };
 
+/* Sets an empty list as the pair value without freeing the previous value */
+KV_INLINE void KV_InitList(KV_Pair *pair) {
+  pair->_value.head = pair->_value.tail = NULL;
+  pair->_value.count = 0;
+  pair->_value.index = NULL;
+};
+
+static KV_bool KV_ParseLazyList(KV_Pair *list);
+static void KV_ReleaseLazyList(KV_Pair *list);
+
+/* Parses contents of a lazy list before accessing its subpairs.
+ * Returns KV_false if the contents couldn't be parsed, in which case the list stays unparsed and its subpairs mustn't be
+ * accessed, so that it cannot be mistaken for an empty list and lose its contents when printed or saved.
+ */
+KV_INLINE KV_bool KV_EnsureParsed(KV_Pair *list) {
+  return (list->_flags & KV_PAIR_LAZY) ? KV_ParseLazyList(list) : KV_true;
+};
+
 /*********************************************************************************************************************************
  * Error handling
  *********************************************************************************************************************************/
 
-static char *_strError = NULL;
-static int _iErrorSet = 0; /* 0 - no; 1 - proper error; 2 - errno */
+static KV_THREAD_LOCAL KV_Error _error; /* Last set error */
+static KV_THREAD_LOCAL char _strError[KV_ERROR_PATH_LENGTH + 128]; /* Formatted message of the last error */
+
+/* Messages of all error codes */
+static const char *_astrErrorMessages[KV_ERROR_NUMCODES] = {
+  "No error",
+  "Unclosed string",
+  "Unexpected closing brace",
+  "Key already exists",
+  "Included key already exists",
+  "Cannot include file",
+  "Cannot open file for writing",
+  "Subpair has no key",
+  "Unknown value type",
+  "No pair or path specified",
+  "Cannot write printed contents",
+  "Unexpected end of binary contents",
+  "Unsupported binary value type",
+  "Invalid compiled image",
+  "Unsupported compiled image version",
+  "Compiled image checksum mismatch",
+  "Compiled image is too large",
+  "Invalid query path",
+};
 
 void KV_ResetError(void) {
-  if (_strError && _iErrorSet == 1) {
-    KV_free(_strError);
+  _error.code = KV_ERROR_NONE;
+  _error.errnum = 0;
+  _error.located = KV_false;
+  _error.line = 0;
+  _error.offset = (size_t)-1;
+  _error.file[0] = '\0';
+};
+
+/* Copies as much of a string as fits into a character buffer after 'len' characters.
+ * Returns the new length of the string in the buffer.
+ */
+KV_INLINE size_t KV_AppendErrorString(char *buffer, size_t size, size_t len, const char *str) {
+  while (*str && len + 1 < size) {
+    buffer[len++] = *str++;
   }
 
-  _strError = NULL;
-  _iErrorSet = 0;
+  buffer[len] = '\0';
+  return len;
 };
 
-/* Sets a last error message within specific context.
- * If 'ctx' is non-NULL, prepends the error message with the specified context line.
+/* Sets a last error within specific context without allocating any memory.
+ * If 'ctx' is non-NULL, remembers the context file and the specified context line.
  */
-KV_INLINE void KV_SetContextError(KV_Context *ctx, size_t iLine, const char *str) {
-  char *strLastError;
+KV_INLINE void KV_SetContextError(KV_Context *ctx, size_t iLine, KV_ErrorCode code, int errnum) {
   size_t ctLen;
 
-  assert(str);
+  KV_ResetError();
+  _error.code = code;
+  _error.errnum = errnum;
+
+  /* Generic error */
+  if (!ctx) return;
 
-  /* Remember the last proper error to free it at the end */
-  strLastError = (_iErrorSet == 1) ? _strError : NULL;
+  _error.located = KV_true;
+  _error.line = iLine;
 
-  /* Extra characters for extra text + null terminator */
-  ctLen = strlen(str) + 64;
+  /* Streams only keep the unparsed part of the contents */
+  if (ctx->_pch && !ctx->_stream) _error.offset = (size_t)(ctx->_pch - ctx->_buffer);
 
-  /* Current file path */
-  if (ctx) {
-    if (ctx->_directory) ctLen += strlen(ctx->_directory);
-    if (ctx->_file) ctLen += strlen(ctx->_file);
+  /* Character buffer */
+  if (!ctx->_file) return;
+
+  /* Disregard the directory if it's an empty string or the file path is absolute */
+  ctLen = 0;
+
+  if (*ctx->_directory && !IsPathStringAbsolute(ctx->_file)) {
+    ctLen = KV_AppendErrorString(_error.file, KV_ERROR_PATH_LENGTH, ctLen, ctx->_directory);
   }
 
-  _strError = (char *)KV_malloc(ctLen);
+  KV_AppendErrorString(_error.file, KV_ERROR_PATH_LENGTH, ctLen, ctx->_file);
+};
 
-  if (_strError) {
-    /* Within parser context */
-    if (ctx) {
-      /* File */
-      if (ctx->_file) {
-        /* Disregard the directory if it's an empty string or the file path is absolute */
-        if (!*ctx->_directory || IsPathStringAbsolute(ctx->_file)) {
-          sprintf(_strError, "\"%s\" at line %ld : %s", ctx->_file, iLine, str);
+/* Sets a generic last error.
+ */
+KV_INLINE void KV_SetError(KV_ErrorCode code, int errnum) {
+  KV_SetContextError(NULL, 0, code, errnum);
+};
 
-        } else {
-          sprintf(_strError, "\"%s%s\" at line %ld : %s", ctx->_directory, ctx->_file, iLine, str);
-        }
+size_t KV_FormatError(const KV_Error *error, char *buffer, size_t size) {
+  char strLine[48]; /* Enough for the longest line or offset */
+  size_t ctLen = 0;
 
-      /* Character buffer */
-      } else {
-        sprintf(_strError, "(buffer) at line %ld : %s", iLine, str);
-      }
+  assert(error && buffer && size);
 
-    /* Generic error */
+  /* Within parser context */
+  if (error->located) {
+    /* Binary contents have no lines */
+    if (error->line) {
+      sprintf(strLine, " at line %lu : ", (unsigned long)error->line);
     } else {
-      strcpy(_strError, str);
+      sprintf(strLine, " at byte %lu : ", (unsigned long)error->offset);
     }
-    _iErrorSet = 1;
 
-  /* malloc() failure */
-  } else {
-    _strError = strerror(errno);
-    _iErrorSet = 2;
+    /* File */
+    if (error->file[0]) {
+      ctLen = KV_AppendErrorString(buffer, size, ctLen, "\"");
+      ctLen = KV_AppendErrorString(buffer, size, ctLen, error->file);
+      ctLen = KV_AppendErrorString(buffer, size, ctLen, "\"");
+
+    /* Character buffer */
+    } else {
+      ctLen = KV_AppendErrorString(buffer, size, ctLen, "(buffer)");
+    }
+
+    ctLen = KV_AppendErrorString(buffer, size, ctLen, strLine);
   }
 
-  /* Free previous error string */
-  if (strLastError) KV_free(strLastError);
-};
+  assert(error->code < KV_ERROR_NUMCODES);
+  ctLen = KV_AppendErrorString(buffer, size, ctLen, _astrErrorMessages[error->code]);
 
-/* Sets a generic last error message.
- */
-KV_INLINE void KV_SetError(const char *str) {
-  KV_SetContextError(NULL, 0, str);
+  /* Describe the system error */
+  if (error->errnum) {
+    ctLen = KV_AppendErrorString(buffer, size, ctLen, ": ");
+    ctLen = KV_AppendErrorString(buffer, size, ctLen, strerror(error->errnum));
+  }
+
+  return ctLen;
 };
 
 const char *KV_GetError(void) {
-  return (_iErrorSet ? _strError : "No error");
+  KV_FormatError(&_error, _strError, sizeof(_strError));
+  return _strError;
+};
+
+const KV_Error *KV_GetLastError(void) {
+  return &_error;
 };
 
 /*********************************************************************************************************************************
@@ -229,45 +392,118 @@ void KV_PrinterResetString(KV_Printer *ctx) {
   ctx->_left = ctx->_length;
 };
 
-KV_INLINE KV_bool KV_PrinterExpandIfNeeded(KV_Printer *ctx) {
-  size_t iOffset;
+/* Makes sure that there's enough room for a specific amount of characters after the current position and a null terminator.
+ * The buffer grows at least twice in size each time, so appending to it takes amortized constant time.
+ */
+KV_INLINE void KV_PrinterReserve(KV_Printer *ctx, size_t ct) {
+  size_t iOffset, ctLength;
 
-  /* String has been written correctly, no need to expand */
-  if (ctx->_written >= 0 && (size_t)ctx->_written < ctx->_left)
-  {
-    ctx->_current += ctx->_written;
-    ctx->_left -= ctx->_written;
-    return KV_false;
-  }
+  if (ct < ctx->_left) return;
 
-  /* Expand the buffer */
   iOffset = ctx->_current - ctx->_buffer;
 
-  ctx->_length += ctx->_expansionstep;
+  ctLength = ctx->_length * 2;
+  if (ctLength < ctx->_length + ctx->_expansionstep) ctLength = ctx->_length + ctx->_expansionstep;
+  if (ctLength < iOffset + ct + 1) ctLength = iOffset + ct + 1;
+
+  ctx->_length = ctLength;
   ctx->_buffer = (char *)KV_realloc(ctx->_buffer, ctx->_length);
 
   ctx->_current = ctx->_buffer + iOffset;
   ctx->_left = ctx->_length - iOffset;
+};
 
-  return KV_true;
+/* Advances the current position after writing some characters into the buffer */
+KV_INLINE void KV_PrinterAdvance(KV_Printer *ctx, size_t ct) {
+  ctx->_current += ct;
+  ctx->_left -= ct;
+  *ctx->_current = '\0';
 };
 
 void KV_PrinterFormat(KV_Printer *ctx, const char *format, ...) {
   va_list arg;
-  va_start(arg, format);
 
-  do {
+  for (;;) {
+    /* Arguments are read anew each time because the list cannot be reused after vsnprintf() */
+    va_start(arg, format);
     ctx->_written = vsnprintf(ctx->_current, ctx->_left, format, arg);
-  } while (KV_PrinterExpandIfNeeded(ctx));
+    va_end(arg);
+
+    /* String has been written correctly */
+    if (ctx->_written >= 0 && (size_t)ctx->_written < ctx->_left) break;
+
+    /* Expand the buffer just enough or keep doubling it if the needed length is unknown */
+    KV_PrinterReserve(ctx, (ctx->_written >= 0) ? (size_t)ctx->_written : ctx->_left);
+  }
+
+  KV_PrinterAdvance(ctx, ctx->_written);
+};
+
+void KV_PrinterAppend(KV_Printer *ctx, const char *str, size_t length) {
+  KV_PrinterReserve(ctx, length);
+
+  memcpy(ctx->_current, str, length);
+  KV_PrinterAdvance(ctx, length);
+};
+
+void KV_PrinterAppendRepeated(KV_Printer *ctx, const char *str, size_t ct) {
+  size_t ctLen = strlen(str);
+  char *pch;
+
+  if (!ctLen) return;
+
+  KV_PrinterReserve(ctx, ctLen * ct);
+  pch = ctx->_current;
+
+  while (ct --> 0) {
+    memcpy(pch, str, ctLen);
+    pch += ctLen;
+  }
+
+  KV_PrinterAdvance(ctx, pch - ctx->_current);
+};
+
+void KV_PrinterAppendQuoted(KV_Printer *ctx, const char *str, KV_bool escapeseq) {
+  char *pch;
+
+  /* Every character may turn into an escape sequence, plus two quotes */
+  KV_PrinterReserve(ctx, strlen(str) * (escapeseq ? 2 : 1) + 2);
+
+  pch = ctx->_current;
+  *pch++ = '"';
+
+  if (escapeseq) {
+    for (; *str; ++str) {
+      switch (*str) {
+        case '\n': *pch++ = '\\'; *pch++ = 'n';  break;
+        case '\t': *pch++ = '\\'; *pch++ = 't';  break;
+        case '\r': *pch++ = '\\'; *pch++ = 'r';  break;
+        case '\b': *pch++ = '\\'; *pch++ = 'b';  break;
+        case '\f': *pch++ = '\\'; *pch++ = 'f';  break;
+        case '"':  *pch++ = '\\'; *pch++ = '"';  break;
+        case '\\': *pch++ = '\\'; *pch++ = '\\'; break;
+        default: *pch++ = *str; break;
+      }
+    }
 
-  va_end(arg);
+  } else {
+    while (*str) *pch++ = *str++;
+  }
+
+  *pch++ = '"';
+  KV_PrinterAdvance(ctx, pch - ctx->_current);
 };
 
 /*********************************************************************************************************************************
  * Parser context
  *********************************************************************************************************************************/
 
+static void KV_InitScanMode(void);
+
 void KV_ContextSetupBuffer(KV_Context *ctx, const char *directory, const char *buffer, size_t length) {
+  /* Parsing needs a scan mode, which is detected only once */
+  KV_InitScanMode();
+
   ctx->_directory = directory;
   ctx->_file = NULL;
   ctx->_buffer = buffer;
@@ -275,11 +511,27 @@ void KV_ContextSetupBuffer(KV_Context *ctx, const char *directory, const char *b
 
   ctx->_pch = buffer;
   ctx->_line = 1;
+  ctx->_stream = NULL;
 
   KV_ContextSetFlags(ctx, KV_true, KV_true, KV_true);
+  ctx->_insitu = KV_false;
+  ctx->_symbols = KV_false;
+  ctx->_types = KV_false;
+  ctx->_lazy = KV_false;
+  ctx->_source = NULL;
+  ctx->_document = NULL;
+  ctx->_pool = NULL;
+};
+
+void KV_ContextSetupInSitu(KV_Context *ctx, const char *directory, char *buffer, size_t length) {
+  KV_ContextSetupBuffer(ctx, directory, buffer, length);
+  ctx->_insitu = KV_true;
 };
 
 void KV_ContextSetupFile(KV_Context *ctx, const char *directory, const char *path) {
+  /* Parsing needs a scan mode, which is detected only once */
+  KV_InitScanMode();
+
   ctx->_directory = directory;
   ctx->_file = path;
   ctx->_buffer = NULL;
@@ -287,8 +539,16 @@ void KV_ContextSetupFile(KV_Context *ctx, const char *directory, const char *pat
 
   ctx->_pch = NULL;
   ctx->_line = 0;
+  ctx->_stream = NULL;
 
   KV_ContextSetFlags(ctx, KV_true, KV_true, KV_true);
+  ctx->_insitu = KV_false;
+  ctx->_symbols = KV_false;
+  ctx->_types = KV_false;
+  ctx->_lazy = KV_false;
+  ctx->_source = NULL;
+  ctx->_document = NULL;
+  ctx->_pool = NULL;
 };
 
 void KV_ContextSetFlags(KV_Context *ctx, KV_bool escapeseq, KV_bool multikey, KV_bool overwrite) {
@@ -301,6 +561,29 @@ void KV_ContextCopyFlags(KV_Context *ctx, KV_Context *other) {
   ctx->_escapeseq = other->_escapeseq;
   ctx->_multikey  = other->_multikey;
   ctx->_overwrite = other->_overwrite;
+  ctx->_symbols   = other->_symbols;
+  ctx->_types     = other->_types;
+  ctx->_lazy      = other->_lazy;
+};
+
+void KV_ContextSetSymbols(KV_Context *ctx, KV_bool symbols) {
+  ctx->_symbols = symbols;
+};
+
+void KV_ContextSetTypes(KV_Context *ctx, KV_bool types) {
+  ctx->_types = types;
+};
+
+void KV_ContextSetLazy(KV_Context *ctx, KV_bool lazy) {
+  ctx->_lazy = lazy;
+};
+
+void KV_ContextSetDocument(KV_Context *ctx, KV_Document *doc) {
+  ctx->_document = doc;
+};
+
+void KV_ContextSetPool(KV_Context *ctx, KV_Pool *pool) {
+  ctx->_pool = pool;
 };
 
 /* Check if the character buffer reached the end */
@@ -313,1292 +596,7183 @@ KV_INLINE KV_bool KV_ContextBufferEnded(KV_Context *ctx) {
 };
 
 /*********************************************************************************************************************************
- * One pair of key & value
+ * Character scanning
  *********************************************************************************************************************************/
 
-KV_Pair *KV_NewList(const char *key) {
-  /* Allocate the pair and reset its state */
-  KV_Pair *pair = (KV_Pair *)KV_malloc(sizeof(KV_Pair));
-
-  pair->_key = (key ? KV_strdup(key) : NULL);
-  pair->_type = KV_TYPE_NONE;
-  pair->_value.head = pair->_value.tail = NULL;
-
-  pair->_parent = NULL;
-  pair->_prev = pair->_next = NULL;
+/* Vectorized functions may read past the null character at the end of a buffer, but never across a page boundary */
+#ifdef __GNUC__
+  #define KV_NO_SANITIZE __attribute__((no_sanitize_address))
+  typedef size_t KV_Word __attribute__((__may_alias__));
+#else
+  #define KV_NO_SANITIZE
+  typedef size_t KV_Word;
+#endif
 
-  return pair;
-};
+/* Machine word with the same byte in every position */
+#define KV_WORD_ONES ((size_t)-1 / 0xFF)
+#define KV_WORD_BYTE(_Char) (KV_WORD_ONES * (unsigned char)(_Char))
 
-KV_Pair *KV_NewString(const char *key, const char *value) {
-  /* Allocate the pair and set new values */
-  KV_Pair *pair = (KV_Pair *)KV_malloc(sizeof(KV_Pair));
+/* Check if any byte in a machine word is zero */
+#define KV_WORD_HASZERO(_Word) (((_Word) - KV_WORD_ONES) & ~(_Word) & (KV_WORD_ONES * 0x80))
 
-  assert(value);
+/* Finds the first character in a buffer that matches any of the three specified characters.
+ * Returns pointer to the matched character or to the end of the buffer.
+ *
+ * pch - Character to start scanning from.
+ * pchEnd - End of a bounded buffer or NULL for scanning a null-terminated buffer until a null character.
+ */
+typedef const char *(*KV_ScanFunc)(const char *pch, const char *pchEnd, char c1, char c2, char c3);
 
-  pair->_key = (key ? KV_strdup(key) : NULL);
-  pair->_type = KV_TYPE_STRING;
-  pair->_value.str = KV_strdup(value);
+static const char *KV_ScanScalar(const char *pch, const char *pchEnd, char c1, char c2, char c3) {
+  if (pchEnd) {
+    for (; pch < pchEnd; ++pch) {
+      if (*pch == c1 || *pch == c2 || *pch == c3) break;
+    }
 
-  pair->_parent = NULL;
-  pair->_prev = pair->_next = NULL;
+  } else {
+    for (; *pch; ++pch) {
+      if (*pch == c1 || *pch == c2 || *pch == c3) break;
+    }
+  }
 
-  return pair;
+  return pch;
 };
 
-KV_Pair *KV_NewListFrom(const char *key, KV_Pair *list) {
-  /* Allocate the pair and set new values */
-  KV_Pair *pair = (KV_Pair *)KV_malloc(sizeof(KV_Pair));
+KV_NO_SANITIZE static const char *KV_ScanSWAR(const char *pch, const char *pchEnd, char c1, char c2, char c3) {
+  const size_t w1 = KV_WORD_BYTE(c1);
+  const size_t w2 = KV_WORD_BYTE(c2);
+  const size_t w3 = KV_WORD_BYTE(c3);
 
-  assert(list);
+  const KV_Word *pWord;
+  size_t word;
 
-  pair->_key = (key ? KV_strdup(key) : NULL);
-  pair->_type = KV_TYPE_NONE;
-  pair->_value.head = pair->_value.tail = NULL;
-  KV_CopyNodes(pair, list, KV_false);
+  /* Check characters one by one until the next aligned word */
+  for (; (size_t)pch & (sizeof(size_t) - 1); ++pch) {
+    if (pchEnd ? pch >= pchEnd : !*pch) return pch;
+    if (*pch == c1 || *pch == c2 || *pch == c3) return pch;
+  }
 
-  pair->_parent = NULL;
-  pair->_prev = pair->_next = NULL;
+  /* Check whole words until any of them has a match */
+  for (pWord = (const KV_Word *)pch;; ++pWord) {
+    if (pchEnd && (size_t)(pchEnd - (const char *)pWord) < sizeof(size_t)) break;
 
-  return pair;
-};
+    word = *pWord;
+    if (KV_WORD_HASZERO(word ^ w1) || KV_WORD_HASZERO(word ^ w2) || KV_WORD_HASZERO(word ^ w3)) break;
+    if (!pchEnd && KV_WORD_HASZERO(word)) break;
+  }
 
-/* Free memory of the pair key without resetting the field */
-KV_INLINE void KV_FreeKey(KV_Pair *pair) {
-  if (pair->_key) KV_free(pair->_key);
+  /* Find the exact character within the last word */
+  return KV_ScanScalar((const char *)pWord, pchEnd, c1, c2, c3);
 };
 
-/* Free all memory associated with the pair value without resetting any fields */
-KV_INLINE void KV_FreeValue(KV_Pair *pair) {
-  KV_Pair *pairDestroy;
-  KV_Pair *pairIter;
+#ifdef KV_USE_SSE2
 
-  /* Destroy value */
-  switch (pair->_type) {
-    case KV_TYPE_NONE:
-      pairIter = pair->_value.head;
+/* Returns index of the lowest set bit in a non-zero mask */
+KV_INLINE unsigned int KV_LowestBit(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanForward(&i, mask);
+  return (unsigned int)i;
+#else
+  return (unsigned int)__builtin_ctz(mask);
+#endif
+};
 
-      /* Destroy all pairs */
-      while (pairIter) {
-        pairDestroy = pairIter;
-        pairIter = pairIter->_next;
+KV_NO_SANITIZE static const char *KV_ScanSSE2(const char *pch, const char *pchEnd, char c1, char c2, char c3) {
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  const __m128i v3 = _mm_set1_epi8(c3);
 
-        KV_PairDestroy(pairDestroy);
-      }
-      break;
+  __m128i chunk;
+  unsigned int mask;
+  size_t iOffset;
 
-    case KV_TYPE_STRING:
-      KV_free(pair->_value.str);
-      break;
+  if (pchEnd) {
+    /* Check unaligned chunks within the buffer */
+    for (; pchEnd - pch >= 16; pch += 16) {
+      chunk = _mm_loadu_si128((const __m128i *)pch);
+      mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1), _mm_cmpeq_epi8(chunk, v2)),
+        _mm_cmpeq_epi8(chunk, v3)));
 
-    default:
-      assert(!"Unknown value type");
-      break;
+      if (mask) return pch + KV_LowestBit(mask);
+    }
+
+    return KV_ScanSWAR(pch, pchEnd, c1, c2, c3);
   }
-};
 
-void KV_PairDestroy(KV_Pair *pair) {
-  assert(pair);
+  /* Start from the aligned chunk and disregard characters before the first one */
+  iOffset = (size_t)pch & 15;
+  pch -= iOffset;
 
-  /* Unlink the pair */
-  KV_Expunge(pair);
+  chunk = _mm_load_si128((const __m128i *)pch);
+  mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1), _mm_cmpeq_epi8(chunk, v2)),
+    _mm_or_si128(_mm_cmpeq_epi8(chunk, v3), _mm_cmpeq_epi8(chunk, _mm_setzero_si128()))));
+  mask &= ~0U << iOffset;
 
-  /* Clear the pair and free it */
-  KV_FreeKey(pair);
-  KV_FreeValue(pair);
-  KV_free(pair);
+  while (!mask) {
+    pch += 16;
+    chunk = _mm_load_si128((const __m128i *)pch);
+    mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1), _mm_cmpeq_epi8(chunk, v2)),
+      _mm_or_si128(_mm_cmpeq_epi8(chunk, v3), _mm_cmpeq_epi8(chunk, _mm_setzero_si128()))));
+  }
+
+  return pch + KV_LowestBit(mask);
 };
 
-KV_Pair *KV_PairCopy(KV_Pair *other) {
-  KV_Pair *pair = (KV_Pair *)KV_malloc(sizeof(KV_Pair));
+#endif /* KV_USE_SSE2 */
 
-  assert(other);
+#ifdef KV_USE_AVX2
 
-  pair->_key = KV_strdup(other->_key);
-  pair->_type = other->_type;
+KV_NO_SANITIZE __attribute__((target("avx2")))
+static const char *KV_ScanAVX2(const char *pch, const char *pchEnd, char c1, char c2, char c3) {
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  const __m256i v3 = _mm256_set1_epi8(c3);
 
-  switch (pair->_type) {
-    case KV_TYPE_NONE:
-      pair->_value.head = pair->_value.tail = NULL;
-      KV_CopyNodes(pair, other, KV_false);
-      break;
+  __m256i chunk;
+  unsigned int mask;
+  size_t iOffset;
 
-    case KV_TYPE_STRING:
-      pair->_value.str = KV_strdup(other->_value.str);
-      break;
+  if (pchEnd) {
+    /* Check unaligned chunks within the buffer */
+    for (; pchEnd - pch >= 32; pch += 32) {
+      chunk = _mm256_loadu_si256((const __m256i *)pch);
+      mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, v1),
+        _mm256_cmpeq_epi8(chunk, v2)), _mm256_cmpeq_epi8(chunk, v3)));
 
-    default:
-      assert(!"Unknown value type");
-      pair->_type = KV_TYPE_NONE;
-      pair->_value.head = pair->_value.tail = NULL;
-      break;
+      if (mask) return pch + KV_LowestBit(mask);
+    }
+
+    return KV_ScanSSE2(pch, pchEnd, c1, c2, c3);
   }
 
-  pair->_parent = NULL;
-  pair->_prev = pair->_next = NULL;
+  /* Start from the aligned chunk and disregard characters before the first one */
+  iOffset = (size_t)pch & 31;
+  pch -= iOffset;
 
-  return pair;
+  chunk = _mm256_load_si256((const __m256i *)pch);
+  mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, v1),
+    _mm256_cmpeq_epi8(chunk, v2)), _mm256_or_si256(_mm256_cmpeq_epi8(chunk, v3), _mm256_cmpeq_epi8(chunk, _mm256_setzero_si256()))));
+  mask &= ~0U << iOffset;
+
+  while (!mask) {
+    pch += 32;
+    chunk = _mm256_load_si256((const __m256i *)pch);
+    mask = (unsigned int)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, v1),
+      _mm256_cmpeq_epi8(chunk, v2)), _mm256_or_si256(_mm256_cmpeq_epi8(chunk, v3), _mm256_cmpeq_epi8(chunk, _mm256_setzero_si256()))));
+  }
+
+  return pch + KV_LowestBit(mask);
 };
 
-void KV_PairClear(KV_Pair *pair) {
-  assert(pair);
+#endif /* KV_USE_AVX2 */
 
-  /* Free all memory */
-  KV_FreeKey(pair);
-  KV_FreeValue(pair);
+static KV_ScanFunc _pfnScan = NULL; /* Selected once before the first context is set up */
+static KV_ScanMode _eScanMode = KV_SCAN_AUTO;
 
-  /* Reset the pair state but preserve the neighboring connections */
-  pair->_key = NULL;
-  pair->_type = KV_TYPE_NONE;
-  pair->_value.head = pair->_value.tail = NULL;
-};
+#ifdef KV_USE_PTHREADS
+  static pthread_once_t _onceScanMode = PTHREAD_ONCE_INIT;
+#endif
 
-void KV_SetKey(KV_Pair *pair, const char *key) {
-  char *keyCopy;
+/* Returns the scan function for a specific mode or NULL if the mode isn't supported by the compiler or the CPU */
+static KV_ScanFunc KV_GetScanFunc(KV_ScanMode mode) {
+  switch (mode) {
+    case KV_SCAN_SCALAR: return KV_ScanScalar;
+    case KV_SCAN_SWAR:   return KV_ScanSWAR;
 
-  assert(pair);
+  #ifdef KV_USE_SSE2
+    case KV_SCAN_SSE2: return KV_ScanSSE2;
+  #endif
 
-  /* Root pair */
-  if (!key) {
-    KV_FreeKey(pair);
-    pair->_key = NULL;
-    return;
+  #ifdef KV_USE_AVX2
+    case KV_SCAN_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? KV_ScanAVX2 : NULL;
+  #endif
+
+    default: return NULL;
   }
+};
 
-  /* Copy the string beforehand in case it is the same */
-  keyCopy = KV_strdup(key);
+/* Returns the fastest supported mode */
+static KV_ScanMode KV_GetAutoScanMode(void) {
+#if defined(KV_USE_AVX2)
+  return KV_GetScanFunc(KV_SCAN_AVX2) ? KV_SCAN_AVX2 : KV_SCAN_SSE2;
+#elif defined(KV_USE_SSE2)
+  return KV_SCAN_SSE2;
+#else
+  return KV_SCAN_SWAR;
+#endif
+};
 
-  KV_FreeKey(pair);
-  pair->_key = keyCopy;
+static void KV_DetectScanMode(void) {
+  _eScanMode = KV_GetAutoScanMode();
+  _pfnScan = KV_GetScanFunc(_eScanMode);
 };
 
-void KV_SetString(KV_Pair *pair, const char *value) {
-  char *valueCopy;
+/* Detects the scan mode exactly once, even if several threads set up their contexts at the same time */
+static void KV_InitScanMode(void) {
+#ifdef KV_USE_PTHREADS
+  pthread_once(&_onceScanMode, KV_DetectScanMode);
+#else
+  if (!_pfnScan) KV_DetectScanMode();
+#endif
+};
 
-  assert(pair && value);
+KV_bool KV_SetScanMode(KV_ScanMode mode) {
+  KV_ScanFunc pfn;
 
-  /* Copy the string beforehand in case it is the same, otherwise the data is wiped before KV_strdup() */
-  valueCopy = KV_strdup(value);
+  /* Detect the default mode now so it doesn't replace the selected one later */
+  KV_InitScanMode();
 
-  /* Clear last pair before setting a new one */
-  KV_FreeValue(pair);
+  if (mode == KV_SCAN_AUTO) mode = KV_GetAutoScanMode();
 
-  pair->_type = KV_TYPE_STRING;
-  pair->_value.str = valueCopy;
+  pfn = KV_GetScanFunc(mode);
+  if (!pfn) return KV_false;
+
+  _pfnScan = pfn;
+  _eScanMode = mode;
+  return KV_true;
 };
 
-void KV_SetListFrom(KV_Pair *pair, KV_Pair *list) {
-  assert(pair && list);
+KV_ScanMode KV_GetScanMode(void) {
+  KV_InitScanMode();
+  return _eScanMode;
+};
 
-  /* Clear last pair before setting a new one */
-  KV_FreeValue(pair);
+/* Finds the first character in the parsed buffer that matches any of the three specified characters.
+ * Returns pointer to the matched character or to the end of the buffer.
+ */
+KV_INLINE const char *KV_ContextScan(KV_Context *ctx, char c1, char c2, char c3) {
+  return _pfnScan(ctx->_pch, (ctx->_length == (size_t)-1) ? NULL : ctx->_buffer + ctx->_length, c1, c2, c3);
+};
 
-  pair->_type = KV_TYPE_NONE;
-  pair->_value.head = pair->_value.tail = NULL;
-  KV_CopyNodes(pair, list, KV_false);
+/*********************************************************************************************************************************
+ * Documents
+ *********************************************************************************************************************************/
+
+/* Default amount of bytes in each document block */
+#define KV_DOCUMENT_BLOCKSIZE 65536
+
+/* Used for determining the strictest alignment of pairs */
+typedef union _KV_MaxAlign {
+  void *p;
+  size_t s;
+  double d;
+} KV_MaxAlign;
+
+#define KV_ALIGN sizeof(KV_MaxAlign)
+#define KV_ALIGNED(_Size) (((_Size) + KV_ALIGN - 1) & ~(KV_ALIGN - 1))
+
+/* One block of memory in a document, right after which goes the allocated data */
+typedef struct _KV_Block {
+  struct _KV_Block *next;
+  size_t size; /* Amount of bytes available for allocation */
+  size_t used; /* Amount of bytes that have already been allocated */
+} KV_Block;
+
+#define KV_BLOCK_DATA(_Block) ((char *)(_Block) + KV_ALIGNED(sizeof(KV_Block)))
+
+/* List that has been parsed within a document and may hold heap memory that needs to be freed */
+typedef struct _KV_DocumentRoot {
+  KV_Pair *pair;
+  struct _KV_DocumentRoot *next;
+} KV_DocumentRoot;
+
+struct _KV_Document {
+  KV_Block *_blocks; /* Block that's currently being filled, followed by all the previous ones */
+  size_t _blocksize;
+  KV_DocumentRoot *_roots;
 };
 
-void KV_CopyNodes(KV_Pair *list, KV_Pair *other, KV_bool overwrite) {
-  KV_Pair *pairIter, *pairFind;
-  assert(list && other);
-
-  /* Set an entirely new list if the current value isn't a list */
-  if (list->_type != KV_TYPE_NONE) {
-    KV_FreeValue(list);
-
-    list->_type = KV_TYPE_NONE;
-    list->_value.head = list->_value.tail = NULL;
-  }
+KV_Document *KV_NewDocument(size_t blocksize) {
+  KV_Document *doc = (KV_Document *)KV_malloc(sizeof(KV_Document));
 
-  /* Add copies of all subpairs to this list */
-  for (pairIter = other->_value.head; pairIter; pairIter = pairIter->_next)
-  {
-    /* Replace duplicate keys */
-    if (overwrite && (pairFind = KV_FindPair(list, pairIter->_key))) {
-      KV_Replace(pairFind, pairIter);
-      continue;
-    }
+  doc->_blocks = NULL;
+  doc->_blocksize = (blocksize ? blocksize : KV_DOCUMENT_BLOCKSIZE);
+  doc->_roots = NULL;
 
-    KV_AddTail(list, KV_PairCopy(pairIter));
-  }
+  return doc;
 };
 
-void KV_MergeNodes(KV_Pair *list, KV_Pair *other, KV_bool moveNodes) {
-  KV_Pair *pairIter, *pairFind;
-  assert(list && other);
+/* Allocates a new empty block of memory */
+KV_INLINE KV_Block *KV_NewBlock(size_t size) {
+  KV_Block *block = (KV_Block *)KV_malloc(KV_ALIGNED(sizeof(KV_Block)) + size);
 
-  /* Both must be lists */
-  if (list->_type != KV_TYPE_NONE || other->_type != KV_TYPE_NONE) return;
+  block->next = NULL;
+  block->size = size;
+  block->used = 0;
 
-  /* Add copies of non-existent subpairs to this list */
-  pairIter = other->_value.head;
+  return block;
+};
 
-  while (pairIter) {
-    /* Recursively merge existing subpairs */
-    if ((pairFind = KV_FindPair(list, pairIter->_key))) {
-      KV_MergeNodes(pairFind, pairIter, moveNodes);
+/* Allocates memory from a document that remains valid until the document itself is destroyed.
+ * 'align' must be either 1 for strings or KV_ALIGN for anything else.
+ */
+static void *KV_DocumentAlloc(KV_Document *doc, size_t size, size_t align) {
+  KV_Block *block = doc->_blocks;
+  KV_Block *blockNew;
+  size_t iOffset;
 
-      /* Get the next subpair */
-      pairIter = pairIter->_next;
-      continue;
+  /* Fit in the current block */
+  if (block) {
+    iOffset = (block->used + align - 1) & ~(align - 1);
+
+    if (iOffset + size <= block->size) {
+      block->used = iOffset + size;
+      return KV_BLOCK_DATA(block) + iOffset;
     }
+  }
 
-    /* Remember the current subpair and get the next one */
-    pairFind = pairIter;
-    pairIter = pairIter->_next;
+  /* Big chunks of memory get their own blocks, which go after the current one to keep filling it */
+  if (size > doc->_blocksize / 4) {
+    blockNew = KV_NewBlock(size);
+    blockNew->used = size;
 
-    /* Move that subpair over to the current list instead of copying it */
-    if (moveNodes) {
-      KV_AddTail(list, pairFind);
+    if (block) {
+      blockNew->next = block->next;
+      block->next = blockNew;
     } else {
-      KV_AddTail(list, KV_PairCopy(pairFind));
+      doc->_blocks = blockNew;
     }
-  }
-};
 
-void KV_Replace(KV_Pair *pair, KV_Pair *other) {
-  assert(pair && other);
-  if (pair == other) return;
+    return KV_BLOCK_DATA(blockNew);
+  }
 
-  /* Clear last value before setting a new one */
-  KV_FreeValue(pair);
+  /* Start filling a new block */
+  blockNew = KV_NewBlock(doc->_blocksize);
+  blockNew->next = block;
+  blockNew->used = size;
 
-  pair->_type = other->_type;
+  doc->_blocks = blockNew;
+  return KV_BLOCK_DATA(blockNew);
+};
 
-  switch (pair->_type) {
-    case KV_TYPE_NONE:
-      pair->_value.head = pair->_value.tail = NULL;
-      KV_CopyNodes(pair, other, KV_false);
-      break;
+/* Allocates a new pair from a document and resets its state to an empty list under a NULL key */
+KV_INLINE KV_Pair *KV_DocumentNewPair(KV_Document *doc) {
+  KV_Pair *pair = (KV_Pair *)KV_DocumentAlloc(doc, sizeof(KV_Pair), KV_ALIGN);
 
-    case KV_TYPE_STRING:
-      pair->_value.str = KV_strdup(other->_value.str);
-      break;
+  pair->_key = NULL;
+  pair->_type = KV_TYPE_NONE;
+  pair->_flags = KV_PAIR_ARENA;
+  KV_InitList(pair);
 
-    default:
-      assert(!"Unknown value type");
-      pair->_type = KV_TYPE_NONE;
-      pair->_value.head = pair->_value.tail = NULL;
-      break;
-  }
-};
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
 
-/* Swap all struct data between two different pairs */
-KV_INLINE void KV_SwapWholePairs(KV_Pair *pair1, KV_Pair *pair2) {
-  KV_Pair temp = *pair1;
-  *pair1 = *pair2;
-  *pair2 = temp;
+  return pair;
 };
 
-void KV_Swap(KV_Pair *pair1, KV_Pair *pair2) {
-  KV_Pair *parent1, *parent2;
-  KV_Pair *prev1, *prev2;
-  KV_Pair *next1, *next2;
+/* Remembers a list that has been parsed within a document */
+KV_INLINE void KV_DocumentAddRoot(KV_Document *doc, KV_Pair *list) {
+  KV_DocumentRoot *root = (KV_DocumentRoot *)KV_DocumentAlloc(doc, sizeof(KV_DocumentRoot), KV_ALIGN);
 
-  assert(pair1 && pair2);
-  if (pair1 == pair2) return;
+  root->pair = list;
+  root->next = doc->_roots;
+  doc->_roots = root;
+};
 
-  /* Remember the neighbors */
-  parent1 = pair1->_parent;
-  prev1 = pair1->_prev;
-  next1 = pair1->_next;
+/* Copies a null-terminated string into a document */
+KV_INLINE char *KV_DocumentCopyString(KV_Document *doc, const char *str) {
+  size_t size = strlen(str) + 1;
+  char *strNew = (char *)KV_DocumentAlloc(doc, size, 1);
 
-  parent2 = pair2->_parent;
-  prev2 = pair2->_prev;
-  next2 = pair2->_next;
+  memcpy(strNew, str, size);
+  return strNew;
+};
 
-  /* Swap the values */
-  KV_SwapWholePairs(pair1, pair2);
+/* Returns the amount of memory allocated by a document */
+KV_INLINE size_t KV_DocumentSize(const KV_Document *doc) {
+  const KV_Block *block;
+  size_t size = sizeof(KV_Document);
 
-  /* Restore the neighbors */
-  pair1->_parent = parent1;
-  pair1->_prev = prev1;
-  pair1->_next = next1;
+  for (block = doc->_blocks; block; block = block->next) {
+    size += KV_ALIGNED(sizeof(KV_Block)) + block->size;
+  }
 
-  pair2->_parent = parent2;
-  pair2->_prev = prev2;
-  pair2->_next = next2;
+  return size;
 };
 
-/* IMPORTANT: Returned pointer needs to be manually freed! */
-KV_INLINE char *KV_ConvertEscapeSeq(char *pch) {
-  char *str;
-  size_t i;
+#ifdef KV_USE_PTHREADS
 
-  str = (char *)KV_calloc(strlen(pch) * 2 + 1, sizeof(char));
-  i = 0;
+/* Moves all memory from one document into another and destroys the former */
+KV_INLINE void KV_DocumentAdopt(KV_Document *doc, KV_Document *docOther) {
+  KV_Block *block = docOther->_blocks;
+  KV_DocumentRoot *root = docOther->_roots;
 
-  while (*pch) {
-    switch (*pch) {
-      case '\n': str[i++] = '\\'; str[i++] = 'n';  break;
-      case '\t': str[i++] = '\\'; str[i++] = 't';  break;
-      case '\r': str[i++] = '\\'; str[i++] = 'r';  break;
-      case '\b': str[i++] = '\\'; str[i++] = 'b';  break;
-      case '\f': str[i++] = '\\'; str[i++] = 'f';  break;
-      case '"':  str[i++] = '\\'; str[i++] = '"';  break;
-      case '\\': str[i++] = '\\'; str[i++] = '\\'; break;
-      default: str[i++] = *pch; break;
+  /* Previous blocks of the other document go after the current one to keep filling it */
+  if (block) {
+    while (block->next) block = block->next;
+
+    if (doc->_blocks) {
+      block->next = doc->_blocks->next;
+      doc->_blocks->next = docOther->_blocks;
+    } else {
+      doc->_blocks = docOther->_blocks;
     }
+  }
 
-    ++pch;
+  /* Lists of the other document are remembered in its blocks */
+  if (root) {
+    while (root->next) root = root->next;
+
+    root->next = doc->_roots;
+    doc->_roots = docOther->_roots;
   }
 
-  return str;
+  KV_free(docOther);
 };
 
-static KV_bool KV_PrintInternal(KV_Pair *pair, KV_Printer *ctx, size_t depth, const char *indentation) {
-  KV_bool bValueAfterKey;
-  char *strIndent;
-  size_t ct;
-  KV_Pair *pairIter;
-  char *strValue;
+#endif
 
-  assert(pair);
+/* Marks document pairs up the hierarchy as the ones that hold heap memory */
+KV_INLINE void KV_MarkDirty(KV_Pair *pair) {
+  while (pair && (pair->_flags & (KV_PAIR_ARENA | KV_PAIR_DIRTY)) == KV_PAIR_ARENA) {
+    pair->_flags |= KV_PAIR_DIRTY;
+    pair = pair->_parent;
+  }
+};
 
-  bValueAfterKey = (pair->_key ? KV_true : KV_false);
+static void KV_DocumentRelease(KV_Pair *pair);
 
-  /* If this is a subpair */
-  if (bValueAfterKey) {
-    /* Create extra indentation */
-    strIndent = (char *)KV_calloc(depth * strlen(indentation) + 1, sizeof(char));
-    ct = depth;
+void KV_DocumentDestroy(KV_Document *doc) {
+  KV_DocumentRoot *root;
+  KV_Block *block;
 
-    while (ct --> 0) {
-      strcat(strIndent, indentation);
-    }
+  assert(doc);
 
-    /* Advance the depth */
-    ++depth;
+  /* Free heap memory that has been added to the parsed lists after parsing */
+  for (root = doc->_roots; root; root = root->next) {
+    if (root->pair->_flags & KV_PAIR_DIRTY) KV_DocumentRelease(root->pair);
+  }
 
-  /* If there's no key and it's a list (a root pair) */
-  } else if (pair->_type == KV_TYPE_NONE) {
-    /* Create empty indentation for subpairs */
-    strIndent = (char *)KV_calloc(1, sizeof(char));
+  /* Free all blocks at once */
+  while (doc->_blocks) {
+    block = doc->_blocks;
+    doc->_blocks = block->next;
 
-  /* Otherwise the value without key cannot be printed */
-  } else {
-    KV_SetError("Subpair has no key");
-    return KV_false;
+    KV_free(block);
   }
 
-  /* Print a key */
-  if (bValueAfterKey) KV_PrinterFormat(ctx, "%s\"%s\"", strIndent, pair->_key);
+  KV_free(doc);
+};
 
-  /* Print a value */
-  switch (pair->_type) {
-    case KV_TYPE_NONE: {
-      if (bValueAfterKey) KV_PrinterFormat(ctx, "\n%s{\n", strIndent);
-
-      /* Print each pair in the list */
-      for (pairIter = pair->_value.head; pairIter; pairIter = pairIter->_next)
-      {
-        if (!KV_PrintInternal(pairIter, ctx, depth, indentation)) {
-          KV_free(strIndent);
-          return KV_false;
-        }
-      }
+/*********************************************************************************************************************************
+ * Pools
+ *********************************************************************************************************************************/
 
-      if (bValueAfterKey) KV_PrinterFormat(ctx, "%s}\n", strIndent);
+/* Default amount of bytes in each pool block */
+#define KV_POOL_BLOCKSIZE 65536
+
+/* Header of each pair or string allocated by a pool, right after which goes its data */
+typedef union _KV_PoolItem {
+  union _KV_PoolItem **list; /* List of freed items of the same size that the item is returned to */
+  union _KV_PoolItem *next; /* Next freed item of the same size */
+  KV_MaxAlign align;
+} KV_PoolItem;
+
+#define KV_POOL_HEADER KV_ALIGNED(sizeof(KV_PoolItem))
+#define KV_POOL_DATA(_Item) ((char *)(_Item) + KV_POOL_HEADER)
+#define KV_POOL_ITEM(_Data) ((KV_PoolItem *)((char *)(_Data) - KV_POOL_HEADER))
+
+/* Size classes of pooled items */
+typedef enum _KV_PoolClass {
+  KV_POOL_STR16 = 0, /* Strings of up to 16 bytes together with the header, e.g. most keys */
+  KV_POOL_STR32,
+  KV_POOL_STR64,
+  KV_POOL_PAIR,
+
+  KV_POOL_CLASSES /* Strings that are too long to be pooled */
+} KV_PoolClass;
+
+struct _KV_Pool {
+  KV_Block *_blocks; /* Block that's currently being cut into items, followed by all the previous ones */
+  size_t _blocksize;
+  KV_PoolItem *_free[KV_POOL_CLASSES]; /* Freed items of each size */
+};
 
-      KV_free(strIndent);
-    } return KV_true;
+/* Pool that pairs are allocated from on this thread, see KV_SetThreadPool() */
+static KV_THREAD_LOCAL KV_Pool *_poolThread = NULL;
 
-    case KV_TYPE_STRING: {
-      strValue = KV_ConvertEscapeSeq(pair->_value.str);
+KV_Pool *KV_NewPool(size_t blocksize) {
+  KV_Pool *pool = (KV_Pool *)KV_malloc(sizeof(KV_Pool));
+  int iClass;
 
-      if (bValueAfterKey) {
-        KV_PrinterFormat(ctx, "%s\"%s\"\n", indentation, strValue);
-      } else {
-        KV_PrinterFormat(ctx, "\"%s\"\n", strValue);
-      }
+  pool->_blocks = NULL;
+  pool->_blocksize = (blocksize ? blocksize : KV_POOL_BLOCKSIZE);
 
-      KV_free(strValue);
-      KV_free(strIndent);
-    } return KV_true;
+  for (iClass = 0; iClass < KV_POOL_CLASSES; ++iClass) {
+    pool->_free[iClass] = NULL;
+  }
 
-    /* Exit the switch */
-    default: break;
+  return pool;
+};
+
+void KV_PoolDestroy(KV_Pool *pool) {
+  KV_Block *block;
+
+  assert(pool);
+
+  /* Don't leave the current thread with a dangling pool */
+  if (_poolThread == pool) _poolThread = NULL;
+
+  /* Free all blocks at once */
+  while (pool->_blocks) {
+    block = pool->_blocks;
+    pool->_blocks = block->next;
+
+    KV_free(block);
   }
 
-  /* Unknown value type */
-  assert(!"Unknown value type");
+  KV_free(pool);
+};
 
-  KV_SetError("Unknown value type");
-  KV_free(strIndent);
-  return KV_false;
+void KV_SetThreadPool(KV_Pool *pool) {
+  _poolThread = pool;
 };
 
-char *KV_Print(KV_Pair *pair, size_t *length, size_t expansionstep, const char *indentation) {
-  KV_Printer printer;
-  KV_PrinterInit(&printer, expansionstep);
+KV_Pool *KV_GetThreadPool(void) {
+  return _poolThread;
+};
+
+size_t KV_PoolGetSize(const KV_Pool *pool) {
+  const KV_Block *block;
+  size_t size = sizeof(KV_Pool);
+
+  assert(pool);
 
-  if (KV_PrintInternal(pair, &printer, 0, indentation)) {
-    return KV_PrinterGetBuffer(&printer, length);
+  for (block = pool->_blocks; block; block = block->next) {
+    size += KV_ALIGNED(sizeof(KV_Block)) + block->size;
   }
 
-  /* Free buffer on error */
-  KV_PrinterClear(&printer);
-  return NULL;
+  return size;
 };
 
-/*********************************************************************************************************************************
- * Doubly linked lists
- *********************************************************************************************************************************/
+/* Returns the amount of bytes taken by items of a size class, including the header */
+KV_INLINE size_t KV_PoolClassSize(KV_PoolClass eClass) {
+  if (eClass == KV_POOL_PAIR) return KV_POOL_HEADER + KV_ALIGNED(sizeof(KV_Pair));
+  return (size_t)16 << eClass;
+};
 
-KV_bool KV_HasNodes(KV_Pair *list) {
-  /* Not a list */
-  assert(list);
-  if (list->_type != KV_TYPE_NONE) return KV_false;
+/* Returns the size class for a string of a specific size, including the null terminator */
+KV_INLINE KV_PoolClass KV_PoolStringClass(size_t size) {
+  size += KV_POOL_HEADER;
 
-  return list->_value.head ? KV_true : KV_false;
+  if (size <= 16) return KV_POOL_STR16;
+  if (size <= 32) return KV_POOL_STR32;
+  if (size <= 64) return KV_POOL_STR64;
+
+  return KV_POOL_CLASSES;
 };
 
-size_t KV_GetNodeCount(KV_Pair *list) {
-  size_t ct = 0;
+/* Allocates an item of a specific size class by reusing a freed one or by cutting it out of the current block */
+KV_INLINE void *KV_PoolAlloc(KV_Pool *pool, KV_PoolClass eClass) {
+  KV_PoolItem *item = pool->_free[eClass];
+  KV_Block *block;
+  size_t size;
 
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return (size_t)(-1);
+  if (item) {
+    pool->_free[eClass] = item->next;
 
-  list = list->_value.head;
+  } else {
+    block = pool->_blocks;
+    size = KV_PoolClassSize(eClass);
+
+    /* The rest of the current block is left unused */
+    if (!block || block->size - block->used < size) {
+      block = KV_NewBlock(pool->_blocksize > size ? pool->_blocksize : size);
+      block->next = pool->_blocks;
+      pool->_blocks = block;
+    }
 
-  while (list) {
-    list = list->_next;
-    ++ct;
+    item = (KV_PoolItem *)(KV_BLOCK_DATA(block) + block->used);
+    block->used += size;
   }
 
-  return ct;
+  item->list = &pool->_free[eClass];
+  return KV_POOL_DATA(item);
 };
 
-KV_Pair *KV_GetPair(KV_Pair *list, size_t n) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return NULL;
+/* Returns an item that has been allocated by KV_PoolAlloc() to the pool it came from */
+KV_INLINE void KV_PoolFree(void *data) {
+  KV_PoolItem *item = KV_POOL_ITEM(data);
+  KV_PoolItem **list = item->list;
 
-  for (list = list->_value.head; list; list = list->_next)
-  {
-    if (n == 0) return list;
-    --n;
+  item->next = *list;
+  *list = item;
+};
+
+/* Allocates a new pair from a pool or separately if there's no pool, with its storage flags reset */
+KV_INLINE KV_Pair *KV_PoolNewPair(KV_Pool *pool) {
+  KV_Pair *pair;
+
+  if (!pool) {
+    pair = (KV_Pair *)KV_malloc(sizeof(KV_Pair));
+    pair->_flags = 0;
+    return pair;
   }
 
-  return NULL;
+  pair = (KV_Pair *)KV_PoolAlloc(pool, KV_POOL_PAIR);
+  pair->_flags = KV_PAIR_POOL;
+  return pair;
 };
 
-KV_Pair *KV_FindPair(KV_Pair *list, const char *key) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return NULL;
+/* Copies a key or a string value for a pair from a pool, if there's one and the string is short enough.
+ * Sets the specified flag in 'flags' if the copy has been allocated from the pool, otherwise it's allocated separately.
+ */
+KV_INLINE char *KV_PoolCopyString(KV_Pool *pool, const char *str, unsigned int *flags, unsigned int flag) {
+  size_t size;
+  KV_PoolClass eClass;
+  char *strNew;
 
-  for (list = list->_value.head; list; list = list->_next)
-  {
-    if (!strcmp(list->_key, key)) return list;
-  }
+  if (!pool) return KV_strdup(str);
 
-  return NULL;
+  size = strlen(str) + 1;
+  eClass = KV_PoolStringClass(size);
+
+  if (eClass == KV_POOL_CLASSES) return KV_strdup(str);
+
+  strNew = (char *)KV_PoolAlloc(pool, eClass);
+  memcpy(strNew, str, size);
+
+  *flags |= flag;
+  return strNew;
 };
 
-KV_Pair *KV_FindPairOfType(KV_Pair *list, const char *key, KV_DataType type) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return NULL;
+/* Frees a key or a string value of a pair that may have been copied by KV_PoolCopyString() */
+KV_INLINE void KV_FreeString(char *str, unsigned int flags, unsigned int flag) {
+  if (flags & flag) {
+    KV_PoolFree(str);
+  } else {
+    KV_free(str);
+  }
+};
 
-  for (list = list->_value.head; list; list = list->_next)
-  {
-    if (list->_type != type) continue;
+/*********************************************************************************************************************************
+ * Symbols
+ *********************************************************************************************************************************/
 
-    if (!strcmp(list->_key, key)) return list;
+/* Unique key name in the symbol table */
+typedef struct _KV_Symbol {
+  const char *str; /* NULL for empty slots */
+  size_t hash;
+} KV_Symbol;
+
+/* Open addressing hash table of all interned key names, which is at most half full */
+static KV_Symbol *_aSymbols = NULL;
+static size_t _ctSymbolsArray = 0;
+static size_t _ctSymbols = 0;
+
+/* Storage for the strings of interned key names */
+static KV_Document *_docSymbols = NULL;
+
+/* 64-bit FNV-1a parameters, assembled from 32-bit halves to avoid long long constants */
+#define KV_FNV64_OFFSET (((KV_uint64)0xCBF29CE4UL << 32) | 0x84222325UL)
+#define KV_FNV64_PRIME  (((KV_uint64)0x00000100UL << 32) | 0x000001B3UL)
+
+/* FNV-1a hash of a specific amount of characters */
+KV_INLINE size_t KV_HashString(const char *str, size_t length) {
+  const unsigned char *pch = (const unsigned char *)str;
+  const unsigned char *pchEnd = pch + length;
+  size_t hash = (sizeof(size_t) > 4) ? (size_t)KV_FNV64_OFFSET : (size_t)2166136261UL;
+
+  while (pch != pchEnd) {
+    hash ^= *pch++;
+    hash *= (sizeof(size_t) > 4) ? (size_t)KV_FNV64_PRIME : (size_t)16777619UL;
   }
 
-  return NULL;
+  return hash;
 };
 
-KV_bool KV_IsEmpty(KV_Pair *list, const char *key) {
-  KV_Pair *pair = KV_FindPair(list, key);
+/* Finds a slot in the symbol table that either holds a key name or should hold it */
+KV_INLINE KV_Symbol *KV_FindSymbolSlot(const char *str, size_t length, size_t hash) {
+  size_t iSlot = hash & (_ctSymbolsArray - 1);
+  KV_Symbol *sym;
 
-  /* No pair found */
-  if (!pair) return KV_true;
+  for (;;) {
+    sym = &_aSymbols[iSlot];
 
-  /* Has a value */
-  if (pair->_type != KV_TYPE_NONE) return KV_false;
+    if (!sym->str) return sym;
+    if (sym->hash == hash && !memcmp(sym->str, str, length) && sym->str[length] == '\0') return sym;
 
-  /* Has no subpairs */
-  return list->_value.head ? KV_true : KV_false;
+    iSlot = (iSlot + 1) & (_ctSymbolsArray - 1);
+  }
 };
 
-const char *KV_FindString(KV_Pair *list, const char *key, const char *defaultValue) {
-  KV_Pair *pair = KV_FindPairOfType(list, key, KV_TYPE_STRING);
-  return (pair ? pair->_value.str : defaultValue);
+/* Returns an interned copy of a null-terminated key name or NULL if it's not in the symbol table */
+KV_INLINE const char *KV_LookupSymbol(const char *key) {
+  size_t length;
+  if (!_ctSymbols) return NULL;
+
+  length = strlen(key);
+  return KV_FindSymbolSlot(key, length, KV_HashString(key, length))->str;
 };
 
-KV_Pair *KV_GetHead(KV_Pair *list) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return NULL;
+/* Returns an interned copy of a specific amount of characters, adding it to the symbol table if needed */
+static const char *KV_InternString(const char *str, size_t length) {
+  size_t hash = KV_HashString(str, length);
+  KV_Symbol *aOldSymbols, *sym;
+  size_t ctOldArray, iSlot;
+  char *strNew;
+
+  if (!_aSymbols) {
+    _ctSymbolsArray = 256;
+    _aSymbols = (KV_Symbol *)KV_calloc(_ctSymbolsArray, sizeof(KV_Symbol));
+    _docSymbols = KV_NewDocument(0);
+  }
 
-  return list->_value.head;
-};
+  sym = KV_FindSymbolSlot(str, length, hash);
+  if (sym->str) return sym->str;
 
-KV_Pair *KV_GetTail(KV_Pair *list) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return NULL;
+  /* Double the table before it gets more than half full */
+  if ((_ctSymbols + 1) * 2 > _ctSymbolsArray) {
+    aOldSymbols = _aSymbols;
+    ctOldArray = _ctSymbolsArray;
 
-  return list->_value.tail;
-};
+    _ctSymbolsArray *= 2;
+    _aSymbols = (KV_Symbol *)KV_calloc(_ctSymbolsArray, sizeof(KV_Symbol));
 
-/* Setup the very first pair in a list */
-KV_INLINE void KV_SetFirstPair(KV_Pair *pair, KV_Pair *first) {
-  pair->_value.head = pair->_value.tail = first;
+    for (iSlot = 0; iSlot < ctOldArray; ++iSlot) {
+      if (!aOldSymbols[iSlot].str) continue;
 
-  /* Relink the pair to this list */
-  KV_Expunge(first);
-  first->_parent = pair;
-};
+      sym = &_aSymbols[aOldSymbols[iSlot].hash & (_ctSymbolsArray - 1)];
+      while (sym->str) sym = (sym == &_aSymbols[_ctSymbolsArray - 1]) ? _aSymbols : sym + 1;
 
-void KV_AddHead(KV_Pair *list, KV_Pair *other) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return;
+      *sym = aOldSymbols[iSlot];
+    }
 
-  /* Insert at the beginning if there is already a list */
-  if (list->_value.head) {
-    KV_InsertBefore(other, list->_value.head);
-  } else {
-    KV_SetFirstPair(list, other);
+    KV_free(aOldSymbols);
+    sym = KV_FindSymbolSlot(str, length, hash);
   }
+
+  strNew = (char *)KV_DocumentAlloc(_docSymbols, length + 1, 1);
+  memcpy(strNew, str, length);
+  strNew[length] = '\0';
+
+  sym->str = strNew;
+  sym->hash = hash;
+  ++_ctSymbols;
+
+  return strNew;
 };
 
-void KV_AddTail(KV_Pair *list, KV_Pair *other) {
-  /* Not a list */
-  assert(list);
-  assert(list->_type == KV_TYPE_NONE);
-  if (list->_type != KV_TYPE_NONE) return;
+const char *KV_Intern(const char *key) {
+  assert(key);
+  return KV_InternString(key, strlen(key));
+};
 
-  /* Insert at the end if there is already a list */
-  if (list->_value.tail) {
-    KV_InsertAfter(other, list->_value.tail);
-  } else {
-    KV_SetFirstPair(list, other);
-  }
+size_t KV_GetSymbolCount(void) {
+  return _ctSymbols;
 };
 
-/* Unlink a pair from its previous neighbor */
-KV_INLINE void KV_UnlinkPrev(KV_Pair *pair) {
-  if (pair->_prev != NULL) pair->_prev->_next = NULL;
-  pair->_prev = NULL;
+void KV_ClearSymbols(void) {
+  /* Cached lists may hold interned keys */
+  KV_InvalidateIncludeCache(NULL);
+
+  if (!_aSymbols) return;
+
+  KV_free(_aSymbols);
+  KV_DocumentDestroy(_docSymbols);
+
+  _aSymbols = NULL;
+  _ctSymbolsArray = _ctSymbols = 0;
+  _docSymbols = NULL;
 };
 
-/* Unlink a pair from its next neighbor */
-KV_INLINE void KV_UnlinkNext(KV_Pair *pair) {
-  if (pair->_next != NULL) pair->_next->_prev = NULL;
-  pair->_next = NULL;
+/* Check if a pair has a specific key. Interned keys are only compared by pointer.
+ *
+ * sym - Interned copy of the key or NULL, if it's not in the symbol table (see KV_LookupSymbol()).
+ */
+KV_INLINE KV_bool KV_IsKey(const KV_Pair *pair, const char *key, const char *sym) {
+  if (pair->_flags & KV_PAIR_KEYSYM) return (pair->_key == sym) ? KV_true : KV_false;
+
+  return !strcmp(pair->_key, key) ? KV_true : KV_false;
 };
 
-void KV_InsertBefore(KV_Pair *pair, KV_Pair *other) {
-  KV_Pair *before;
-  assert(pair && other);
+/*********************************************************************************************************************************
+ * Indices
+ *********************************************************************************************************************************/
 
-  /* Remove from the current list and borrow the new parent */
-  KV_Expunge(pair);
-  pair->_parent = other->_parent;
+/* Default amount of subpairs that a lookup by key or position goes through before indexing the list */
+#define KV_INDEX_THRESHOLD 32
 
-  /* Relink the parent to this new node */
-  if (other->_parent->_value.head == other) {
-    other->_parent->_value.head = pair;
+static size_t _ctIndexThreshold = KV_INDEX_THRESHOLD;
+
+/* Subpairs under the same key in an indexed list */
+typedef struct _KV_IndexEntry {
+  KV_Pair *pair; /* First subpair with the key or NULL for empty slots */
+  size_t hash;
+  size_t count; /* Amount of subpairs with the key */
+} KV_IndexEntry;
+
+/* Indices of subpairs in a wide list, each one built on demand */
+struct _KV_Index {
+  /* Open addressing hash table of subpair keys, which is at most half full (NULL if not built) */
+  KV_IndexEntry *aEntries;
+  size_t ctArray;
+  size_t ctUsed;
+
+  /* Subpairs in list order (NULL if not built or if the list has been rearranged since) */
+  KV_Pair **aNodes;
+  size_t ctNodesArray;
+};
+
+void KV_SetIndexThreshold(size_t ct) {
+  _ctIndexThreshold = ct;
+};
+
+/* Returns an interned copy of the pair key or NULL if it's not in the symbol table */
+KV_INLINE const char *KV_GetSymbol(const KV_Pair *pair) {
+  if (pair->_flags & KV_PAIR_KEYSYM) return pair->_key;
+
+  return KV_LookupSymbol(pair->_key);
+};
+
+/* Finds a slot in an index that either holds a key or should hold it */
+KV_INLINE KV_IndexEntry *KV_IndexSlot(KV_Index *index, const char *key, const char *sym, size_t hash) {
+  size_t iSlot = hash & (index->ctArray - 1);
+  KV_IndexEntry *entry;
+
+  for (;;) {
+    entry = &index->aEntries[iSlot];
+
+    if (!entry->pair) return entry;
+    if (entry->hash == hash && KV_IsKey(entry->pair, key, sym)) return entry;
+
+    iSlot = (iSlot + 1) & (index->ctArray - 1);
   }
+};
 
-  /* Remember the node that goes before this one (may be NULL) */
-  before = other->_prev;
-  KV_UnlinkPrev(other);
+/* Doubles the amount of slots in an index */
+KV_INLINE void KV_IndexGrow(KV_Index *index) {
+  KV_IndexEntry *aOldEntries = index->aEntries;
+  size_t ctOldArray = index->ctArray;
+  size_t iEntry, iSlot;
 
-  /* Link the other node after this one */
-  other->_prev = pair;
-  pair->_next = other;
+  index->ctArray *= 2;
+  index->aEntries = (KV_IndexEntry *)KV_calloc(index->ctArray, sizeof(KV_IndexEntry));
 
-  /* Link the node that goes before */
-  if (before) {
-    pair->_prev = before;
-    before->_next = pair;
+  /* Keys are already unique */
+  for (iEntry = 0; iEntry < ctOldArray; ++iEntry) {
+    if (!aOldEntries[iEntry].pair) continue;
+
+    iSlot = aOldEntries[iEntry].hash & (index->ctArray - 1);
+    while (index->aEntries[iSlot].pair) iSlot = (iSlot + 1) & (index->ctArray - 1);
+
+    index->aEntries[iSlot] = aOldEntries[iEntry];
   }
+
+  KV_free(aOldEntries);
 };
 
-void KV_InsertAfter(KV_Pair *pair, KV_Pair *other) {
-  KV_Pair *after;
-  assert(pair && other);
+/* Check if a pair goes before another pair in the same list by walking away from it in both directions */
+KV_INLINE KV_bool KV_IsBefore(const KV_Pair *pair, const KV_Pair *other) {
+  const KV_Pair *pairPrev = pair->_prev;
+  const KV_Pair *pairNext = pair->_next;
 
-  /* Remove from the current list and borrow the new parent */
-  KV_Expunge(pair);
-  pair->_parent = other->_parent;
+  for (;;) {
+    if (!pairPrev || pairNext == other) return KV_true;
+    if (!pairNext || pairPrev == other) return KV_false;
 
-  /* Relink the parent to this new node */
-  if (other->_parent->_value.tail == other) {
-    other->_parent->_value.tail = pair;
+    pairPrev = pairPrev->_prev;
+    pairNext = pairNext->_next;
   }
+};
 
-  /* Remember the node that goes after this one (may be NULL) */
-  after = other->_next;
-  KV_UnlinkNext(other);
+/* Adds a subpair that is already linked into its list to the list index.
+ *
+ * last - The subpair is known to go after all the other indexed subpairs.
+ */
+static void KV_IndexAdd(KV_Index *index, KV_Pair *pair, KV_bool last) {
+  KV_IndexEntry *entry;
+  const char *sym;
+  size_t hash;
 
-  /* Link the other node before this one */
-  other->_next = pair;
-  pair->_prev = other;
+  /* Only root pairs have no keys */
+  if (!pair->_key) return;
 
-  /* Link the node that goes after */
-  if (after) {
-    pair->_next = after;
-    after->_prev = pair;
+  sym = KV_GetSymbol(pair);
+  hash = KV_HashString(pair->_key, strlen(pair->_key));
+  entry = KV_IndexSlot(index, pair->_key, sym, hash);
+
+  /* Another subpair under the same key */
+  if (entry->pair) {
+    ++entry->count;
+
+    /* Keep track of the first one */
+    if (!last && KV_IsBefore(pair, entry->pair)) entry->pair = pair;
+    return;
+  }
+
+  if ((index->ctUsed + 1) * 2 > index->ctArray) {
+    KV_IndexGrow(index);
+    entry = KV_IndexSlot(index, pair->_key, sym, hash);
   }
+
+  entry->pair = pair;
+  entry->hash = hash;
+  entry->count = 1;
+  ++index->ctUsed;
 };
 
-void KV_Expunge(KV_Pair *pair) {
-  assert(pair);
+/* Removes a subpair that is still linked into its list from the list index */
+static void KV_IndexRemove(KV_Index *index, KV_Pair *pair) {
+  KV_IndexEntry *aEntries = index->aEntries;
+  size_t ctMask = index->ctArray - 1;
+  size_t iHole, iSlot, iHome;
+  const char *key = pair->_key;
+  const char *sym;
 
-  /* Link neighboring pairs together */
-  if (pair->_prev) pair->_prev->_next = pair->_next;
-  if (pair->_next) pair->_next->_prev = pair->_prev;
+  if (!key) return;
 
-  /* Relink list head and tail */
-  if (pair->_parent) {
-    if (pair->_parent->_value.head == pair) {
-      pair->_parent->_value.head = pair->_next;
+  sym = KV_GetSymbol(pair);
+  iHole = KV_IndexSlot(index, key, sym, KV_HashString(key, strlen(key))) - aEntries;
+  assert(aEntries[iHole].pair);
+
+  /* Other subpairs remain under the same key */
+  if (aEntries[iHole].count > 1) {
+    --aEntries[iHole].count;
+
+    /* Find the next one if the first one is removed */
+    if (aEntries[iHole].pair == pair) {
+      do {
+        pair = pair->_next;
+      } while (!pair->_key || !KV_IsKey(pair, key, sym));
+
+      aEntries[iHole].pair = pair;
     }
 
-    if (pair->_parent->_value.tail == pair) {
-      pair->_parent->_value.tail = pair->_prev;
+    return;
+  }
+
+  /* Shift the following entries back into the freed slot */
+  for (iSlot = (iHole + 1) & ctMask; aEntries[iSlot].pair; iSlot = (iSlot + 1) & ctMask) {
+    iHome = aEntries[iSlot].hash & ctMask;
+
+    /* Only if the entry doesn't end up before its home slot */
+    if (((iSlot - iHome) & ctMask) >= ((iSlot - iHole) & ctMask)) {
+      aEntries[iHole] = aEntries[iSlot];
+      iHole = iSlot;
     }
   }
 
-  /* Reset the links */
-  pair->_prev = pair->_next = NULL;
+  aEntries[iHole].pair = NULL;
+  --index->ctUsed;
 };
 
-KV_Pair *KV_GetPrev(KV_Pair *pair) {
-  assert(pair);
-  return pair->_prev;
+/* Returns indices of a list, setting up empty ones if there are none */
+static KV_Index *KV_GetIndex(KV_Pair *list) {
+  KV_Index *index = list->_value.index;
+  if (index) return index;
+
+  index = (KV_Index *)KV_calloc(1, sizeof(KV_Index));
+  list->_value.index = index;
+
+  /* Document lists now hold heap memory */
+  KV_MarkDirty(list);
+  return index;
 };
 
-KV_Pair *KV_GetNext(KV_Pair *pair) {
-  assert(pair);
-  return pair->_next;
+/* Returns the key index of a list or NULL if it's not indexed by key */
+KV_INLINE KV_Index *KV_GetKeyIndex(const KV_Pair *list) {
+  if (!list->_value.index || !list->_value.index->aEntries) return NULL;
+
+  return list->_value.index;
 };
 
-/*********************************************************************************************************************************
- * Pair values
- *********************************************************************************************************************************/
+/* Indexes all subpairs of a list by key */
+static void KV_BuildIndex(KV_Pair *list) {
+  KV_Index *index = KV_GetIndex(list);
+  KV_Pair *pair;
 
-char *KV_GetKey(KV_Pair *pair) {
-  assert(pair);
-  return pair->_key;
+  index->ctArray = 64;
+  index->ctUsed = 0;
+  index->aEntries = (KV_IndexEntry *)KV_calloc(index->ctArray, sizeof(KV_IndexEntry));
+
+  for (pair = list->_value.head; pair; pair = pair->_next) {
+    KV_IndexAdd(index, pair, KV_true);
+  }
 };
 
-KV_DataType KV_GetDataType(KV_Pair *pair) {
-  assert(pair);
-  return pair->_type;
+/* Puts all subpairs of a list into an array */
+static void KV_BuildNodes(KV_Pair *list) {
+  KV_Index *index = KV_GetIndex(list);
+  KV_Pair *pair;
+  size_t iNode = 0;
+
+  index->ctNodesArray = list->_value.count;
+  index->aNodes = (KV_Pair **)KV_malloc(index->ctNodesArray * sizeof(KV_Pair *));
+
+  for (pair = list->_value.head; pair; pair = pair->_next) {
+    index->aNodes[iNode++] = pair;
+  }
 };
 
-char *KV_GetString(KV_Pair *pair) {
-  assert(pair);
-  assert(pair->_type == KV_TYPE_STRING);
-  return pair->_value.str;
+/* Frees all indices of a list, if there are any */
+KV_INLINE void KV_FreeIndex(KV_Pair *list) {
+  if (!list->_value.index) return;
+
+  KV_free(list->_value.index->aEntries);
+  KV_free(list->_value.index->aNodes);
+  KV_free(list->_value.index);
+  list->_value.index = NULL;
 };
 
-/*********************************************************************************************************************************
- * Serialization
- *********************************************************************************************************************************/
+/* Frees the key index of a list, if there is one */
+KV_INLINE void KV_FreeKeyIndex(KV_Pair *list) {
+  if (!KV_GetKeyIndex(list)) return;
 
-static KV_Pair *KV_ParseBufferInternal(KV_Context *ctx, KV_bool inner);
+  /* Nothing else is indexed */
+  if (!list->_value.index->aNodes) {
+    KV_FreeIndex(list);
+    return;
+  }
 
-/* Parses a new file and constructs a new list out of its contents.
- *
- * ctx - Context for parsing a new file.
- * ctxParent - Context of the parser that's including this new file (may be NULL).
- */
-KV_INLINE KV_Pair *KV_ParseFileInternal(KV_Context *ctx, KV_Context *ctxParent) {
-  FILE *file;
-  char *str;
-  KV_Pair *list;
-  KV_Context ctxParse;
+  KV_free(list->_value.index->aEntries);
+  list->_value.index->aEntries = NULL;
+  list->_value.index->ctArray = list->_value.index->ctUsed = 0;
+};
 
-  /* Disregard the directory if it's an empty string or the file path is absolute */
-  if (!*ctx->_directory || IsPathStringAbsolute(ctx->_file)) {
-    file = fopen(ctx->_file, "rb");
+/* Adds a subpair that has just been linked into its list to the key index */
+KV_INLINE void KV_IndexLink(KV_Pair *pair) {
+  if (pair->_parent && KV_GetKeyIndex(pair->_parent)) KV_IndexAdd(pair->_parent->_value.index, pair, KV_false);
+};
 
-  /* Otherwise compose a full path to the file */
-  } else {
-    str = (char *)KV_malloc(strlen(ctx->_directory) + strlen(ctx->_file) + 1);
-    strcpy(str, ctx->_directory);
-    strcat(str, ctx->_file);
+/* Removes a subpair that is about to be unlinked from its list from the key index */
+KV_INLINE void KV_IndexUnlink(KV_Pair *pair) {
+  if (pair->_parent && KV_GetKeyIndex(pair->_parent)) KV_IndexRemove(pair->_parent->_value.index, pair);
+};
 
-    file = fopen(str, "rb");
-    KV_free(str);
+/* Updates the list of a subpair that has just been linked into it */
+KV_INLINE void KV_NodeAdded(KV_Pair *pair) {
+  KV_Pair *list = pair->_parent;
+  KV_Index *index = list->_value.index;
+
+  ++list->_value.count;
+  if (!index) return;
+
+  if (index->aEntries) KV_IndexAdd(index, pair, KV_false);
+  if (!index->aNodes) return;
+
+  /* Subpairs added to the end go at the end of the array, otherwise it's rebuilt on demand */
+  if (pair != list->_value.tail) {
+    KV_free(index->aNodes);
+    index->aNodes = NULL;
+    return;
   }
 
-  if (!file) {
-    str = (char *)KV_malloc(strlen(strerror(errno)) + 22);
-    strcpy(str, "Cannot include file: ");
-    strcat(str, strerror(errno));
+  if (list->_value.count > index->ctNodesArray) {
+    index->ctNodesArray *= 2;
+    index->aNodes = (KV_Pair **)KV_realloc(index->aNodes, index->ctNodesArray * sizeof(KV_Pair *));
+  }
 
-    if (ctxParent) {
-      KV_SetContextError(ctxParent, ctxParent->_line, str);
-    } else {
-      KV_SetError(str);
+  index->aNodes[list->_value.count - 1] = pair;
+};
+
+/* Updates the list of a subpair that is about to be unlinked from it */
+KV_INLINE void KV_NodeRemoved(KV_Pair *pair) {
+  KV_Pair *list = pair->_parent;
+  KV_Index *index = list->_value.index;
+
+  --list->_value.count;
+  if (!index) return;
+
+  if (index->aEntries) KV_IndexRemove(index, pair);
+
+  /* Removing the last subpair only shortens the array */
+  if (index->aNodes && pair != list->_value.tail) {
+    KV_free(index->aNodes);
+    index->aNodes = NULL;
+  }
+};
+
+/* Finds the first subpair under a specific key in a list. Interned keys are only compared by pointer.
+ * The list is indexed after looking through a specific amount of subpairs (never, if it's 0).
+ *
+ * sym - Interned copy of the key or NULL, if it's not in the symbol table (see KV_LookupSymbol()).
+ */
+KV_INLINE KV_Pair *KV_FindKeyWithThreshold(KV_Pair *list, const char *key, const char *sym, size_t ctThreshold) {
+  KV_Pair *pair;
+  size_t ct = 0;
+
+  if (!KV_GetKeyIndex(list)) {
+    for (pair = list->_value.head; pair; pair = pair->_next)
+    {
+      if (KV_IsKey(pair, key, sym)) return pair;
+      if (++ct == ctThreshold) break;
     }
 
-    KV_free(str);
-    return NULL;
+    /* Looked through the entire list */
+    if (!pair) return NULL;
+
+    KV_BuildIndex(list);
   }
 
-  /* Get file size */
-  fseek(file, 0, SEEK_END);
-  ctx->_length = ftell(file);
-  fseek(file, 0, SEEK_SET);
+  return KV_IndexSlot(list->_value.index, key, sym, KV_HashString(key, strlen(key)))->pair;
+};
 
-  /* Read file contents into the string and close the file */
-  str = (char *)KV_malloc(ctx->_length);
-  fread(str, sizeof(char), ctx->_length, file);
-  fclose(file);
+/* Finds the first subpair under a specific key in a list. Wide lists are indexed after looking through enough subpairs. */
+KV_INLINE KV_Pair *KV_FindKey(KV_Pair *list, const char *key, const char *sym) {
+  return KV_FindKeyWithThreshold(list, key, sym, _ctIndexThreshold);
+};
 
-  /* Parse file contents and then free them */
-  KV_ContextSetupBuffer(&ctxParse, ctx->_directory, str, ctx->_length);
-  KV_ContextCopyFlags(&ctxParse, ctx);
+/* Check if two pairs have equal keys */
+KV_INLINE KV_bool KV_SameKeys(const KV_Pair *pair1, const KV_Pair *pair2) {
+  if (!pair1->_key || !pair2->_key) return (pair1->_key == pair2->_key) ? KV_true : KV_false;
 
-  /* For error output */
-  ctxParse._file = ctx->_file;
+  return KV_IsKey(pair1, pair2->_key, KV_GetSymbol(pair2));
+};
 
-  list = KV_ParseBufferInternal(&ctxParse, KV_false);
-  KV_free(str);
+/* Returns the amount of subpairs to look through before indexing a list that's about to be searched for many keys.
+ * Such lists are indexed when they get wide even if indexing is disabled, see KV_EndBulkLookups().
+ */
+KV_INLINE size_t KV_GetBulkThreshold(void) {
+  return (_ctIndexThreshold ? _ctIndexThreshold : KV_INDEX_THRESHOLD);
+};
 
-  return list;
+/* Finds a subpair under the same key as some other pair in a list that's about to be searched for many keys */
+KV_INLINE KV_Pair *KV_FindSameKeyInBulk(KV_Pair *list, const KV_Pair *pair) {
+  return KV_FindKeyWithThreshold(list, pair->_key, KV_GetSymbol(pair), KV_GetBulkThreshold());
 };
 
-/* IMPORTANT: Returned pointer needs to be manually freed! */
-KV_INLINE char *KV_ParseString(KV_Context *ctx, KV_bool onlyquotes)
-{
-  char *str;
-  size_t ctCapacity, iChar;
+/* Frees the key index that has been built for searching a list for many keys, if lists may not be indexed.
+ *
+ * wasIndexed - Whether the list has already been indexed by key before the search.
+ */
+KV_INLINE void KV_EndBulkLookups(KV_Pair *list, KV_bool wasIndexed) {
+  if (!_ctIndexThreshold && !wasIndexed) KV_FreeKeyIndex(list);
+};
 
-  ctCapacity = 256;
-  iChar = 0;
-  str = (char *)KV_malloc(ctCapacity + 1);
+/*********************************************************************************************************************************
+ * One pair of key & value
+ *********************************************************************************************************************************/
 
-  for (;;) {
-    /* Quit the loop on specific characters */
-    if (!onlyquotes) {
-      if (*ctx->_pch == '"' || *ctx->_pch == '/' || *ctx->_pch == '{' || *ctx->_pch == '}' || isspace(*ctx->_pch)) {
-        break;
-      }
+KV_Pair *KV_NewList(const char *key) {
+  /* Allocate the pair and reset its state */
+  KV_Pool *pool = _poolThread;
+  KV_Pair *pair = KV_PoolNewPair(pool);
 
-    /* Skip closing quotes */
-    } else if (*ctx->_pch == '"') {
-      ++ctx->_pch;
-      break;
-    }
+  pair->_key = (key ? KV_PoolCopyString(pool, key, &pair->_flags, KV_PAIR_KEYPOOL) : NULL);
+  pair->_type = KV_TYPE_NONE;
+  KV_InitList(pair);
 
-    /* Unexpected end of the string */
-    if (KV_ContextBufferEnded(ctx) || *ctx->_pch == '\n') {
-      /* Fine with unquoted strings */
-      if (!onlyquotes) break;
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
 
-      KV_SetContextError(ctx, ctx->_line, "Unclosed string");
-      KV_free(str);
-      return NULL;
-    }
+  return pair;
+};
 
-    /* Allocate more space for the string */
-    if (iChar >= ctCapacity) {
-      ctCapacity += 256;
-      str = (char *)KV_realloc(str, ctCapacity);
-    }
+KV_Pair *KV_NewString(const char *key, const char *value) {
+  /* Allocate the pair and set new values */
+  KV_Pool *pool = _poolThread;
+  KV_Pair *pair = KV_PoolNewPair(pool);
 
-    /* Parse escape sequence */
-    if (ctx->_escapeseq && *ctx->_pch == '\\') {
-      ++ctx->_pch;
+  assert(value);
 
-      /* Insert a single backslash, if at the very end */
-      if (KV_ContextBufferEnded(ctx)) {
-        str[iChar++] = '\\';
-        break;
-      }
+  pair->_key = (key ? KV_PoolCopyString(pool, key, &pair->_flags, KV_PAIR_KEYPOOL) : NULL);
+  pair->_type = KV_TYPE_STRING;
+  pair->_value.str = KV_PoolCopyString(pool, value, &pair->_flags, KV_PAIR_STRPOOL);
 
-      /* Append special character */
-      switch (*ctx->_pch) {
-        case 'n':  str[iChar++] = '\n'; break;
-        case 't':  str[iChar++] = '\t'; break;
-        case 'r':  str[iChar++] = '\r'; break;
-        case 'b':  str[iChar++] = '\b'; break;
-        case 'f':  str[iChar++] = '\f'; break;
-        case '"':  str[iChar++] = '"';  break;
-        case '\\': str[iChar++] = '\\'; break;
-        default: break;
-      }
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
 
-    /* Append a regular character */
-    } else {
-      str[iChar++] = *ctx->_pch;
-    }
+  return pair;
+};
 
-    ++ctx->_pch;
-  }
+/* Allocates a new pair for a typed value that's set afterwards */
+KV_INLINE KV_Pair *KV_NewTypedPair(const char *key, KV_DataType type) {
+  KV_Pool *pool = _poolThread;
+  KV_Pair *pair = KV_PoolNewPair(pool);
 
-  /* Terminate the string */
-  str[iChar] = '\0';
+  pair->_key = (key ? KV_PoolCopyString(pool, key, &pair->_flags, KV_PAIR_KEYPOOL) : NULL);
+  pair->_type = type;
 
-  return str;
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
+
+  return pair;
 };
 
-/* Count line breaks */
-KV_INLINE KV_bool KV_ParseLineBreak(KV_Context *ctx)
-{
-  if (*ctx->_pch == '\n') {
+KV_Pair *KV_NewInt(const char *key, int value) {
+  KV_Pair *pair = KV_NewTypedPair(key, KV_TYPE_INT);
+  pair->_value.i = value;
+  return pair;
+};
+
+KV_Pair *KV_NewFloat(const char *key, float value) {
+  KV_Pair *pair = KV_NewTypedPair(key, KV_TYPE_FLOAT);
+  pair->_value.f = value;
+  return pair;
+};
+
+KV_Pair *KV_NewPointer(const char *key, void *value) {
+  KV_Pair *pair = KV_NewTypedPair(key, KV_TYPE_PTR);
+  pair->_value.ptr = value;
+  return pair;
+};
+
+KV_Pair *KV_NewColor(const char *key, KV_Color value) {
+  KV_Pair *pair = KV_NewTypedPair(key, KV_TYPE_COLOR);
+  pair->_value.color = value;
+  return pair;
+};
+
+KV_Pair *KV_NewUint64(const char *key, KV_uint64 value) {
+  KV_Pair *pair = KV_NewTypedPair(key, KV_TYPE_UINT64);
+  pair->_value.u64 = value;
+  return pair;
+};
+
+KV_Pair *KV_NewListFrom(const char *key, KV_Pair *list) {
+  /* Allocate the pair and set new values */
+  KV_Pool *pool = _poolThread;
+  KV_Pair *pair = KV_PoolNewPair(pool);
+
+  assert(list);
+
+  pair->_key = (key ? KV_PoolCopyString(pool, key, &pair->_flags, KV_PAIR_KEYPOOL) : NULL);
+  pair->_type = KV_TYPE_NONE;
+  KV_InitList(pair);
+  KV_CopyNodes(pair, list, KV_false);
+
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
+
+  return pair;
+};
+
+/* Free memory of the pair key without resetting the field */
+KV_INLINE void KV_FreeKey(KV_Pair *pair) {
+  if (pair->_key && !(pair->_flags & KV_PAIR_KEYREF)) KV_FreeString(pair->_key, pair->_flags, KV_PAIR_KEYPOOL);
+
+  /* Any new key is owned and allocated separately by default */
+  pair->_flags &= ~(KV_PAIR_KEYREF | KV_PAIR_KEYSYM | KV_PAIR_KEYPOOL);
+};
+
+/* Free all memory associated with the pair value without resetting any fields */
+KV_INLINE void KV_FreeValue(KV_Pair *pair) {
+  KV_Pair *pairDestroy;
+  KV_Pair *pairIter;
+
+  /* Destroy value */
+  switch (pair->_type) {
+    case KV_TYPE_NONE:
+      /* Contents that have never been parsed */
+      if (pair->_flags & KV_PAIR_LAZY) {
+        KV_ReleaseLazyList(pair);
+        break;
+      }
+
+      KV_FreeIndex(pair);
+      pairIter = pair->_value.head;
+
+      /* Destroy all pairs */
+      while (pairIter) {
+        pairDestroy = pairIter;
+        pairIter = pairIter->_next;
+
+        KV_PairDestroy(pairDestroy);
+      }
+      break;
+
+    case KV_TYPE_STRING:
+      if (!(pair->_flags & KV_PAIR_STRREF)) KV_FreeString(pair->_value.str, pair->_flags, KV_PAIR_STRPOOL);
+      break;
+
+    /* Typed values aren't stored anywhere else */
+    case KV_TYPE_INT: case KV_TYPE_FLOAT: case KV_TYPE_PTR: case KV_TYPE_COLOR: case KV_TYPE_UINT64:
+      break;
+
+    default:
+      assert(!"Unknown value type");
+      break;
+  }
+
+  /* Any new value is owned and allocated separately by default */
+  pair->_flags &= ~(KV_PAIR_STRREF | KV_PAIR_STRPOOL | KV_PAIR_LAZY);
+};
+
+void KV_PairDestroy(KV_Pair *pair) {
+  assert(pair);
+
+  /* Unlink the pair */
+  KV_Expunge(pair);
+
+  /* Clear the pair and free it */
+  KV_FreeKey(pair);
+  KV_FreeValue(pair);
+
+  /* Pairs from documents are freed together with them */
+  if (pair->_flags & KV_PAIR_ARENA) {
+    pair->_key = NULL;
+    pair->_type = KV_TYPE_NONE;
+    pair->_flags = KV_PAIR_ARENA;
+    KV_InitList(pair);
+    return;
+  }
+
+  /* Pooled pairs are reused by their pools */
+  if (pair->_flags & KV_PAIR_POOL) {
+    KV_PoolFree(pair);
+    return;
+  }
+
+  KV_free(pair);
+};
+
+KV_Pair *KV_PairCopy(KV_Pair *other) {
+  KV_Pool *pool = _poolThread;
+  KV_Pair *pair = KV_PoolNewPair(pool);
+
+  assert(other);
+
+  /* Interned keys are shared between all pairs */
+  if (other->_flags & KV_PAIR_KEYSYM) {
+    pair->_key = other->_key;
+    pair->_flags |= KV_PAIR_KEYREF | KV_PAIR_KEYSYM;
+  } else {
+    pair->_key = (other->_key ? KV_PoolCopyString(pool, other->_key, &pair->_flags, KV_PAIR_KEYPOOL) : NULL);
+  }
+
+  pair->_type = other->_type;
+
+  switch (pair->_type) {
+    case KV_TYPE_NONE:
+      KV_InitList(pair);
+      KV_CopyNodes(pair, other, KV_false);
+      break;
+
+    case KV_TYPE_STRING:
+      pair->_value.str = KV_PoolCopyString(pool, other->_value.str, &pair->_flags, KV_PAIR_STRPOOL);
+      break;
+
+    case KV_TYPE_INT: case KV_TYPE_FLOAT: case KV_TYPE_PTR: case KV_TYPE_COLOR: case KV_TYPE_UINT64:
+      pair->_value = other->_value;
+      break;
+
+    default:
+      assert(!"Unknown value type");
+      pair->_type = KV_TYPE_NONE;
+      KV_InitList(pair);
+      break;
+  }
+
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
+
+  return pair;
+};
+
+void KV_PairClear(KV_Pair *pair) {
+  assert(pair);
+
+  /* Free all memory */
+  KV_IndexUnlink(pair);
+  KV_FreeKey(pair);
+  KV_FreeValue(pair);
+
+  /* Reset the pair state but preserve the neighboring connections */
+  pair->_key = NULL;
+  pair->_type = KV_TYPE_NONE;
+  KV_InitList(pair);
+};
+
+/* Frees heap memory held by a document pair and its subpairs */
+static void KV_DocumentRelease(KV_Pair *pair) {
+  KV_Pair *pairIter, *pairNext;
+
+  KV_FreeKey(pair);
+  pair->_key = NULL;
+
+  if (pair->_type == KV_TYPE_NONE && !(pair->_flags & KV_PAIR_LAZY)) {
+    KV_FreeIndex(pair);
+    pairIter = pair->_value.head;
+
+    while (pairIter) {
+      pairNext = pairIter->_next;
+
+      /* Destroy pairs that have been added from the heap and only go through document pairs that need it */
+      if (!(pairIter->_flags & KV_PAIR_ARENA)) {
+        KV_PairDestroy(pairIter);
+
+      } else if (pairIter->_flags & KV_PAIR_DIRTY) {
+        KV_DocumentRelease(pairIter);
+      }
+
+      pairIter = pairNext;
+    }
+
+  } else {
+    KV_FreeValue(pair);
+    pair->_type = KV_TYPE_NONE;
+    KV_InitList(pair);
+  }
+
+  /* Don't release the same pair twice */
+  pair->_flags &= ~KV_PAIR_DIRTY;
+};
+
+void KV_SetKey(KV_Pair *pair, const char *key) {
+  unsigned int iFlags = 0;
+  char *keyCopy;
+
+  assert(pair);
+
+  /* Root pair */
+  if (!key) {
+    KV_IndexUnlink(pair);
+    KV_FreeKey(pair);
+    pair->_key = NULL;
+    return;
+  }
+
+  /* Copy the string beforehand in case it is the same */
+  keyCopy = KV_PoolCopyString(_poolThread, key, &iFlags, KV_PAIR_KEYPOOL);
+
+  KV_IndexUnlink(pair);
+  KV_FreeKey(pair);
+  pair->_key = keyCopy;
+  pair->_flags |= iFlags;
+  KV_IndexLink(pair);
+  KV_MarkDirty(pair);
+};
+
+void KV_SetString(KV_Pair *pair, const char *value) {
+  unsigned int iFlags = 0;
+  char *valueCopy;
+
+  assert(pair && value);
+
+  /* Copy the string beforehand in case it is the same, otherwise the data is wiped before it's copied */
+  valueCopy = KV_PoolCopyString(_poolThread, value, &iFlags, KV_PAIR_STRPOOL);
+
+  /* Clear last pair before setting a new one */
+  KV_FreeValue(pair);
+
+  pair->_type = KV_TYPE_STRING;
+  pair->_value.str = valueCopy;
+  pair->_flags |= iFlags;
+  KV_MarkDirty(pair);
+};
+
+/* Clears the last value before setting a new typed one */
+KV_INLINE void KV_SetType(KV_Pair *pair, KV_DataType type) {
+  assert(pair);
+
+  KV_FreeValue(pair);
+  pair->_type = type;
+};
+
+void KV_SetInt(KV_Pair *pair, int value) {
+  KV_SetType(pair, KV_TYPE_INT);
+  pair->_value.i = value;
+};
+
+void KV_SetFloat(KV_Pair *pair, float value) {
+  KV_SetType(pair, KV_TYPE_FLOAT);
+  pair->_value.f = value;
+};
+
+void KV_SetPointer(KV_Pair *pair, void *value) {
+  KV_SetType(pair, KV_TYPE_PTR);
+  pair->_value.ptr = value;
+};
+
+void KV_SetColor(KV_Pair *pair, KV_Color value) {
+  KV_SetType(pair, KV_TYPE_COLOR);
+  pair->_value.color = value;
+};
+
+void KV_SetUint64(KV_Pair *pair, KV_uint64 value) {
+  KV_SetType(pair, KV_TYPE_UINT64);
+  pair->_value.u64 = value;
+};
+
+void KV_SetListFrom(KV_Pair *pair, KV_Pair *list) {
+  assert(pair && list);
+
+  /* Clear last pair before setting a new one */
+  KV_FreeValue(pair);
+
+  pair->_type = KV_TYPE_NONE;
+  KV_InitList(pair);
+  KV_CopyNodes(pair, list, KV_false);
+};
+
+void KV_CopyNodes(KV_Pair *list, KV_Pair *other, KV_bool overwrite) {
+  KV_Pair *pairIter, *pairFind;
+  KV_bool bIndexed;
+  assert(list && other);
+
+  /* Set an entirely new list if the current value isn't a list */
+  if (list->_type != KV_TYPE_NONE) {
+    KV_FreeValue(list);
+
+    list->_type = KV_TYPE_NONE;
+    KV_InitList(list);
+  }
+
+  /* Nothing to copy into or from lists that couldn't be parsed */
+  if (!KV_EnsureParsed(list) || !KV_EnsureParsed(other)) return;
+
+  bIndexed = (KV_GetKeyIndex(list) ? KV_true : KV_false);
+
+  /* Add copies of all subpairs to this list */
+  for (pairIter = other->_value.head; pairIter; pairIter = pairIter->_next)
+  {
+    /* Replace duplicate keys */
+    if (overwrite && (pairFind = KV_FindSameKeyInBulk(list, pairIter))) {
+      KV_Replace(pairFind, pairIter);
+      continue;
+    }
+
+    KV_AddTail(list, KV_PairCopy(pairIter));
+  }
+
+  KV_EndBulkLookups(list, bIndexed);
+};
+
+void KV_MergeNodes(KV_Pair *list, KV_Pair *other, KV_bool moveNodes) {
+  KV_Pair *pairIter, *pairFind;
+  KV_bool bIndexed;
+  assert(list && other);
+
+  /* Both must be lists */
+  if (list->_type != KV_TYPE_NONE || other->_type != KV_TYPE_NONE) return;
+
+  /* Nothing to merge into or from lists that couldn't be parsed */
+  if (!KV_EnsureParsed(list) || !KV_EnsureParsed(other)) return;
+
+  /* Add copies of non-existent subpairs to this list */
+  bIndexed = (KV_GetKeyIndex(list) ? KV_true : KV_false);
+  pairIter = other->_value.head;
+
+  while (pairIter) {
+    /* Recursively merge existing subpairs */
+    if ((pairFind = KV_FindSameKeyInBulk(list, pairIter))) {
+      KV_MergeNodes(pairFind, pairIter, moveNodes);
+
+      /* Get the next subpair */
+      pairIter = pairIter->_next;
+      continue;
+    }
+
+    /* Remember the current subpair and get the next one */
+    pairFind = pairIter;
+    pairIter = pairIter->_next;
+
+    /* Move that subpair over to the current list instead of copying it */
+    if (moveNodes) {
+      KV_AddTail(list, pairFind);
+    } else {
+      KV_AddTail(list, KV_PairCopy(pairFind));
+    }
+  }
+
+  KV_EndBulkLookups(list, bIndexed);
+};
+
+void KV_Replace(KV_Pair *pair, KV_Pair *other) {
+  assert(pair && other);
+  if (pair == other) return;
+
+  /* Clear last value before setting a new one */
+  KV_FreeValue(pair);
+
+  pair->_type = other->_type;
+
+  switch (pair->_type) {
+    case KV_TYPE_NONE:
+      KV_InitList(pair);
+      KV_CopyNodes(pair, other, KV_false);
+      break;
+
+    case KV_TYPE_STRING:
+      pair->_value.str = KV_PoolCopyString(_poolThread, other->_value.str, &pair->_flags, KV_PAIR_STRPOOL);
+      KV_MarkDirty(pair);
+      break;
+
+    case KV_TYPE_INT: case KV_TYPE_FLOAT: case KV_TYPE_PTR: case KV_TYPE_COLOR: case KV_TYPE_UINT64:
+      pair->_value = other->_value;
+      break;
+
+    default:
+      assert(!"Unknown value type");
+      pair->_type = KV_TYPE_NONE;
+      KV_InitList(pair);
+      break;
+  }
+};
+
+/* Swap all struct data between two different pairs */
+KV_INLINE void KV_SwapWholePairs(KV_Pair *pair1, KV_Pair *pair2) {
+  KV_Pair temp = *pair1;
+  *pair1 = *pair2;
+  *pair2 = temp;
+};
+
+/* Relink all subpairs to the list they are in */
+KV_INLINE void KV_ReparentNodes(KV_Pair *list) {
+  KV_Pair *pairIter;
+  if (list->_type != KV_TYPE_NONE || (list->_flags & KV_PAIR_LAZY)) return;
+
+  for (pairIter = list->_value.head; pairIter; pairIter = pairIter->_next)
+  {
+    pairIter->_parent = list;
+  }
+};
+
+void KV_Swap(KV_Pair *pair1, KV_Pair *pair2) {
+  KV_Pair *parent1, *parent2;
+  KV_Pair *prev1, *prev2;
+  KV_Pair *next1, *next2;
+  unsigned int iFlags1, iFlags2;
+  KV_bool bReindex;
+
+  assert(pair1 && pair2);
+  if (pair1 == pair2) return;
+
+  /* Indexed lists are only affected if the keys are different */
+  bReindex = ((pair1->_parent && KV_GetKeyIndex(pair1->_parent)) || (pair2->_parent && KV_GetKeyIndex(pair2->_parent)))
+    && !KV_SameKeys(pair1, pair2);
+
+  if (bReindex) {
+    KV_IndexUnlink(pair1);
+    KV_IndexUnlink(pair2);
+  }
+
+  /* Remember the neighbors */
+  parent1 = pair1->_parent;
+  prev1 = pair1->_prev;
+  next1 = pair1->_next;
+  iFlags1 = pair1->_flags;
+
+  parent2 = pair2->_parent;
+  prev2 = pair2->_prev;
+  next2 = pair2->_next;
+  iFlags2 = pair2->_flags;
+
+  /* Swap the values */
+  KV_SwapWholePairs(pair1, pair2);
+
+  /* Restore the neighbors */
+  pair1->_parent = parent1;
+  pair1->_prev = prev1;
+  pair1->_next = next1;
+
+  pair2->_parent = parent2;
+  pair2->_prev = prev2;
+  pair2->_next = next2;
+
+  /* Subpairs have been swapped along with the values */
+  KV_ReparentNodes(pair1);
+  KV_ReparentNodes(pair2);
+
+  if (bReindex) {
+    KV_IndexLink(pair1);
+    KV_IndexLink(pair2);
+  }
+
+  /* Pairs themselves stay where they have been allocated */
+  pair1->_flags = (iFlags2 & ~(KV_PAIR_ARENA | KV_PAIR_POOL | KV_PAIR_DIRTY)) | (iFlags1 & (KV_PAIR_ARENA | KV_PAIR_POOL));
+  pair2->_flags = (iFlags1 & ~(KV_PAIR_ARENA | KV_PAIR_POOL | KV_PAIR_DIRTY)) | (iFlags2 & (KV_PAIR_ARENA | KV_PAIR_POOL));
+
+  /* Document pairs may now hold heap memory */
+  if ((iFlags2 & (KV_PAIR_ARENA | KV_PAIR_DIRTY)) != KV_PAIR_ARENA) KV_MarkDirty(pair1);
+  if ((iFlags1 & (KV_PAIR_ARENA | KV_PAIR_DIRTY)) != KV_PAIR_ARENA) KV_MarkDirty(pair2);
+};
+
+/* Amount of printed characters after which they are written into a sink */
+#define KV_SINK_CHUNKSIZE 65536
+
+/* Writes all printed characters into a sink and resets the printer */
+static KV_bool KV_PrinterFlush(KV_Printer *ctx, const KV_Sink *sink) {
+  size_t ct = ctx->_current - ctx->_buffer;
+
+  /* Custom sinks may not set errno */
+  errno = 0;
+
+  if (ct && !sink->_write(sink->_data, ctx->_buffer, ct)) {
+    KV_SetError(KV_ERROR_WRITE_SINK, errno);
+    return KV_false;
+  }
+
+  KV_PrinterResetString(ctx);
+  return KV_true;
+};
+
+/* Writes printed characters into a sink once there's a whole chunk of them */
+KV_INLINE KV_bool KV_PrinterFlushChunk(KV_Printer *ctx, const KV_Sink *sink) {
+  if (!sink || (size_t)(ctx->_current - ctx->_buffer) < KV_SINK_CHUNKSIZE) return KV_true;
+  return KV_PrinterFlush(ctx, sink);
+};
+
+/* Value of a number read by KV_ParseNumber() */
+typedef union _KV_Number {
+  int i;
+  float f;
+  KV_uint64 u64;
+} KV_Number;
+
+/* Powers of ten that are exactly representable as floats */
+static const double _afExactPowersOf10[11] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+};
+
+/* Smallest magnitude that rounds to infinity when converted to a float, i.e. FLT_MAX plus half of its last unit */
+#define KV_FLOAT_LIMIT 3.40282356779733661637539395458142568448e38
+
+/* Reads a float using strtod() with the decimal separator of the current locale in place of the point.
+ * Used only for numbers that cannot be computed exactly by KV_ParseNumber() itself.
+ * Returns KV_false if the number is too large to be a float.
+ */
+static KV_bool KV_ParseFloatSlow(const char *str, size_t len, float *out) {
+  const char *strPoint = localeconv()->decimal_point;
+  const size_t ctPoint = strlen(strPoint);
+  char strBuffer[64];
+  char *strCopy = strBuffer;
+  char *pch;
+  double d;
+
+  if (len + ctPoint >= sizeof(strBuffer)) strCopy = (char *)KV_malloc(len + ctPoint + 1);
+
+  for (pch = strCopy; len != 0; --len, ++str) {
+    if (*str == '.') {
+      memcpy(pch, strPoint, ctPoint);
+      pch += ctPoint;
+    } else {
+      *pch++ = *str;
+    }
+  }
+
+  *pch = '\0';
+  d = strtod(strCopy, NULL);
+
+  if (strCopy != strBuffer) KV_free(strCopy);
+
+  /* Too large to be a float */
+  if (d >= KV_FLOAT_LIMIT || d <= -KV_FLOAT_LIMIT) return KV_false;
+
+  *out = (float)d;
+  return KV_true;
+};
+
+/* Reads a number from an entire string the same way as KeyValues from Source SDK 2013 infers value types,
+ * regardless of the current locale.
+ * Returns KV_TYPE_INT, KV_TYPE_FLOAT or KV_TYPE_UINT64 on success or KV_TYPE_NONE if it's not a number of any of those types.
+ */
+static KV_DataType KV_ParseNumber(const char *str, KV_Number *num) {
+  const char *pch = str;
+  KV_uint64 iMantissa = 0;
+  int iExponent = 0, iExpValue = 0;
+  int ctDigits = 0, ctSignificant = 0;
+  KV_bool bNegative = KV_false, bExpNegative = KV_false, bFloat = KV_false, bTruncated = KV_false;
+  double d;
+  int i;
+
+  /* 64-bit integers are written as "0x" followed by exactly 16 hexadecimal digits */
+  if (str[0] == '0' && str[1] == 'x') {
+    for (i = 0, pch = str + 2; i < 16; ++i, ++pch) {
+      if      (*pch >= '0' && *pch <= '9') iMantissa = (iMantissa << 4) | (KV_uint64)(*pch - '0');
+      else if (*pch >= 'a' && *pch <= 'f') iMantissa = (iMantissa << 4) | (KV_uint64)(*pch - 'a' + 10);
+      else if (*pch >= 'A' && *pch <= 'F') iMantissa = (iMantissa << 4) | (KV_uint64)(*pch - 'A' + 10);
+      else return KV_TYPE_NONE;
+    }
+
+    if (*pch != '\0') return KV_TYPE_NONE;
+
+    num->u64 = iMantissa;
+    return KV_TYPE_UINT64;
+  }
+
+  if (*pch == '-' || *pch == '+') bNegative = (*pch++ == '-') ? KV_true : KV_false;
+
+  /* Collect up to 19 significant digits, which always fit into a 64-bit integer */
+  for (;; ++pch) {
+    if (*pch >= '0' && *pch <= '9') {
+      ++ctDigits;
+
+      if (ctSignificant < 19) {
+        iMantissa = iMantissa * 10 + (KV_uint64)(*pch - '0');
+        if (iMantissa != 0) ++ctSignificant;
+        if (bFloat) --iExponent;
+
+      } else {
+        if (*pch != '0') bTruncated = KV_true;
+        if (!bFloat) ++iExponent;
+      }
+
+    } else if (*pch == '.' && !bFloat) {
+      bFloat = KV_true;
+
+    } else {
+      break;
+    }
+  }
+
+  if (ctDigits == 0) return KV_TYPE_NONE;
+
+  /* Exponent */
+  if (*pch == 'e' || *pch == 'E') {
+    bFloat = KV_true;
+    ++pch;
+
+    if (*pch == '-' || *pch == '+') bExpNegative = (*pch++ == '-') ? KV_true : KV_false;
+    if (*pch < '0' || *pch > '9') return KV_TYPE_NONE;
+
+    for (; *pch >= '0' && *pch <= '9'; ++pch) {
+      /* Anything this large overflows or underflows a float anyway */
+      if (iExpValue < 10000) iExpValue = iExpValue * 10 + (*pch - '0');
+    }
+
+    iExponent += (bExpNegative ? -iExpValue : iExpValue);
+  }
+
+  if (*pch != '\0') return KV_TYPE_NONE;
+
+  if (!bFloat) {
+    /* Integers that don't fit into an int are left as strings */
+    if (ctSignificant > 10 || iMantissa > (bNegative ? (KV_uint64)INT_MAX + 1 : (KV_uint64)INT_MAX)) return KV_TYPE_NONE;
+
+    num->i = (bNegative && iMantissa != 0) ? -(int)(iMantissa - 1) - 1 : (int)iMantissa;
+    return KV_TYPE_INT;
+  }
+
+  /* Both the mantissa and the power of ten are exact floats, so a single double operation rounded down to a float
+   * gives the correctly rounded result */
+  if (iMantissa == 0 || (!bTruncated && iMantissa <= ((KV_uint64)1 << 24) && iExponent >= -10 && iExponent <= 10)) {
+    d = (double)iMantissa;
+
+    if (iMantissa == 0) {
+      /* Zero regardless of the exponent */
+    } else if (iExponent < 0) {
+      d /= _afExactPowersOf10[-iExponent];
+    } else {
+      d *= _afExactPowersOf10[iExponent];
+    }
+
+    num->f = (float)(bNegative ? -d : d);
+    return KV_TYPE_FLOAT;
+  }
+
+  /* Floats that overflow are left as strings */
+  if (!KV_ParseFloatSlow(str, (size_t)(pch - str), &num->f)) return KV_TYPE_NONE;
+  return KV_TYPE_FLOAT;
+};
+
+/* Maximum length of a typed value formatted by KV_FormatTypedValue(), including the null terminator */
+#define KV_TYPED_VALUE_LENGTH 32
+
+/* Formats an unsigned 64-bit integer as a decimal number without relying on printf() support for it.
+ * Returns length of the formatted number.
+ */
+static size_t KV_FormatUint64(char *str, KV_uint64 value) {
+  char strDigits[24];
+  size_t ct = 0, i;
+
+  do {
+    strDigits[ct++] = (char)('0' + (int)(value % 10));
+    value /= 10;
+  } while (value);
+
+  for (i = 0; i < ct; ++i) {
+    str[i] = strDigits[ct - 1 - i];
+  }
+
+  str[ct] = '\0';
+  return ct;
+};
+
+/* Formats a typed value of a pair into a string the same way as KeyValues::GetString() from Source SDK 2013,
+ * except for floats, which are printed with enough digits to be read back exactly instead of a fixed amount of decimals.
+ * Numbers are always formatted so that KV_ParseNumber() infers the same type and value from them.
+ * Returns length of the formatted value.
+ */
+static size_t KV_FormatTypedValue(KV_Pair *pair, char *str) {
+  const char *strPoint;
+  char *pch;
+  size_t ct;
+  int iPrecision;
+  KV_Number num;
+
+  switch (pair->_type) {
+    case KV_TYPE_INT:
+      return (size_t)sprintf(str, "%d", pair->_value.i);
+
+    case KV_TYPE_FLOAT:
+      strPoint = localeconv()->decimal_point;
+
+      /* Use as few digits as possible while still being able to read the exact value back */
+      for (iPrecision = 6; iPrecision <= 9; ++iPrecision) {
+        ct = (size_t)sprintf(str, "%.*g", iPrecision, (double)pair->_value.f);
+
+        /* Decimal separator may depend on the locale */
+        if (strPoint[0] != '.' && (pch = strstr(str, strPoint)) != NULL) {
+          *pch = '.';
+          memmove(pch + 1, pch + strlen(strPoint), ct - (size_t)(pch - str) - strlen(strPoint) + 1);
+          ct = strlen(str);
+        }
+
+        /* Whole numbers need a decimal point to be read back as floats */
+        if (strspn(str, "-0123456789") == ct) {
+          memcpy(str + ct, ".0", 3);
+          ct += 2;
+        }
+
+        if (KV_ParseNumber(str, &num) == KV_TYPE_FLOAT && num.f == pair->_value.f) break;
+      }
+      return ct;
+
+    case KV_TYPE_PTR:
+      return KV_FormatUint64(str, (KV_uint64)(size_t)pair->_value.ptr);
+
+    case KV_TYPE_COLOR:
+      return (size_t)sprintf(str, "%d %d %d %d", pair->_value.color.r, pair->_value.color.g, pair->_value.color.b, pair->_value.color.a);
+
+    case KV_TYPE_UINT64:
+      /* Always as 16 hexadecimal digits to distinguish it from other numbers */
+      str[0] = '0';
+      str[1] = 'x';
+
+      for (ct = 0; ct < 16; ++ct) {
+        str[2 + ct] = "0123456789ABCDEF"[(int)(pair->_value.u64 >> ((15 - ct) * 4)) & 0xF];
+      }
+
+      str[18] = '\0';
+      return 18;
+
+    default:
+      assert(!"Not a typed value");
+      str[0] = '\0';
+      return 0;
+  }
+};
+
+/* Prints a pair with all of its subpairs without recursion or any memory allocations besides expanding the buffer.
+ * Subpairs are walked in order by following links to neighboring and parent pairs.
+ * If 'sink' is non-NULL, printed characters are written into it in chunks instead of keeping all of them in the buffer.
+ */
+static KV_bool KV_PrintInternal(KV_Pair *root, KV_Printer *ctx, const char *indentation, const KV_Sink *sink) {
+  KV_Pair *pair = root;
+  size_t depth = 0;
+  char strValue[KV_TYPED_VALUE_LENGTH];
+  size_t ctValue;
+
+  assert(root);
+
+  for (;;) {
+    if (!KV_PrinterFlushChunk(ctx, sink)) return KV_false;
+
+    /* Print a key */
+    if (pair->_key) {
+      KV_PrinterAppendRepeated(ctx, indentation, depth);
+      KV_PrinterAppendQuoted(ctx, pair->_key, KV_false);
+    }
+
+    /* Print a value */
+    switch (pair->_type) {
+      case KV_TYPE_NONE: {
+        if (pair->_key) {
+          KV_PrinterAppend(ctx, "\n", 1);
+          KV_PrinterAppendRepeated(ctx, indentation, depth);
+          KV_PrinterAppend(ctx, "{\n", 2);
+        }
+
+        /* Lists that couldn't be parsed cannot be printed either */
+        if (!KV_EnsureParsed(pair)) return KV_false;
+
+        /* Print each pair in the list with extra indentation, unless it has no key (a root pair) */
+        if (pair->_value.head) {
+          if (pair->_key) ++depth;
+
+          pair = pair->_value.head;
+          continue;
+        }
+      } break;
+
+      case KV_TYPE_STRING: {
+        /* The value without key cannot be printed */
+        if (!pair->_key) {
+          KV_SetError(KV_ERROR_NO_KEY, 0);
+          return KV_false;
+        }
+
+        KV_PrinterAppend(ctx, indentation, strlen(indentation));
+        KV_PrinterAppendQuoted(ctx, pair->_value.str, KV_true);
+        KV_PrinterAppend(ctx, "\n", 1);
+      } break;
+
+      case KV_TYPE_INT: case KV_TYPE_FLOAT: case KV_TYPE_PTR: case KV_TYPE_COLOR: case KV_TYPE_UINT64: {
+        if (!pair->_key) {
+          KV_SetError(KV_ERROR_NO_KEY, 0);
+          return KV_false;
+        }
+
+        /* Typed values are printed as strings */
+        ctValue = KV_FormatTypedValue(pair, strValue);
+
+        KV_PrinterAppend(ctx, indentation, strlen(indentation));
+        KV_PrinterAppend(ctx, "\"", 1);
+        KV_PrinterAppend(ctx, strValue, ctValue);
+        KV_PrinterAppend(ctx, "\"\n", 2);
+      } break;
+
+      default: {
+        /* Unknown value type */
+        assert(!"Unknown value type");
+
+        KV_SetError(KV_ERROR_UNKNOWN_TYPE, 0);
+        return KV_false;
+      }
+    }
+
+    /* Close finished lists up the hierarchy until there's a next pair to print */
+    for (;;) {
+      if (pair->_type == KV_TYPE_NONE && pair->_key) {
+        if (!KV_PrinterFlushChunk(ctx, sink)) return KV_false;
+
+        KV_PrinterAppendRepeated(ctx, indentation, depth);
+        KV_PrinterAppend(ctx, "}\n", 2);
+      }
+
+      if (pair == root) return KV_true;
+
+      if (pair->_next) {
+        pair = pair->_next;
+        break;
+      }
+
+      pair = pair->_parent;
+      if (pair->_key) --depth;
+    }
+  }
+};
+
+char *KV_Print(KV_Pair *pair, size_t *length, size_t expansionstep, const char *indentation) {
+  KV_Printer printer;
+  KV_PrinterInit(&printer, expansionstep);
+
+  if (KV_PrintInternal(pair, &printer, indentation, NULL)) {
+    if (length) *length = (size_t)(printer._current - printer._buffer);
+    return KV_PrinterGetBuffer(&printer, NULL);
+  }
+
+  /* Free buffer on error */
+  KV_PrinterClear(&printer);
+  return NULL;
+};
+
+KV_bool KV_PrintToSink(KV_Pair *pair, const KV_Sink *sink, const char *indentation) {
+  KV_Printer printer;
+  KV_bool bResult;
+
+  assert(pair && sink && sink->_write);
+  KV_PrinterInit(&printer, KV_SINK_CHUNKSIZE);
+
+  bResult = KV_PrintInternal(pair, &printer, indentation, sink);
+  if (bResult) bResult = KV_PrinterFlush(&printer, sink);
+
+  KV_PrinterClear(&printer);
+  return bResult;
+};
+
+static KV_bool KV_WriteFile(void *data, const char *str, size_t length) {
+  return (fwrite(str, 1, length, (FILE *)data) == length) ? KV_true : KV_false;
+};
+
+void KV_SinkSetupFile(KV_Sink *sink, FILE *file) {
+  sink->_write = KV_WriteFile;
+  sink->_data = file;
+};
+
+static KV_bool KV_WriteDescriptor(void *data, const char *str, size_t length) {
+#if defined(KV_USE_POSIX_IO)
+  int fd = (int)(size_t)data;
+  ssize_t ct;
+
+  /* Keep writing until everything has been written */
+  while (length) {
+    ct = write(fd, str, length);
+
+    if (ct < 0) {
+      if (errno == EINTR) continue;
+      return KV_false;
+    }
+
+    str += ct;
+    length -= (size_t)ct;
+  }
+
+  return KV_true;
+
+#elif defined(_WIN32)
+  int fd = (int)(size_t)data;
+  int ct;
+
+  while (length) {
+    ct = _write(fd, str, (unsigned int)(length > 0x40000000 ? 0x40000000 : length));
+    if (ct < 0) return KV_false;
+
+    str += ct;
+    length -= (size_t)ct;
+  }
+
+  return KV_true;
+
+#else
+  /* No file descriptors */
+  (void)data; (void)str; (void)length;
+  return KV_false;
+#endif
+};
+
+void KV_SinkSetupDescriptor(KV_Sink *sink, int fd) {
+  sink->_write = KV_WriteDescriptor;
+  sink->_data = (void *)(size_t)fd;
+};
+
+static KV_bool KV_WritePrinter(void *data, const char *str, size_t length) {
+  KV_PrinterAppend((KV_Printer *)data, str, length);
+  return KV_true;
+};
+
+void KV_SinkSetupPrinter(KV_Sink *sink, KV_Printer *printer) {
+  sink->_write = KV_WritePrinter;
+  sink->_data = printer;
+};
+
+/*********************************************************************************************************************************
+ * Doubly linked lists
+ *********************************************************************************************************************************/
+
+KV_bool KV_HasNodes(KV_Pair *list) {
+  /* Not a list */
+  assert(list);
+  if (list->_type != KV_TYPE_NONE) return KV_false;
+
+  if (!KV_EnsureParsed(list)) return KV_false;
+  return list->_value.head ? KV_true : KV_false;
+};
+
+size_t KV_GetNodeCount(KV_Pair *list) {
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return (size_t)(-1);
+
+  if (!KV_EnsureParsed(list)) return 0;
+  return list->_value.count;
+};
+
+KV_Pair *KV_GetPair(KV_Pair *list, size_t n) {
+  KV_Pair *pair;
+  size_t ctFromTail;
+
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return NULL;
+
+  if (!KV_EnsureParsed(list) || n >= list->_value.count) return NULL;
+  if (list->_value.index && list->_value.index->aNodes) return list->_value.index->aNodes[n];
+
+  ctFromTail = list->_value.count - n - 1;
+
+  /* Put subpairs of a wide list into an array if the one in question is far from both ends */
+  if (_ctIndexThreshold && n >= _ctIndexThreshold && ctFromTail >= _ctIndexThreshold) {
+    KV_BuildNodes(list);
+    return list->_value.index->aNodes[n];
+  }
+
+  /* Walk from the closer end */
+  if (n <= ctFromTail) {
+    for (pair = list->_value.head; n; --n) pair = pair->_next;
+  } else {
+    for (pair = list->_value.tail; ctFromTail; --ctFromTail) pair = pair->_prev;
+  }
+
+  return pair;
+};
+
+KV_Pair *KV_FindPair(KV_Pair *list, const char *key) {
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return NULL;
+
+  if (!KV_EnsureParsed(list)) return NULL;
+  return KV_FindKey(list, key, KV_LookupSymbol(key));
+};
+
+KV_Pair *KV_FindPairOfType(KV_Pair *list, const char *key, KV_DataType type) {
+  KV_Pair *pair;
+  const char *sym;
+  size_t ct;
+
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return NULL;
+
+  if (!KV_EnsureParsed(list)) return NULL;
+  sym = KV_LookupSymbol(key);
+  pair = KV_FindKey(list, key, sym);
+
+  if (!pair || pair->_type == type) return pair;
+
+  /* Amount of other subpairs under the same key, if the list is indexed */
+  ct = (size_t)-1;
+  if (KV_GetKeyIndex(list)) ct = KV_IndexSlot(list->_value.index, key, sym, KV_HashString(key, strlen(key)))->count - 1;
+
+  /* Look through the rest of them */
+  for (pair = pair->_next; pair && ct != 0; pair = pair->_next)
+  {
+    if (!KV_IsKey(pair, key, sym)) continue;
+
+    if (pair->_type == type) return pair;
+    --ct;
+  }
+
+  return NULL;
+};
+
+KV_bool KV_IsEmpty(KV_Pair *list, const char *key) {
+  KV_Pair *pair = KV_FindPair(list, key);
+
+  /* No pair found */
+  if (!pair) return KV_true;
+
+  /* Has a value */
+  if (pair->_type != KV_TYPE_NONE) return KV_false;
+
+  /* Has no subpairs */
+  return KV_HasNodes(pair) ? KV_false : KV_true;
+};
+
+const char *KV_FindString(KV_Pair *list, const char *key, const char *defaultValue) {
+  KV_Pair *pair = KV_FindPairOfType(list, key, KV_TYPE_STRING);
+  return (pair ? pair->_value.str : defaultValue);
+};
+
+/* Reads a number from a numeric pair or a string pair that contains one.
+ * Returns type of the number or KV_TYPE_NONE if the pair doesn't have one.
+ */
+static KV_DataType KV_GetNumber(KV_Pair *pair, KV_Number *num) {
+  if (!pair) return KV_TYPE_NONE;
+
+  switch (pair->_type) {
+    case KV_TYPE_STRING: return KV_ParseNumber(pair->_value.str, num);
+    case KV_TYPE_INT: num->i = pair->_value.i; return KV_TYPE_INT;
+    case KV_TYPE_FLOAT: num->f = pair->_value.f; return KV_TYPE_FLOAT;
+    case KV_TYPE_UINT64: num->u64 = pair->_value.u64; return KV_TYPE_UINT64;
+    default: return KV_TYPE_NONE;
+  }
+};
+
+int KV_FindInt(KV_Pair *list, const char *key, int defaultValue) {
+  KV_Number num;
+
+  switch (KV_GetNumber(KV_FindPair(list, key), &num)) {
+    case KV_TYPE_INT: return num.i;
+    case KV_TYPE_UINT64: return (num.u64 > (KV_uint64)INT_MAX) ? INT_MAX : (int)num.u64;
+
+    case KV_TYPE_FLOAT:
+      if (num.f != num.f) return defaultValue; /* NaN */
+      if (num.f >= 2147483648.0f) return INT_MAX;
+      if (num.f <= -2147483648.0f) return INT_MIN;
+      return (int)num.f;
+
+    default: return defaultValue;
+  }
+};
+
+float KV_FindFloat(KV_Pair *list, const char *key, float defaultValue) {
+  KV_Number num;
+
+  switch (KV_GetNumber(KV_FindPair(list, key), &num)) {
+    case KV_TYPE_INT: return (float)num.i;
+    case KV_TYPE_FLOAT: return num.f;
+    case KV_TYPE_UINT64: return (float)num.u64;
+    default: return defaultValue;
+  }
+};
+
+KV_uint64 KV_FindUint64(KV_Pair *list, const char *key, KV_uint64 defaultValue) {
+  KV_Number num;
+
+  switch (KV_GetNumber(KV_FindPair(list, key), &num)) {
+    case KV_TYPE_INT: return (num.i < 0) ? 0 : (KV_uint64)num.i;
+    case KV_TYPE_UINT64: return num.u64;
+
+    case KV_TYPE_FLOAT:
+      if (num.f != num.f) return defaultValue; /* NaN */
+      if (num.f <= 0.0f) return 0;
+      if (num.f >= 18446744073709551616.0f) return ~(KV_uint64)0;
+      return (KV_uint64)num.f;
+
+    default: return defaultValue;
+  }
+};
+
+KV_Color KV_FindColor(KV_Pair *list, const char *key, KV_Color defaultValue) {
+  KV_Pair *pair = KV_FindPair(list, key);
+  unsigned char aComponents[4];
+  const char *pch;
+  char *pchEnd;
+  long iComponent;
+  int ct;
+
+  if (!pair) return defaultValue;
+  if (pair->_type == KV_TYPE_COLOR) return pair->_value.color;
+  if (pair->_type != KV_TYPE_STRING) return defaultValue;
+
+  /* Three or four components separated by whitespace */
+  pch = pair->_value.str;
+  aComponents[3] = 255;
+
+  for (ct = 0; ct < 4; ++ct) {
+    while (*pch == ' ' || *pch == '\t') ++pch;
+    if (*pch < '0' || *pch > '9') break;
+
+    iComponent = strtol(pch, &pchEnd, 10);
+    if (iComponent > 255) return defaultValue;
+
+    aComponents[ct] = (unsigned char)iComponent;
+    pch = pchEnd;
+  }
+
+  while (*pch == ' ' || *pch == '\t') ++pch;
+  if (ct < 3 || *pch != '\0') return defaultValue;
+
+  defaultValue.r = aComponents[0];
+  defaultValue.g = aComponents[1];
+  defaultValue.b = aComponents[2];
+  defaultValue.a = aComponents[3];
+  return defaultValue;
+};
+
+KV_Pair *KV_GetHead(KV_Pair *list) {
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return NULL;
+
+  if (!KV_EnsureParsed(list)) return NULL;
+  return list->_value.head;
+};
+
+KV_Pair *KV_GetTail(KV_Pair *list) {
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return NULL;
+
+  if (!KV_EnsureParsed(list)) return NULL;
+  return list->_value.tail;
+};
+
+/* Marks the list of a newly linked subpair, if the subpair holds heap memory */
+KV_INLINE void KV_MarkLinked(KV_Pair *pair) {
+  if ((pair->_flags & (KV_PAIR_ARENA | KV_PAIR_DIRTY)) != KV_PAIR_ARENA) KV_MarkDirty(pair->_parent);
+};
+
+/* Setup the very first pair in a list */
+KV_INLINE void KV_SetFirstPair(KV_Pair *pair, KV_Pair *first) {
+  pair->_value.head = pair->_value.tail = first;
+
+  /* Relink the pair to this list */
+  KV_Expunge(first);
+  first->_parent = pair;
+  KV_NodeAdded(first);
+  KV_MarkLinked(first);
+};
+
+void KV_AddHead(KV_Pair *list, KV_Pair *other) {
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return;
+
+  /* Adding subpairs would discard unparsed contents */
+  if (!KV_EnsureParsed(list)) return;
+
+  /* Insert at the beginning if there is already a list */
+  if (list->_value.head) {
+    KV_InsertBefore(other, list->_value.head);
+  } else {
+    KV_SetFirstPair(list, other);
+  }
+};
+
+void KV_AddTail(KV_Pair *list, KV_Pair *other) {
+  /* Not a list */
+  assert(list);
+  assert(list->_type == KV_TYPE_NONE);
+  if (list->_type != KV_TYPE_NONE) return;
+
+  /* Adding subpairs would discard unparsed contents */
+  if (!KV_EnsureParsed(list)) return;
+
+  /* Insert at the end if there is already a list */
+  if (list->_value.tail) {
+    KV_InsertAfter(other, list->_value.tail);
+  } else {
+    KV_SetFirstPair(list, other);
+  }
+};
+
+/* Unlink a pair from its previous neighbor */
+KV_INLINE void KV_UnlinkPrev(KV_Pair *pair) {
+  if (pair->_prev != NULL) pair->_prev->_next = NULL;
+  pair->_prev = NULL;
+};
+
+/* Unlink a pair from its next neighbor */
+KV_INLINE void KV_UnlinkNext(KV_Pair *pair) {
+  if (pair->_next != NULL) pair->_next->_prev = NULL;
+  pair->_next = NULL;
+};
+
+void KV_InsertBefore(KV_Pair *pair, KV_Pair *other) {
+  KV_Pair *before;
+  assert(pair && other);
+
+  /* Remove from the current list and borrow the new parent */
+  KV_Expunge(pair);
+  pair->_parent = other->_parent;
+
+  /* Relink the parent to this new node */
+  if (other->_parent->_value.head == other) {
+    other->_parent->_value.head = pair;
+  }
+
+  /* Remember the node that goes before this one (may be NULL) */
+  before = other->_prev;
+  KV_UnlinkPrev(other);
+
+  /* Link the other node after this one */
+  other->_prev = pair;
+  pair->_next = other;
+
+  /* Link the node that goes before */
+  if (before) {
+    pair->_prev = before;
+    before->_next = pair;
+  }
+
+  KV_NodeAdded(pair);
+  KV_MarkLinked(pair);
+};
+
+void KV_InsertAfter(KV_Pair *pair, KV_Pair *other) {
+  KV_Pair *after;
+  assert(pair && other);
+
+  /* Remove from the current list and borrow the new parent */
+  KV_Expunge(pair);
+  pair->_parent = other->_parent;
+
+  /* Relink the parent to this new node */
+  if (other->_parent->_value.tail == other) {
+    other->_parent->_value.tail = pair;
+  }
+
+  /* Remember the node that goes after this one (may be NULL) */
+  after = other->_next;
+  KV_UnlinkNext(other);
+
+  /* Link the other node before this one */
+  other->_next = pair;
+  pair->_prev = other;
+
+  /* Link the node that goes after */
+  if (after) {
+    pair->_next = after;
+    after->_prev = pair;
+  }
+
+  KV_NodeAdded(pair);
+  KV_MarkLinked(pair);
+};
+
+void KV_Expunge(KV_Pair *pair) {
+  assert(pair);
+
+  if (pair->_parent) KV_NodeRemoved(pair);
+
+  /* Link neighboring pairs together */
+  if (pair->_prev) pair->_prev->_next = pair->_next;
+  if (pair->_next) pair->_next->_prev = pair->_prev;
+
+  /* Relink list head and tail */
+  if (pair->_parent) {
+    if (pair->_parent->_value.head == pair) {
+      pair->_parent->_value.head = pair->_next;
+    }
+
+    if (pair->_parent->_value.tail == pair) {
+      pair->_parent->_value.tail = pair->_prev;
+    }
+  }
+
+  /* Reset the links */
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
+};
+
+KV_Pair *KV_GetPrev(KV_Pair *pair) {
+  assert(pair);
+  return pair->_prev;
+};
+
+KV_Pair *KV_GetNext(KV_Pair *pair) {
+  assert(pair);
+  return pair->_next;
+};
+
+/*********************************************************************************************************************************
+ * Queries
+ *********************************************************************************************************************************/
+
+/* One key in the path of a compiled query */
+typedef struct _KV_QueryStep {
+  const char *key; /* Key of subpairs to match or NULL to match subpairs under any key */
+  size_t length;
+  size_t hash; /* Same hash as the one used by key indices and the symbol table */
+  size_t n; /* Index of the only subpair to match or -1 to match all of them */
+} KV_QueryStep;
+
+/* Steps from the outermost list inward, which are followed by their keys in the same memory block */
+struct _KV_Query {
+  KV_QueryStep *aSteps;
+  size_t ctSteps;
+};
+
+KV_Query *KV_CompileQuery(const char *path) {
+  const char *pch;
+  size_t ctMaxSteps = 1;
+  KV_Query *query;
+  KV_QueryStep *step;
+  char *strKey;
+
+  assert(path);
+
+  /* Every slash may begin another step and every character may go into a key */
+  for (pch = path; *pch; ++pch) {
+    if (*pch == '/') ++ctMaxSteps;
+  }
+
+  query = (KV_Query *)KV_malloc(sizeof(KV_Query) + ctMaxSteps * sizeof(KV_QueryStep) + (size_t)(pch - path) + ctMaxSteps);
+  query->aSteps = (KV_QueryStep *)(query + 1);
+  query->ctSteps = 0;
+  strKey = (char *)(query->aSteps + ctMaxSteps);
+
+  for (pch = path;; ++pch) {
+    step = &query->aSteps[query->ctSteps++];
+
+    /* Any key */
+    if (*pch == '*' && (pch[1] == '\0' || pch[1] == '/' || pch[1] == '[')) {
+      ++pch;
+      step->key = NULL;
+      step->length = step->hash = 0;
+
+    } else {
+      step->key = strKey;
+
+      while (*pch != '\0' && *pch != '/' && *pch != '[') {
+        if (*pch == ']') goto invalid;
+
+        /* Take the escaped character as is */
+        if (*pch == '\\' && *++pch == '\0') goto invalid;
+
+        *strKey++ = *pch++;
+      }
+
+      /* No key */
+      if (strKey == step->key) goto invalid;
+
+      step->length = (size_t)(strKey - step->key);
+      step->hash = KV_HashString(step->key, step->length);
+      *strKey++ = '\0';
+    }
+
+    /* Index selector */
+    step->n = (size_t)-1;
+
+    if (*pch == '[') {
+      ++pch;
+      if (*pch < '0' || *pch > '9') goto invalid;
+
+      for (step->n = 0; *pch >= '0' && *pch <= '9'; ++pch) {
+        /* Too large */
+        if (step->n > ((size_t)-2 - 9) / 10) goto invalid;
+
+        step->n = step->n * 10 + (size_t)(*pch - '0');
+      }
+
+      if (*pch++ != ']') goto invalid;
+    }
+
+    if (*pch == '\0') return query;
+    if (*pch != '/') goto invalid;
+  }
+
+invalid:
+  KV_free(query);
+  KV_SetError(KV_ERROR_QUERY_SYNTAX, 0);
+  return NULL;
+};
+
+void KV_QueryDestroy(KV_Query *query) {
+  assert(query);
+  KV_free(query);
+};
+
+/* Returns an interned copy of a step key or NULL if it's not in the symbol table */
+KV_INLINE const char *KV_QuerySymbol(const KV_QueryStep *step) {
+  if (!_ctSymbols) return NULL;
+
+  return KV_FindSymbolSlot(step->key, step->length, step->hash)->str;
+};
+
+/* Finds the next subpair under the key of a query step after some pair in the same list */
+KV_INLINE KV_Pair *KV_QueryNextKey(const KV_QueryStep *step, const char *sym, KV_Pair *pair) {
+  for (pair = pair->_next; pair; pair = pair->_next) {
+    if (pair->_key && KV_IsKey(pair, step->key, sym)) return pair;
+  }
+
+  return NULL;
+};
+
+/* Returns the first subpair in a list that matches a query step or NULL if the pair isn't a list or has no such subpairs */
+static KV_Pair *KV_QueryStepFirst(const KV_QueryStep *step, KV_Pair *list) {
+  KV_IndexEntry *entry;
+  KV_Pair *pair;
+  const char *sym;
+  size_t n;
+
+  if (list->_type != KV_TYPE_NONE || !KV_EnsureParsed(list)) return NULL;
+
+  /* Any key */
+  if (!step->key) return (step->n == (size_t)-1) ? list->_value.head : KV_GetPair(list, step->n);
+
+  sym = KV_QuerySymbol(step);
+
+  if (KV_GetKeyIndex(list)) {
+    entry = KV_IndexSlot(list->_value.index, step->key, sym, step->hash);
+
+    /* Not enough subpairs under the key */
+    if (!entry->pair || (step->n != (size_t)-1 && step->n >= entry->count)) return NULL;
+    pair = entry->pair;
+
+  } else {
+    pair = KV_FindKey(list, step->key, sym);
+  }
+
+  if (step->n == (size_t)-1) return pair;
+
+  for (n = step->n; pair && n != 0; --n) {
+    pair = KV_QueryNextKey(step, sym, pair);
+  }
+
+  return pair;
+};
+
+/* Returns the next subpair in the same list that matches a query step after a pair that matches it */
+static KV_Pair *KV_QueryStepNext(const KV_QueryStep *step, KV_Pair *pair) {
+  KV_Index *index;
+  const char *sym;
+
+  /* Index selectors only match one subpair */
+  if (step->n != (size_t)-1) return NULL;
+
+  /* Any key */
+  if (!step->key) return pair->_next;
+
+  sym = KV_QuerySymbol(step);
+
+  /* Indexed lists know when there are no other subpairs under the key */
+  index = KV_GetKeyIndex(pair->_parent);
+  if (index && KV_IndexSlot(index, step->key, sym, step->hash)->count == 1) return NULL;
+
+  return KV_QueryNextKey(step, sym, pair);
+};
+
+/* Matches subpairs of a query within a list in order, going through nested lists depth first without any allocations.
+ * Returns the amount of matched subpairs after stopping at 'ctStop' of them.
+ */
+static size_t KV_RunQuery(const KV_Query *query, KV_Pair *list, KV_Pair **aResults, size_t ctResults, size_t ctStop) {
+  const KV_QueryStep *aSteps = query->aSteps;
+  const size_t iLastStep = query->ctSteps - 1;
+  KV_Pair *pair, *pairNext;
+  size_t iStep = 0;
+  size_t ct = 0;
+
+  pair = KV_QueryStepFirst(&aSteps[0], list);
+
+  while (pair) {
+    if (iStep != iLastStep) {
+      /* Go into the first matching subpair */
+      pairNext = KV_QueryStepFirst(&aSteps[iStep + 1], pair);
+
+      if (pairNext) {
+        pair = pairNext;
+        ++iStep;
+        continue;
+      }
+
+    } else {
+      if (ct < ctResults) aResults[ct] = pair;
+      if (++ct == ctStop) break;
+    }
+
+    /* Move on to the next matching subpair, going back out of lists that have none left */
+    for (;;) {
+      pairNext = KV_QueryStepNext(&aSteps[iStep], pair);
+      if (pairNext || iStep == 0) break;
+
+      pair = pair->_parent;
+      --iStep;
+    }
+
+    pair = pairNext;
+  }
+
+  return ct;
+};
+
+KV_Pair *KV_QueryFirst(const KV_Query *query, KV_Pair *list) {
+  KV_Pair *pair;
+
+  assert(query && list);
+  assert(list->_type == KV_TYPE_NONE);
+
+  if (!KV_RunQuery(query, list, &pair, 1, 1)) return NULL;
+  return pair;
+};
+
+size_t KV_QueryAll(const KV_Query *query, KV_Pair *list, KV_Pair **results, size_t count) {
+  assert(query && list);
+  assert(list->_type == KV_TYPE_NONE);
+
+  return KV_RunQuery(query, list, results, (results ? count : 0), (size_t)-1);
+};
+
+/*********************************************************************************************************************************
+ * Pair values
+ *********************************************************************************************************************************/
+
+char *KV_GetKey(KV_Pair *pair) {
+  assert(pair);
+  return pair->_key;
+};
+
+KV_DataType KV_GetDataType(KV_Pair *pair) {
+  assert(pair);
+  return pair->_type;
+};
+
+char *KV_GetString(KV_Pair *pair) {
+  assert(pair);
+  assert(pair->_type == KV_TYPE_STRING);
+  return pair->_value.str;
+};
+
+int KV_GetInt(KV_Pair *pair) {
+  assert(pair);
+  assert(pair->_type == KV_TYPE_INT);
+  return pair->_value.i;
+};
+
+float KV_GetFloat(KV_Pair *pair) {
+  assert(pair);
+  assert(pair->_type == KV_TYPE_FLOAT);
+  return pair->_value.f;
+};
+
+void *KV_GetPointer(KV_Pair *pair) {
+  assert(pair);
+  assert(pair->_type == KV_TYPE_PTR);
+  return pair->_value.ptr;
+};
+
+KV_Color KV_GetColor(KV_Pair *pair) {
+  assert(pair);
+  assert(pair->_type == KV_TYPE_COLOR);
+  return pair->_value.color;
+};
+
+KV_uint64 KV_GetUint64(KV_Pair *pair) {
+  assert(pair);
+  assert(pair->_type == KV_TYPE_UINT64);
+  return pair->_value.u64;
+};
+
+/*********************************************************************************************************************************
+ * Include cache
+ *********************************************************************************************************************************/
+
+/* Size and modification time of a file at the moment of parsing it */
+typedef struct _KV_FileStamp {
+  char *path; /* Resolved path to the file */
+  size_t size;
+  time_t mtime;
+  long mtimens; /* Nanoseconds of the modification time, where available */
+} KV_FileStamp;
+
+/* Parsed file in the include cache */
+typedef struct _KV_IncludeEntry {
+  struct _KV_IncludeEntry *prev; /* More recently used file */
+  struct _KV_IncludeEntry *next; /* Less recently used file */
+
+  char *directory; /* Directory that the nested includes have been resolved from */
+  unsigned int flags; /* Parser flags, see KV_GetIncludeFlags() */
+  KV_bool cacheable; /* Whether all nested includes could be stamped as well */
+
+  /* Stamp of the file itself, followed by the stamps of all files that it includes */
+  KV_FileStamp *aStamps;
+  size_t ctStamps;
+  size_t ctStampsArray;
+
+  KV_Document *doc; /* Storage for the parsed list */
+  KV_Pair *list;
+  size_t bytes; /* Amount of memory used by the entry */
+} KV_IncludeEntry;
+
+/* Most and least recently used files */
+static KV_IncludeEntry *_entryFirst = NULL;
+static KV_IncludeEntry *_entryLast = NULL;
+
+/* File that's currently being parsed for the cache, which collects stamps of the files it includes */
+static KV_IncludeEntry *_entryParsing = NULL;
+
+static size_t _ctIncludeCacheLimit = 0;
+static KV_IncludeCacheStats _statsIncludeCache = { 0, 0, 0, 0, 0 };
+
+/* Returns a resolved copy of a path to an existing file or NULL if it cannot be resolved */
+static char *KV_ResolvePath(const char *path) {
+  char *strResolved, *str;
+
+#if defined(KV_USE_POSIX_IO)
+  strResolved = realpath(path, NULL);
+#elif defined(_WIN32)
+  strResolved = _fullpath(NULL, path, 0);
+#else
+  strResolved = NULL;
+#endif
+
+  if (!strResolved) return NULL;
+
+  /* Allocated by the standard library */
+  str = KV_strdup(strResolved);
+  free(strResolved);
+
+  return str;
+};
+
+/* Retrieves the size and the modification time of a regular file without changing the path of the stamp.
+ * Returns KV_false if the file cannot be stamped.
+ */
+static KV_bool KV_StampFile(KV_FileStamp *stamp, const char *path) {
+#if defined(KV_USE_POSIX_IO) || defined(_WIN32)
+  struct stat st;
+
+  /* Only regular files stay the same between reads */
+  if (stat(path, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) return KV_false;
+
+  stamp->size = (size_t)st.st_size;
+  stamp->mtime = st.st_mtime;
+
+  #if defined(__APPLE__)
+    stamp->mtimens = (long)st.st_mtimespec.tv_nsec;
+  #elif defined(KV_USE_POSIX_IO) && defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L
+    stamp->mtimens = (long)st.st_mtim.tv_nsec;
+  #else
+    stamp->mtimens = 0;
+  #endif
+
+  return KV_true;
+
+#else
+  (void)stamp;
+  (void)path;
+  return KV_false;
+#endif
+};
+
+/* Check if two stamps of the same file are the same */
+KV_INLINE KV_bool KV_SameStamps(const KV_FileStamp *stamp1, const KV_FileStamp *stamp2) {
+  return (stamp1->size == stamp2->size && stamp1->mtime == stamp2->mtime && stamp1->mtimens == stamp2->mtimens)
+    ? KV_true : KV_false;
+};
+
+/* Packs context flags that affect parsed lists */
+KV_INLINE unsigned int KV_GetIncludeFlags(const KV_Context *ctx) {
+  return (ctx->_escapeseq ? 0x1 : 0) | (ctx->_multikey ? 0x2 : 0) | (ctx->_overwrite ? 0x4 : 0) | (ctx->_symbols ? 0x8 : 0)
+       | (ctx->_types ? 0x10 : 0);
+};
+
+/* Creates a new entry for a file that's about to be parsed, which takes ownership of the stamp path */
+static KV_IncludeEntry *KV_NewIncludeEntry(const char *directory, unsigned int flags, const KV_FileStamp *stamp) {
+  KV_IncludeEntry *entry = (KV_IncludeEntry *)KV_malloc(sizeof(KV_IncludeEntry));
+
+  entry->prev = entry->next = NULL;
+  entry->directory = KV_strdup(directory);
+  entry->flags = flags;
+  entry->cacheable = KV_true;
+
+  entry->ctStampsArray = 4;
+  entry->aStamps = (KV_FileStamp *)KV_malloc(entry->ctStampsArray * sizeof(KV_FileStamp));
+  entry->aStamps[0] = *stamp;
+  entry->ctStamps = 1;
+
+  /* Blocks that fit small files entirely */
+  entry->doc = KV_NewDocument(stamp->size < 4096 ? 4096 : KV_DOCUMENT_BLOCKSIZE);
+  entry->list = NULL;
+  entry->bytes = 0;
+
+  return entry;
+};
+
+/* Frees an entry that isn't in the cache */
+static void KV_FreeIncludeEntry(KV_IncludeEntry *entry) {
+  size_t i;
+
+  for (i = 0; i < entry->ctStamps; ++i) {
+    KV_free(entry->aStamps[i].path);
+  }
+
+  KV_free(entry->aStamps);
+  KV_free(entry->directory);
+  KV_DocumentDestroy(entry->doc);
+  KV_free(entry);
+};
+
+/* Remembers stamps of all files that make up a cached list in another entry that's being parsed */
+static void KV_AddIncludeStamps(KV_IncludeEntry *entry, const KV_IncludeEntry *other) {
+  size_t iOther, i;
+
+  for (iOther = 0; iOther < other->ctStamps; ++iOther) {
+    /* Already depends on this file */
+    for (i = 0; i < entry->ctStamps; ++i) {
+      if (!strcmp(entry->aStamps[i].path, other->aStamps[iOther].path)) break;
+    }
+
+    if (i != entry->ctStamps) continue;
+
+    if (entry->ctStamps == entry->ctStampsArray) {
+      entry->ctStampsArray *= 2;
+      entry->aStamps = (KV_FileStamp *)KV_realloc(entry->aStamps, entry->ctStampsArray * sizeof(KV_FileStamp));
+    }
+
+    entry->aStamps[entry->ctStamps] = other->aStamps[iOther];
+    entry->aStamps[entry->ctStamps].path = KV_strdup(other->aStamps[iOther].path);
+    ++entry->ctStamps;
+  }
+
+  if (!other->cacheable) entry->cacheable = KV_false;
+};
+
+/* Finds a cached file under a resolved path that has been parsed in a specific way */
+static KV_IncludeEntry *KV_FindIncludeEntry(const char *path, const char *directory, unsigned int flags) {
+  KV_IncludeEntry *entry;
+
+  for (entry = _entryFirst; entry; entry = entry->next) {
+    if (entry->flags != flags || strcmp(entry->aStamps[0].path, path)) continue;
+
+    /* Nested includes are resolved relative to the directory of the includer */
+    if (entry->ctStamps > 1 && strcmp(entry->directory, directory)) continue;
+
+    return entry;
+  }
+
+  return NULL;
+};
+
+/* Check if none of the files that make up a cached list have changed since it has been parsed.
+ *
+ * stamp - Current stamp of the cached file itself.
+ */
+static KV_bool KV_IncludeEntryValid(const KV_IncludeEntry *entry, const KV_FileStamp *stamp) {
+  KV_FileStamp stampNow;
+  size_t i;
+
+  if (!KV_SameStamps(&entry->aStamps[0], stamp)) return KV_false;
+
+  for (i = 1; i < entry->ctStamps; ++i) {
+    if (!KV_StampFile(&stampNow, entry->aStamps[i].path) || !KV_SameStamps(&entry->aStamps[i], &stampNow)) return KV_false;
+  }
+
+  return KV_true;
+};
+
+/* Puts an entry at the beginning of the cache as the most recently used one */
+KV_INLINE void KV_LinkIncludeEntry(KV_IncludeEntry *entry) {
+  entry->prev = NULL;
+  entry->next = _entryFirst;
+
+  if (_entryFirst) {
+    _entryFirst->prev = entry;
+  } else {
+    _entryLast = entry;
+  }
+
+  _entryFirst = entry;
+};
+
+/* Takes an entry out of the cache */
+KV_INLINE void KV_UnlinkIncludeEntry(KV_IncludeEntry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    _entryFirst = entry->next;
+  }
+
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    _entryLast = entry->prev;
+  }
+
+  entry->prev = entry->next = NULL;
+};
+
+/* Adds an entry with a parsed list to the cache */
+static void KV_AddIncludeEntry(KV_IncludeEntry *entry) {
+  size_t i;
+
+  entry->bytes = sizeof(KV_IncludeEntry) + strlen(entry->directory) + 1 + KV_DocumentSize(entry->doc);
+  entry->bytes += entry->ctStampsArray * sizeof(KV_FileStamp);
+
+  for (i = 0; i < entry->ctStamps; ++i) {
+    entry->bytes += strlen(entry->aStamps[i].path) + 1;
+  }
+
+  KV_LinkIncludeEntry(entry);
+  ++_statsIncludeCache.files;
+  _statsIncludeCache.bytes += entry->bytes;
+};
+
+/* Removes an entry from the cache and frees it */
+static void KV_RemoveIncludeEntry(KV_IncludeEntry *entry) {
+  KV_UnlinkIncludeEntry(entry);
+  --_statsIncludeCache.files;
+  _statsIncludeCache.bytes -= entry->bytes;
+
+  KV_FreeIncludeEntry(entry);
+};
+
+/* Removes least recently used files until the cache fits within its limit */
+static void KV_TrimIncludeCache(void) {
+  while (_entryLast && _statsIncludeCache.bytes > _ctIncludeCacheLimit) {
+    KV_RemoveIncludeEntry(_entryLast);
+    ++_statsIncludeCache.evictions;
+  }
+};
+
+/* Copies a cached pair for an includer, allocating it from a document, if there is one */
+static KV_Pair *KV_CopyCachedPair(KV_Document *doc, KV_Pair *other) {
+  KV_Pair *pair, *pairIter;
+
+  if (!doc) return KV_PairCopy(other);
+
+  pair = KV_DocumentNewPair(doc);
+
+  /* Interned keys are shared between all pairs */
+  if (other->_flags & KV_PAIR_KEYSYM) {
+    pair->_key = other->_key;
+    pair->_flags |= KV_PAIR_KEYREF | KV_PAIR_KEYSYM;
+
+  } else if (other->_key) {
+    pair->_key = KV_DocumentCopyString(doc, other->_key);
+    pair->_flags |= KV_PAIR_KEYREF;
+  }
+
+  if (other->_type == KV_TYPE_STRING) {
+    pair->_type = KV_TYPE_STRING;
+    pair->_value.str = KV_DocumentCopyString(doc, other->_value.str);
+    pair->_flags |= KV_PAIR_STRREF;
+    return pair;
+  }
+
+  /* Typed values */
+  if (other->_type != KV_TYPE_NONE) {
+    pair->_type = other->_type;
+    pair->_value = other->_value;
+    return pair;
+  }
+
+  for (pairIter = other->_value.head; pairIter; pairIter = pairIter->_next)
+  {
+    KV_AddTail(pair, KV_CopyCachedPair(doc, pairIter));
+  }
+
+  return pair;
+};
+
+void KV_SetIncludeCacheLimit(size_t bytes) {
+  _ctIncludeCacheLimit = bytes;
+
+  /* Disabled */
+  if (!bytes) {
+    KV_InvalidateIncludeCache(NULL);
+    return;
+  }
+
+  KV_TrimIncludeCache();
+};
+
+void KV_InvalidateIncludeCache(const char *path) {
+  KV_IncludeEntry *entry, *entryNext;
+  char *strResolved;
+  size_t i;
+
+  /* Remove all files */
+  if (!path) {
+    while (_entryFirst) KV_RemoveIncludeEntry(_entryFirst);
+    return;
+  }
+
+  /* Paths to removed files cannot be resolved anymore */
+  strResolved = KV_ResolvePath(path);
+  if (strResolved) path = strResolved;
+
+  for (entry = _entryFirst; entry; entry = entryNext) {
+    entryNext = entry->next;
+
+    for (i = 0; i < entry->ctStamps; ++i) {
+      if (!strcmp(entry->aStamps[i].path, path)) {
+        KV_RemoveIncludeEntry(entry);
+        break;
+      }
+    }
+  }
+
+  KV_free(strResolved);
+};
+
+void KV_GetIncludeCacheStats(KV_IncludeCacheStats *stats) {
+  assert(stats);
+  *stats = _statsIncludeCache;
+};
+
+/*********************************************************************************************************************************
+ * Serialization
+ *********************************************************************************************************************************/
+
+static KV_Pair *KV_ParseBufferInternal(KV_Context *ctx);
+static KV_Pair *KV_ParseContents(KV_Context *ctx, KV_bool bClosed);
+
+/* Types of tokens in a character buffer */
+typedef enum _KV_TokenType {
+  KV_TOKEN_END = 0, /* Reached the end of the buffer */
+  KV_TOKEN_ERROR,   /* Couldn't scan a token */
+  KV_TOKEN_STRING,  /* Quoted or unquoted string */
+  KV_TOKEN_OPEN,    /* Opening curly brace */
+  KV_TOKEN_CLOSE,   /* Closing curly brace */
+  KV_TOKEN_MORE,    /* Reached the end of a stream chunk in the middle of a token */
+} KV_TokenType;
+
+/* Raw characters of a string token as they appear in a character buffer, including escape sequences */
+typedef struct _KV_Span {
+  const char *pch;
+  size_t ct;
+  size_t line; /* Line at which the token begins */
+} KV_Span;
+
+/* String token parsed from a character buffer */
+typedef struct _KV_Token {
+  char *str; /* Null-terminated string or NULL if there's no token */
+  size_t line; /* Line at which the token begins */
+  KV_bool owned; /* The string is allocated on the heap instead of being borrowed from a document or an in-situ buffer */
+  KV_bool pooled; /* The owned string is allocated by a pool, see KV_ContextAllocToken() */
+  KV_bool symbol; /* The string is borrowed from the symbol table */
+} KV_Token;
+
+#ifdef KV_USE_PTHREADS
+  typedef enum _KV_JobState {
+    KV_JOB_PENDING, /* Waiting in the queue */
+    KV_JOB_RUNNING, /* Being loaded on a worker thread */
+    KV_JOB_DONE     /* Loaded on a worker thread */
+  } KV_JobState;
+
+  /* Included file that's being loaded on a worker thread */
+  typedef struct _KV_IncludeJob {
+    struct _KV_IncludeJob *next; /* Next job in the queue */
+
+    KV_Context ctx; /* Context for parsing the included file */
+    KV_Context ctxParent; /* State of the parser that's including the file at the time of including it, for errors */
+    size_t iLine; /* Line in the parent context that's including the file */
+    char *file; /* Copy of the included file path */
+
+    KV_Document *docParent; /* Document of the parent context (may be NULL) */
+    KV_Document *doc; /* Separate document for parsing the file, if the parent has one */
+
+    size_t iOrder; /* Order in which the parser has started loading included files, which is their order in the file */
+    KV_Pair *list; /* Parsed list or NULL on error */
+    KV_Error error; /* Error from a worker thread, which cannot be seen by the parser thread */
+    KV_JobState eState;
+  } KV_IncludeJob;
+
+  static KV_Pair *KV_FinishIncludeJob(KV_IncludeJob *job, KV_bool cancel);
+#endif
+
+/* Expanding array of lists to include in the current list */
+typedef struct _KV_Includes {
+  KV_Pair **aLists;
+  size_t *aLines;
+
+#ifdef KV_USE_PTHREADS
+  KV_IncludeJob **aJobs; /* Files that are still being loaded on worker threads, in place of their lists */
+#endif
+
+  size_t ctArray;
+  size_t ctUsed;
+} KV_Includes;
+
+KV_INLINE void KV_InitIncludes(KV_Includes *incl) {
+  incl->aLists = NULL;
+  incl->aLines = NULL;
+#ifdef KV_USE_PTHREADS
+  incl->aJobs = NULL;
+#endif
+  incl->ctArray = incl->ctUsed = 0;
+};
+
+KV_INLINE void KV_DestroyIncludes(KV_Includes *incl) {
+  size_t i;
+
+  if (!incl->aLists) return;
+
+  /* Destroy all lists */
+  for (i = 0; i < incl->ctUsed; ++i) {
+  #ifdef KV_USE_PTHREADS
+    /* Discard files that are still being loaded */
+    if (incl->aJobs[i]) {
+      KV_FinishIncludeJob(incl->aJobs[i], KV_true);
+      continue;
+    }
+  #endif
+
+    /* Lists are missing after failing to join jobs */
+    if (incl->aLists[i]) KV_PairDestroy(incl->aLists[i]);
+  }
+
+  /* Free the arrays */
+  KV_free(incl->aLists);
+  KV_free(incl->aLines);
+#ifdef KV_USE_PTHREADS
+  KV_free(incl->aJobs);
+#endif
+  KV_InitIncludes(incl);
+};
+
+#ifdef KV_USE_PTHREADS
+
+/* Waits for all included files that are being loaded on worker threads in order.
+ * Returns KV_false if any of them couldn't be loaded, after setting 'piFailed' to the order of its job.
+ */
+KV_INLINE KV_bool KV_JoinIncludes(KV_Includes *incl, size_t *piFailed) {
+  size_t i, iOrder;
+
+  for (i = 0; i < incl->ctUsed; ++i) {
+    if (!incl->aJobs[i]) continue;
+
+    iOrder = incl->aJobs[i]->iOrder;
+    incl->aLists[i] = KV_FinishIncludeJob(incl->aJobs[i], KV_false);
+    incl->aJobs[i] = NULL;
+
+    if (!incl->aLists[i]) {
+      *piFailed = iOrder;
+      return KV_false;
+    }
+  }
+
+  return KV_true;
+};
+
+#endif /* KV_USE_PTHREADS */
+
+KV_INLINE void KV_AddInclude(KV_Includes *incl, KV_Pair *list, size_t iLine) {
+  assert(incl->ctUsed <= incl->ctArray);
+
+  /* If all array slots have been used up */
+  if (incl->ctUsed == incl->ctArray) {
+    incl->ctArray += 32;
+
+    /* Expand the arrays */
+    if (incl->aLists) {
+      incl->aLists = (KV_Pair **)KV_realloc(incl->aLists, incl->ctArray * sizeof(KV_Pair *));
+      incl->aLines = (size_t   *)KV_realloc(incl->aLines, incl->ctArray * sizeof(size_t));
+    #ifdef KV_USE_PTHREADS
+      incl->aJobs = (KV_IncludeJob **)KV_realloc(incl->aJobs, incl->ctArray * sizeof(KV_IncludeJob *));
+    #endif
+
+    /* Allocate new arrays */
+    } else {
+      incl->aLists = (KV_Pair **)KV_malloc(incl->ctArray * sizeof(KV_Pair *));
+      incl->aLines = (size_t   *)KV_malloc(incl->ctArray * sizeof(size_t));
+    #ifdef KV_USE_PTHREADS
+      incl->aJobs = (KV_IncludeJob **)KV_malloc(incl->ctArray * sizeof(KV_IncludeJob *));
+    #endif
+    }
+  }
+
+  /* Add a new list at the end at the current line */
+  incl->aLists[incl->ctUsed] = list;
+  incl->aLines[incl->ctUsed] = iLine;
+#ifdef KV_USE_PTHREADS
+  incl->aJobs[incl->ctUsed] = NULL;
+#endif
+
+  ++incl->ctUsed;
+};
+
+/* List that is being constructed by the parser */
+typedef struct _KV_Frame {
+  KV_Pair *list;
+  KV_Token tokKey; /* Key of this list in the parent list */
+
+  KV_Includes inclIncludeFiles;
+  KV_Includes inclBaseFiles;
+} KV_Frame;
+
+/* Constructs nested lists out of tokens one token at a time */
+typedef struct _KV_Builder {
+  KV_Frame *aFrames; /* Lists from the global one to the innermost one */
+  size_t ctArray;
+  size_t ctUsed;
+
+  KV_Token tokKey; /* Set to a valid string if expecting a value for a complete pair */
+
+#ifdef KV_USE_PTHREADS
+  size_t ctJobs; /* Included files that have been started on worker threads */
+  size_t iFailedJob; /* Order of the job that has failed to load its file or (size_t)-1 if the error is elsewhere */
+#endif
+} KV_Builder;
+
+/* Comments that may be left unclosed at the end of a buffer */
+typedef enum _KV_CommentState {
+  KV_COMMENT_NONE = 0,   /* Not inside a comment */
+  KV_COMMENT_LINE,       /* Inside a single-line comment */
+  KV_COMMENT_BLOCK,      /* Inside a block comment */
+  KV_COMMENT_BLOCK_STAR, /* Right after an asterisk inside a block comment */
+} KV_CommentState;
+
+/* State of an incremental parser that receives VDF contents in chunks */
+typedef struct _KV_Stream {
+  KV_Builder builder;
+  KV_bool started; /* The builder has been set up */
+  KV_bool failed; /* Errored out on one of the chunks */
+  KV_bool finished; /* No more chunks are expected, so tokens at the very end are complete */
+
+  /* Characters that haven't been parsed yet, e.g. an incomplete token at the end of the last chunk */
+  char *buffer;
+  size_t length;
+  size_t size;
+
+  KV_CommentState eComment; /* Comment that hasn't been closed by the end of the last chunk */
+} KV_Stream;
+
+/* Check if more characters may be fed into the context after the end of its buffer */
+KV_INLINE KV_bool KV_ContextExpectsMore(KV_Context *ctx) {
+  return (ctx->_stream && !ctx->_stream->finished) ? KV_true : KV_false;
+};
+
+/* Returns the pool that the parser allocates from if there's no document */
+KV_INLINE KV_Pool *KV_ContextPool(KV_Context *ctx) {
+  return (ctx->_pool ? ctx->_pool : _poolThread);
+};
+
+/* Creates a new empty list for the parser */
+KV_INLINE KV_Pair *KV_ContextNewList(KV_Context *ctx) {
+  KV_Pair *pair;
+
+  if (ctx->_document) return KV_DocumentNewPair(ctx->_document);
+
+  pair = KV_PoolNewPair(KV_ContextPool(ctx));
+  pair->_key = NULL;
+  pair->_type = KV_TYPE_NONE;
+  KV_InitList(pair);
+
+  pair->_parent = NULL;
+  pair->_prev = pair->_next = NULL;
+
+  return pair;
+};
+
+/* Hands the token string over to a pair instead of copying it.
+ * Borrowed strings are only referenced using the first flag and pooled strings are marked with the second one.
+ */
+KV_INLINE char *KV_AdoptToken(KV_Pair *pair, KV_Token *tok, unsigned int flag, unsigned int flagPool) {
+  char *str = tok->str;
+  tok->str = NULL;
+
+  if (tok->owned) {
+    if (tok->pooled) pair->_flags |= flagPool;
+    KV_MarkDirty(pair);
+  } else {
+    pair->_flags |= flag;
+    if (tok->symbol) pair->_flags |= KV_PAIR_KEYSYM;
+  }
+
+  return str;
+};
+
+/* Sets a value to a newly created or freed pair out of a token.
+ * If the context infers value types, numbers are stored as typed values and the token is left to be freed by the caller.
+ */
+KV_INLINE void KV_ContextSetValue(KV_Context *ctx, KV_Pair *pair, KV_Token *value) {
+  KV_Number num;
+  KV_DataType eType;
+
+  if (ctx->_types && (eType = KV_ParseNumber(value->str, &num)) != KV_TYPE_NONE) {
+    pair->_type = eType;
+
+    switch (eType) {
+      case KV_TYPE_INT: pair->_value.i = num.i; break;
+      case KV_TYPE_FLOAT: pair->_value.f = num.f; break;
+      default: pair->_value.u64 = num.u64; break;
+    }
+    return;
+  }
+
+  pair->_type = KV_TYPE_STRING;
+  pair->_value.str = KV_AdoptToken(pair, value, KV_PAIR_STRREF, KV_PAIR_STRPOOL);
+};
+
+/* Creates a new pair with a value for the parser out of two tokens */
+KV_INLINE KV_Pair *KV_ContextNewString(KV_Context *ctx, KV_Token *key, KV_Token *value) {
+  KV_Pair *pair = KV_ContextNewList(ctx);
+
+  pair->_key = KV_AdoptToken(pair, key, KV_PAIR_KEYREF, KV_PAIR_KEYPOOL);
+  KV_ContextSetValue(ctx, pair, value);
+
+  return pair;
+};
+
+/* Sets a new key name to a pair out of a token */
+KV_INLINE void KV_SetKeyToken(KV_Pair *pair, KV_Token *key) {
+  KV_IndexUnlink(pair);
+  KV_FreeKey(pair);
+  pair->_key = KV_AdoptToken(pair, key, KV_PAIR_KEYREF, KV_PAIR_KEYPOOL);
+  KV_IndexLink(pair);
+};
+
+/* Sets a new value to a pair out of a token */
+KV_INLINE void KV_SetStringToken(KV_Context *ctx, KV_Pair *pair, KV_Token *value) {
+  KV_FreeValue(pair);
+  KV_ContextSetValue(ctx, pair, value);
+};
+
+/* Contents of a file loaded into memory */
+typedef struct _KV_FileData {
+  char *buffer;
+  size_t length;
+  KV_bool mapped; /* The buffer is mapped from the file instead of being allocated on the heap */
+} KV_FileData;
+
+/* Reads the rest of an opened file into a new heap buffer in chunks, which also works with pipes and special files.
+ * Returns 0 on success or an error number on failure.
+ *
+ * ctHint - Expected amount of bytes to read, if known beforehand.
+ */
+KV_INLINE int KV_ReadFile(KV_FileData *data, FILE *file, size_t ctHint) {
+  size_t ctSize = ctHint + 1; /* Extra byte for reaching the end of the file in one go */
+  char *pchExpanded;
+  int iError;
+
+  if (ctSize < 4096) ctSize = 4096;
+
+  data->buffer = (char *)KV_malloc(ctSize);
+  data->length = 0;
+  data->mapped = KV_false;
+
+  if (!data->buffer) return ENOMEM;
+
+  for (;;) {
+    data->length += fread(data->buffer + data->length, sizeof(char), ctSize - data->length, file);
+
+    /* Reached the end of the file or errored out */
+    if (data->length < ctSize) break;
+
+    /* Expand the buffer for the next chunk */
+    ctSize *= 2;
+    pchExpanded = (char *)KV_realloc(data->buffer, ctSize);
+
+    if (!pchExpanded) {
+      KV_free(data->buffer);
+      return ENOMEM;
+    }
+
+    data->buffer = pchExpanded;
+  }
+
+  if (ferror(file)) {
+    iError = (errno ? errno : EIO);
+    KV_free(data->buffer);
+    return iError;
+  }
+
+  return 0;
+};
+
+/* Loads the entire contents of a file into memory.
+ * Regular files are mapped into memory where possible, otherwise the file is read into a heap buffer.
+ * Returns 0 on success or an error number on failure.
+ * IMPORTANT: Loaded file contents need to be released using KV_ReleaseFile()!
+ */
+KV_INLINE int KV_LoadFile(KV_FileData *data, const char *path) {
+  FILE *file;
+  int iError;
+#ifdef KV_USE_POSIX_IO
+  struct stat st;
+  int fd;
+#endif
+
+  /* Nothing to release on error */
+  data->buffer = NULL;
+  data->length = 0;
+  data->mapped = KV_false;
+
+#ifdef KV_USE_POSIX_IO
+  fd = open(path, O_RDONLY);
+  if (fd == -1) return errno;
+
+  if (fstat(fd, &st) == -1) {
+    iError = errno;
+    close(fd);
+    return iError;
+  }
+
+  /* Opening a directory is fine but reading it isn't */
+  if (S_ISDIR(st.st_mode)) {
+    close(fd);
+    return EISDIR;
+  }
+
+#ifdef KV_USE_MMAP
+  /* Map non-empty regular files that fit into the address space */
+  if (S_ISREG(st.st_mode) && st.st_size > 0 && (off_t)(size_t)st.st_size == st.st_size) {
+    data->buffer = (char *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (data->buffer != (char *)MAP_FAILED) {
+      close(fd);
+
+      /* The parser reads everything from start to finish */
+      madvise(data->buffer, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+      data->length = (size_t)st.st_size;
+      data->mapped = KV_true;
+      return 0;
+    }
+  }
+#endif
+
+  /* Fall back on reading the file */
+  file = fdopen(fd, "rb");
+
+  if (!file) {
+    iError = errno;
+    close(fd);
+    return iError;
+  }
+
+  iError = KV_ReadFile(data, file, S_ISREG(st.st_mode) ? (size_t)st.st_size : 0);
+
+#else
+  long lSize;
+
+  file = fopen(path, "rb");
+  if (!file) return errno;
+
+  /* Try to get the file size in advance */
+  if (fseek(file, 0, SEEK_END) == 0 && (lSize = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+    iError = KV_ReadFile(data, file, (size_t)lSize);
+  } else {
+    rewind(file);
+    iError = KV_ReadFile(data, file, 0);
+  }
+#endif
+
+  fclose(file);
+  return iError;
+};
+
+/* Releases file contents loaded using KV_LoadFile() */
+KV_INLINE void KV_ReleaseFile(KV_FileData *data) {
+#ifdef KV_USE_MMAP
+  if (data->mapped) {
+    munmap(data->buffer, data->length);
+    return;
+  }
+#endif
+
+  KV_free(data->buffer);
+};
+
+/* Composes a full path to a file in a directory.
+ * Returns NULL if the file path should be used as is, otherwise the returned path must be freed.
+ */
+KV_INLINE char *KV_ComposeFilePath(const char *directory, const char *file) {
+  char *str;
+
+  /* Disregard the directory if it's an empty string or the file path is absolute */
+  if (!*directory || IsPathStringAbsolute(file)) return NULL;
+
+  str = (char *)KV_malloc(strlen(directory) + strlen(file) + 1);
+  strcpy(str, directory);
+  strcat(str, file);
+
+  return str;
+};
+
+/* Loads contents of a file from a context for parsing it.
+ * Returns KV_false on error.
+ * IMPORTANT: Loaded file contents need to be released using KV_ReleaseFile()!
+ *
+ * ctx - Context with a file to load.
+ * ctxParent - Context of the parser that's including this new file (may be NULL).
+ * iLine - Line in the parent context that's including this new file.
+ * data - File contents to load.
+ * ctxParse - Context to set up for parsing loaded file contents.
+ */
+KV_INLINE KV_bool KV_ContextLoadFile(KV_Context *ctx, KV_Context *ctxParent, size_t iLine, KV_FileData *data, KV_Context *ctxParse) {
+  int iError;
+  char *str;
+
+  str = KV_ComposeFilePath(ctx->_directory, ctx->_file);
+  iError = KV_LoadFile(data, str ? str : ctx->_file);
+  KV_free(str);
+
+  if (iError) {
+    if (ctxParent) {
+      KV_SetContextError(ctxParent, iLine, KV_ERROR_LOAD_FILE, iError);
+    } else {
+      KV_SetError(KV_ERROR_LOAD_FILE, iError);
+    }
+
+    return KV_false;
+  }
+
+  ctx->_length = data->length;
+
+  /* Parse file contents within their exact length */
+  KV_ContextSetupBuffer(ctxParse, ctx->_directory, data->buffer, data->length);
+  KV_ContextCopyFlags(ctxParse, ctx);
+  KV_ContextSetDocument(ctxParse, ctx->_document);
+  KV_ContextSetPool(ctxParse, ctx->_pool);
+
+  /* For error output */
+  ctxParse->_file = ctx->_file;
+  return KV_true;
+};
+
+/* Contents that lazy lists are parsed from, which are shared between all lists from the same buffer or file */
+typedef struct _KV_LazySource {
+  size_t refs; /* Lazy lists that reference the contents, plus one for the parser that's recording them */
+  KV_Context ctx; /* Parser flags and the document with copies of the directory and the file path */
+  KV_FileData data; /* Loaded file contents, if 'owned' is set; otherwise the buffer is borrowed */
+  KV_bool owned;
+} KV_LazySource;
+
+/* Creates a source for recording lazy lists from contents of a context with one reference for its parser.
+ * If 'data' isn't NULL, loaded file contents are kept until the source is released.
+ */
+static KV_LazySource *KV_NewLazySource(KV_Context *ctx, KV_FileData *data) {
+  const size_t ctDirectory = strlen(ctx->_directory) + 1;
+  const size_t ctFile = (ctx->_file ? strlen(ctx->_file) + 1 : 0);
+  KV_LazySource *source = (KV_LazySource *)KV_malloc(sizeof(KV_LazySource) + ctDirectory + ctFile);
+  char *str = (char *)(source + 1);
+
+  source->refs = 1;
+  source->ctx = *ctx;
+  source->ctx._stream = NULL;
+  source->ctx._source = NULL;
+
+  /* Strings of the context are only borrowed for the duration of the parsing */
+  memcpy(str, ctx->_directory, ctDirectory);
+  source->ctx._directory = str;
+
+  if (ctFile) {
+    memcpy(str + ctDirectory, ctx->_file, ctFile);
+    source->ctx._file = str + ctDirectory;
+  }
+
+  source->owned = (data != NULL) ? KV_true : KV_false;
+  if (data) source->data = *data;
+
+  return source;
+};
+
+static void KV_ReleaseLazySource(KV_LazySource *source) {
+  if (--source->refs != 0) return;
+
+  if (source->owned) KV_ReleaseFile(&source->data);
+  KV_free(source);
+};
+
+/* Parses a new file and constructs a new list out of its contents.
+ *
+ * ctx - Context for parsing a new file.
+ * ctxParent - Context of the parser that's including this new file (may be NULL).
+ * iLine - Line in the parent context that's including this new file.
+ */
+KV_INLINE KV_Pair *KV_ParseFileInternal(KV_Context *ctx, KV_Context *ctxParent, size_t iLine) {
+  KV_FileData data;
+  KV_Pair *list;
+  KV_Context ctxParse;
+
+  if (!KV_ContextLoadFile(ctx, ctxParent, iLine, &data, &ctxParse)) return NULL;
+
+  /* Keep file contents loaded for lazy lists, which release them once they're all parsed or destroyed */
+  if (ctxParse._lazy) {
+    ctxParse._source = KV_NewLazySource(&ctxParse, &data);
+    return KV_ParseBufferInternal(&ctxParse);
+  }
+
+  list = KV_ParseBufferInternal(&ctxParse);
+  KV_ReleaseFile(&data);
+
+  return list;
+};
+
+/* Finds the end of a string token without parsing it.
+ * Returns amount of raw characters in the string, including escape sequences, or (size_t)-1 on error.
+ * Returns (size_t)-2 if the string may continue in the next chunk of a stream.
+ */
+KV_INLINE size_t KV_ScanString(KV_Context *ctx, KV_bool onlyquotes)
+{
+  const char *pchBegin = ctx->_pch;
+  size_t ct;
+
+  for (;;) {
+    /* Skip regular characters in quoted strings */
+    if (onlyquotes) ctx->_pch = KV_ContextScan(ctx, '"', '\n', ctx->_escapeseq ? '\\' : '"');
+
+    /* Unexpected end of the string (checked first to never read past the end of bounded buffers) */
+    if (KV_ContextBufferEnded(ctx)) {
+      /* Wait for the rest of the string */
+      if (KV_ContextExpectsMore(ctx)) return (size_t)-2;
+
+      /* Fine with unquoted strings */
+      if (!onlyquotes) break;
+
+      KV_SetContextError(ctx, ctx->_line, KV_ERROR_UNCLOSED_STRING, 0);
+      return (size_t)-1;
+    }
+
+    /* Quit the loop on specific characters */
+    if (!onlyquotes) {
+      if (*ctx->_pch == '"' || *ctx->_pch == '/' || *ctx->_pch == '{' || *ctx->_pch == '}' || isspace(*ctx->_pch)) {
+        break;
+      }
+
+    /* Skip closing quotes */
+    } else if (*ctx->_pch == '"') {
+      ct = ctx->_pch - pchBegin;
+      ++ctx->_pch;
+      return ct;
+
+    /* Line breaks aren't allowed in quoted strings */
+    } else if (*ctx->_pch == '\n') {
+      KV_SetContextError(ctx, ctx->_line, KV_ERROR_UNCLOSED_STRING, 0);
+      return (size_t)-1;
+    }
+
+    /* Skip the escaped character */
+    if (ctx->_escapeseq && *ctx->_pch == '\\') {
+      ++ctx->_pch;
+
+      /* Leave a single backslash, if at the very end */
+      if (KV_ContextBufferEnded(ctx)) {
+        if (KV_ContextExpectsMore(ctx)) return (size_t)-2;
+        break;
+      }
+    }
+
+    ++ctx->_pch;
+  }
+
+  return ctx->_pch - pchBegin;
+};
+
+/* Copies raw characters of a scanned string into a character buffer while parsing escape sequences in it.
+ * Returns amount of copied characters, which never exceeds the amount of raw characters.
+ */
+KV_INLINE size_t KV_DecodeString(KV_Context *ctx, char *str, const char *pch, size_t ct)
+{
+  const char *pchEnd = pch + ct;
+  size_t iChar = 0;
+
+  /* Nothing to parse */
+  if (!ctx->_escapeseq) {
+    memcpy(str, pch, ct);
+    return ct;
+  }
+
+  while (pch < pchEnd) {
+    /* Append a regular character */
+    if (*pch != '\\') {
+      str[iChar++] = *pch++;
+      continue;
+    }
+
+    /* Insert a single backslash, if at the very end */
+    if (++pch == pchEnd) {
+      str[iChar++] = '\\';
+      break;
+    }
+
+    /* Append special character */
+    switch (*pch++) {
+      case 'n':  str[iChar++] = '\n'; break;
+      case 't':  str[iChar++] = '\t'; break;
+      case 'r':  str[iChar++] = '\r'; break;
+      case 'b':  str[iChar++] = '\b'; break;
+      case 'f':  str[iChar++] = '\f'; break;
+      case '"':  str[iChar++] = '"';  break;
+      case '\\': str[iChar++] = '\\'; break;
+      default: break;
+    }
+  }
+
+  return iChar;
+};
+
+/* Allocates space for a new string token */
+KV_INLINE void KV_ContextAllocToken(KV_Context *ctx, KV_Token *tok, size_t size) {
+  KV_Pool *pool;
+  KV_PoolClass eClass;
+
+  if (ctx->_document) {
+    tok->str = (char *)KV_DocumentAlloc(ctx->_document, size, 1);
+    tok->owned = KV_false;
+
+  } else if ((pool = KV_ContextPool(ctx)) && (eClass = KV_PoolStringClass(size)) != KV_POOL_CLASSES) {
+    tok->str = (char *)KV_PoolAlloc(pool, eClass);
+    tok->owned = KV_true;
+    tok->pooled = KV_true;
+
+  } else {
+    tok->str = (char *)KV_malloc(size);
+    tok->owned = KV_true;
+    tok->pooled = KV_false;
+  }
+
+  tok->symbol = KV_false;
+};
+
+/* Writes a null terminator right after a string that has been decoded in place.
+ * Returns KV_false if the terminator would overwrite a character that still needs to be parsed.
+ */
+KV_INLINE KV_bool KV_TerminateInSitu(KV_Context *ctx, char *pchEnd) {
+  /* Overwrite characters that have already been parsed, e.g. closing quotes */
+  if (pchEnd < ctx->_pch) {
+    *pchEnd = '\0';
+    return KV_true;
+  }
+
+  /* Already terminated by the null character at the end or there's no more space in the buffer */
+  if (KV_ContextBufferEnded(ctx)) return (ctx->_length == (size_t)-1) ? KV_true : KV_false;
+
+  /* Overwrite the whitespace that follows an unquoted string and skip it */
+  if (isspace(*ctx->_pch)) {
+    if (*ctx->_pch == '\n') ++ctx->_line;
+
+    *pchEnd = '\0';
+    ++ctx->_pch;
+    return KV_true;
+  }
+
+  /* The next token immediately follows this one */
+  return KV_false;
+};
+
+/* Parses a scanned string token into a null-terminated string.
+ * In-situ contexts decode strings right inside their buffers and only copy them if they cannot be terminated in place.
+ * This function must be called right after scanning the token.
+ * IMPORTANT: Parsed token needs to be freed using KV_FreeToken() unless it has been adopted by a pair!
+ */
+KV_INLINE void KV_ParseString(KV_Context *ctx, const KV_Span *span, KV_Token *tok)
+{
+  char *pchBegin = (char *)span->pch;
+  size_t ct = span->ct;
+
+  tok->line = span->line;
+
+  if (ctx->_insitu) {
+    /* Decoded string is never longer than the raw one */
+    if (ctx->_escapeseq) ct = KV_DecodeString(ctx, pchBegin, pchBegin, ct);
+
+    if (KV_TerminateInSitu(ctx, pchBegin + ct)) {
+      tok->str = pchBegin;
+      tok->owned = KV_false;
+      tok->symbol = KV_false;
+      return;
+    }
+
+    /* Copy the decoded string if there's no space for a terminator */
+    KV_ContextAllocToken(ctx, tok, ct + 1);
+    memcpy(tok->str, pchBegin, ct);
+    tok->str[ct] = '\0';
+    return;
+  }
+
+  /* Allocate enough space for the raw string */
+  KV_ContextAllocToken(ctx, tok, ct + 1);
+  tok->str[KV_DecodeString(ctx, tok->str, pchBegin, ct)] = '\0';
+};
+
+/* Creates an empty string token for keys and values that are omitted before curly braces */
+KV_INLINE void KV_EmptyToken(KV_Context *ctx, KV_Token *tok, size_t iLine) {
+  KV_ContextAllocToken(ctx, tok, 1);
+  tok->str[0] = '\0';
+  tok->line = iLine;
+};
+
+/* Frees a token that has been parsed by KV_ParseString() */
+KV_INLINE void KV_FreeToken(KV_Token *tok) {
+  if (tok->owned) {
+    if (tok->pooled) {
+      KV_PoolFree(tok->str);
+    } else {
+      KV_free(tok->str);
+    }
+  }
+
+  tok->str = NULL;
+};
+
+/* Replaces the string of a token with its interned copy from the symbol table */
+KV_INLINE void KV_InternToken(KV_Token *tok) {
+  const char *str = KV_Intern(tok->str);
+  KV_FreeToken(tok);
+
+  tok->str = (char *)str;
+  tok->owned = KV_false;
+  tok->symbol = KV_true;
+};
+
+/* Parses a scanned key token into an interned string from the symbol table.
+ * Keys without escape sequences are interned directly from the buffer without making a temporary copy.
+ */
+KV_INLINE void KV_ParseSymbol(KV_Context *ctx, const KV_Span *span, KV_Token *tok)
+{
+  if (ctx->_escapeseq && memchr(span->pch, '\\', span->ct)) {
+    KV_ParseString(ctx, span, tok);
+    KV_InternToken(tok);
+    return;
+  }
+
+  tok->str = (char *)KV_InternString(span->pch, span->ct);
+  tok->line = span->line;
+  tok->owned = KV_false;
+  tok->symbol = KV_true;
+};
+
+/* Finds a subpair in a list under the key from a token.
+ * Lists that are being parsed are always indexed when they get wide, even if indexing is disabled (see KV_FinishFrame()).
+ */
+KV_INLINE KV_Pair *KV_FindToken(KV_Pair *list, const KV_Token *key) {
+  return KV_FindKeyWithThreshold(list, key->str, key->symbol ? key->str : KV_LookupSymbol(key->str), KV_GetBulkThreshold());
+};
+
+/* Count line breaks */
+KV_INLINE KV_bool KV_ParseLineBreak(KV_Context *ctx)
+{
+  if (*ctx->_pch == '\n') {
     ++ctx->_pch;
     ++ctx->_line;
     return KV_true;
   }
 
-  return KV_false;
+  return KV_false;
+};
+
+/* Skips characters of a comment that begins at the current character or has been left unclosed before it.
+ * Returns KV_COMMENT_NONE if the comment has ended, otherwise the buffer has ended in the middle of the comment.
+ */
+KV_INLINE KV_CommentState KV_SkipComment(KV_Context *ctx, KV_CommentState eComment)
+{
+  switch (eComment) {
+    /* Expect a line break down the road */
+    case KV_COMMENT_LINE:
+      ctx->_pch = KV_ContextScan(ctx, '\n', '\n', '\n');
+      return KV_ContextBufferEnded(ctx) ? KV_COMMENT_LINE : KV_COMMENT_NONE;
+
+    /* Close the block comment */
+    case KV_COMMENT_BLOCK_STAR:
+      if (KV_ContextBufferEnded(ctx)) return KV_COMMENT_BLOCK_STAR;
+      if (*ctx->_pch == '/') return KV_COMMENT_NONE;
+
+      /* Skip the character after the asterisk */
+      ++ctx->_pch;
+      /* Fall through */
+
+    /* Expect block comment closing down the road */
+    case KV_COMMENT_BLOCK:
+      for (;;) {
+        ctx->_pch = KV_ContextScan(ctx, '*', '\n', '\n');
+        if (KV_ContextBufferEnded(ctx)) return KV_COMMENT_BLOCK;
+
+        /* Keep counting line breaks */
+        if (KV_ParseLineBreak(ctx)) continue;
+
+        ++ctx->_pch;
+        if (KV_ContextBufferEnded(ctx)) return KV_COMMENT_BLOCK_STAR;
+        if (*ctx->_pch == '/') return KV_COMMENT_NONE;
+
+        /* Skip the character after the asterisk */
+        ++ctx->_pch;
+      }
+
+    default: break;
+  }
+
+  return KV_COMMENT_NONE;
+};
+
+/* Characters that matter for skipping over lists outside of quoted strings */
+static const unsigned char _abListStops[256] = {
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, /* '\0', '\n' */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, /* '"', '/' */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, /* '\\' */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, /* '{', '}' */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+/* Skips contents of a list that begin right after its opening brace, up to and including the matching closing brace.
+ * Only curly braces, quoted strings, escape sequences, comments and line breaks are kept track of, the same way as
+ * KV_NextToken() and KV_ScanString() do it, without scanning any other tokens. Lists that are left unclosed end with the buffer.
+ * Returns amount of characters before the closing brace or (size_t)-1 on error.
+ */
+static size_t KV_SkipList(KV_Context *ctx) {
+  const char *pchBegin = ctx->_pch;
+  const char *pch = ctx->_pch;
+  const char *pchEnd = (ctx->_length == (size_t)-1) ? NULL : ctx->_buffer + ctx->_length; /* NULL until a null character */
+  const KV_bool bEscape = ctx->_escapeseq;
+  size_t iDepth = 1;
+  size_t iLine = ctx->_line;
+
+  for (;;) {
+    while (pch != pchEnd && !_abListStops[(unsigned char)*pch]) ++pch;
+
+    /* Reached the end of the buffer */
+    if (pch == pchEnd || (!pchEnd && !*pch)) break;
+
+    switch (*pch) {
+      case '\n':
+        ++iLine;
+        break;
+
+      case '{':
+        ++iDepth;
+        break;
+
+      case '}':
+        if (--iDepth != 0) break;
+
+        ctx->_pch = pch + 1;
+        ctx->_line = iLine;
+        return (size_t)(pch - pchBegin);
+
+      /* Skip the escaped character in unquoted strings without counting line breaks */
+      case '\\':
+        if (!bEscape) break;
+        if (++pch == pchEnd || (!pchEnd && !*pch)) goto ended;
+        break;
+
+      /* Comments are skipped as usual */
+      case '/':
+        ctx->_pch = ++pch;
+        ctx->_line = iLine;
+        if (KV_ContextBufferEnded(ctx)) goto ended;
+
+        if (*pch == '/' || *pch == '*') {
+          ++ctx->_pch;
+          if (KV_SkipComment(ctx, (*pch == '/') ? KV_COMMENT_LINE : KV_COMMENT_BLOCK) != KV_COMMENT_NONE) return (size_t)(ctx->_pch - pchBegin);
+
+          /* Continue right where the parser would read the next token */
+          pch = ctx->_pch;
+          iLine = ctx->_line;
+        }
+        continue;
+
+      case '"':
+        for (++pch;; ++pch) {
+          ctx->_pch = pch;
+          pch = KV_ContextScan(ctx, '"', '\n', bEscape ? '\\' : '"');
+
+          if (pch != pchEnd) {
+            if (*pch == '"') break;
+
+            /* Null characters only end buffers without a fixed length */
+            if (!*pch && pchEnd) continue;
+
+            /* Skip the escaped character or leave a single backslash, if at the very end */
+            if (*pch == '\\') {
+              if (++pch == pchEnd || (!pchEnd && !*pch)) goto ended;
+              continue;
+            }
+          }
+
+          /* Line breaks and the end of the buffer aren't allowed in quoted strings */
+          ctx->_pch = pch;
+          KV_SetContextError(ctx, iLine, KV_ERROR_UNCLOSED_STRING, 0);
+          return (size_t)-1;
+        }
+        break;
+
+      default: break;
+    }
+
+    ++pch;
+  }
+
+ended:
+  ctx->_pch = pch;
+  ctx->_line = iLine;
+  return (size_t)(pch - pchBegin);
+};
+
+static KV_bool KV_ParseLazyList(KV_Pair *list) {
+  KV_LazySource *source = list->_value.lazy.source;
+  const char *pchEnd = list->_value.lazy.begin + list->_value.lazy.length;
+  KV_bool bClosed;
+  KV_Context ctx;
+  KV_Pair *listParsed;
+
+  /* Check if the list ends with a closing brace or with the buffer */
+  if (source->ctx._length == (size_t)-1 || (size_t)(pchEnd - source->ctx._buffer) < source->ctx._length) {
+    bClosed = (*pchEnd == '}') ? KV_true : KV_false;
+  } else {
+    bClosed = KV_false;
+  }
+
+  /* Parse the contents as if they were an entire buffer */
+  ctx = source->ctx;
+  ctx._buffer = ctx._pch = list->_value.lazy.begin;
+  ctx._length = list->_value.lazy.length;
+  ctx._line = list->_value.lazy.line;
+
+  /* The parser releases its own reference afterwards, so the list keeps the contents if they couldn't be parsed */
+  ctx._source = source;
+  ++source->refs;
+
+  listParsed = KV_ParseContents(&ctx, bClosed);
+  if (!listParsed) return KV_false;
+
+  KV_ReleaseLazyList(list);
+  list->_flags &= ~KV_PAIR_LAZY;
+
+  /* Take subpairs together with the index that may have been built for them */
+  list->_value = listParsed->_value;
+  KV_ReparentNodes(list);
+
+  KV_InitList(listParsed);
+  KV_PairDestroy(listParsed);
+
+  return KV_true;
+};
+
+static void KV_ReleaseLazyList(KV_Pair *list) {
+  KV_ReleaseLazySource(list->_value.lazy.source);
+};
+
+KV_bool KV_Materialize(KV_Pair *pair) {
+  KV_Pair *pairIter = pair;
+  KV_bool bResult = KV_true;
+
+  assert(pair);
+
+  /* Go through all nested lists without recursion */
+  for (;;) {
+    if (pairIter->_type == KV_TYPE_NONE) {
+      if (!KV_EnsureParsed(pairIter)) {
+        bResult = KV_false;
+
+      } else if (pairIter->_value.head) {
+        pairIter = pairIter->_value.head;
+        continue;
+      }
+    }
+
+    while (pairIter != pair && !pairIter->_next) pairIter = pairIter->_parent;
+    if (pairIter == pair) break;
+
+    pairIter = pairIter->_next;
+  }
+
+  return bResult;
+};
+
+/* Scans the next token in a character buffer, skipping all whitespaces and comments before it.
+ * Curly braces are skipped over, while string tokens are only scanned and need to be parsed afterwards.
+ * NOTE: Single '/' characters with no '/' or '*' afterwards count as "empty" comments and are simply ignored.
+ * Comments that are left unclosed at the end of the buffer are ignored as well, unless more chunks of a stream
+ * are expected, in which case the comment is remembered to be skipped in the next chunk.
+ */
+KV_INLINE KV_TokenType KV_NextToken(KV_Context *ctx, KV_Span *span)
+{
+  const char *pchToken;
+  KV_CommentState eComment;
+
+  while (!KV_ContextBufferEnded(ctx)) {
+    /* Parse line breaks */
+    if (KV_ParseLineBreak(ctx)) continue;
+
+    /* Comments: Ignore all characters in CPP-styled single-line comments or in C-styled block comments */
+    if (*ctx->_pch == '/') {
+      ++ctx->_pch;
+
+      if (KV_ContextBufferEnded(ctx)) {
+        /* Need the next character to tell what kind of comment it is */
+        if (KV_ContextExpectsMore(ctx)) {
+          --ctx->_pch;
+          return KV_TOKEN_MORE;
+        }
+
+        break;
+      }
+
+      if (*ctx->_pch == '/') {
+        eComment = KV_COMMENT_LINE;
+      } else if (*ctx->_pch == '*') {
+        eComment = KV_COMMENT_BLOCK;
+      } else {
+        continue;
+      }
+
+      ++ctx->_pch;
+      eComment = KV_SkipComment(ctx, eComment);
+
+      /* Pretend that unclosed comments are still comments */
+      if (eComment != KV_COMMENT_NONE && KV_ContextExpectsMore(ctx)) ctx->_stream->eComment = eComment;
+      continue;
+    }
+
+    /* Skip whitespaces */
+    if (isspace(*ctx->_pch)) {
+      ++ctx->_pch;
+      continue;
+    }
+
+    span->line = ctx->_line;
+    pchToken = ctx->_pch;
+
+    switch (*ctx->_pch) {
+      /* Lists */
+      case '{': ++ctx->_pch; return KV_TOKEN_OPEN;
+      case '}': ++ctx->_pch; return KV_TOKEN_CLOSE;
+
+      /* Strings: Scan all characters until another double quote */
+      case '"':
+        span->pch = ++ctx->_pch;
+        span->ct = KV_ScanString(ctx, KV_true);
+        if (span->ct == (size_t)-1) return KV_TOKEN_ERROR;
+        break;
+
+      /* Strings: Scan all characters until another token or whitespace */
+      default:
+        span->pch = ctx->_pch;
+        span->ct = KV_ScanString(ctx, KV_false);
+        break;
+    }
+
+    /* Scan the entire token again once the next chunk arrives */
+    if (span->ct == (size_t)-2) {
+      ctx->_pch = pchToken;
+      return KV_TOKEN_MORE;
+    }
+
+    return KV_TOKEN_STRING;
+  }
+
+  return KV_TOKEN_END;
+};
+
+/* Check if a key begins with a specific macro name, which is executed if the key has a string value.
+ *
+ * length - Amount of characters in the key or -1, if it's null-terminated.
+ */
+KV_INLINE KV_bool KV_IsMacro(const char *key, size_t length, const char *macro) {
+  size_t ctMacro;
+
+  /* Not a macro */
+  if (!length || *key != '#') return KV_false;
+
+  ctMacro = strlen(macro);
+  return (length >= ctMacro && !strncasecmp(key, macro, ctMacro)) ? KV_true : KV_false;
+};
+
+/* Includes a file through the include cache, parsing it only if it isn't cached yet or has changed since.
+ *
+ * ctxInclude - Context for parsing the included file.
+ * ctx - Context of the parser that's including the file.
+ * iLine - Line in the parent context that's including the file.
+ */
+static KV_Pair *KV_IncludeCachedFile(KV_Context *ctxInclude, KV_Context *ctx, size_t iLine) {
+  KV_Document *doc = ctxInclude->_document;
+  unsigned int iFlags;
+  KV_Pool *poolThread;
+  KV_IncludeEntry *entry, *entryParent;
+  KV_FileStamp stamp;
+  KV_Pair *list;
+  char *str;
+
+  /* Cached lists are copied into every file that includes them, so they're never lazy */
+  ctxInclude->_lazy = KV_false;
+  iFlags = KV_GetIncludeFlags(ctxInclude);
+
+  str = KV_ComposeFilePath(ctxInclude->_directory, ctxInclude->_file);
+  stamp.path = KV_ResolvePath(str ? str : ctxInclude->_file);
+  KV_free(str);
+
+  /* Parse files that cannot be cached as usual */
+  if (!stamp.path || !KV_StampFile(&stamp, stamp.path)) {
+    KV_free(stamp.path);
+    if (_entryParsing) _entryParsing->cacheable = KV_false;
+
+    return KV_ParseFileInternal(ctxInclude, ctx, iLine);
+  }
+
+  entry = KV_FindIncludeEntry(stamp.path, ctxInclude->_directory, iFlags);
+
+  if (entry && KV_IncludeEntryValid(entry, &stamp)) {
+    KV_free(stamp.path);
+    ++_statsIncludeCache.hits;
+
+    /* Now the most recently used */
+    KV_UnlinkIncludeEntry(entry);
+    KV_LinkIncludeEntry(entry);
+
+  } else {
+    if (entry) KV_RemoveIncludeEntry(entry);
+    ++_statsIncludeCache.misses;
+
+    /* Parse the file into its own document while collecting stamps of the files it includes */
+    entry = KV_NewIncludeEntry(ctxInclude->_directory, iFlags, &stamp);
+    KV_ContextSetDocument(ctxInclude, entry->doc);
+
+    /* Cached lists may outlive any pool, including pairs that are added to them by merging included files */
+    KV_ContextSetPool(ctxInclude, NULL);
+    poolThread = _poolThread;
+    _poolThread = NULL;
+
+    entryParent = _entryParsing;
+    _entryParsing = entry;
+
+    list = KV_ParseFileInternal(ctxInclude, ctx, iLine);
+    _entryParsing = entryParent;
+    _poolThread = poolThread;
+
+    if (!list) {
+      KV_FreeIncludeEntry(entry);
+      return NULL;
+    }
+
+    /* Free heap memory that may have been added to the list by merging included files together with the document */
+    entry->list = list;
+    KV_DocumentAddRoot(entry->doc, list);
+
+    /* Some nested include has been parsed without caching */
+    if (!entry->cacheable) {
+      if (_entryParsing) _entryParsing->cacheable = KV_false;
+
+      list = KV_CopyCachedPair(doc, list);
+      KV_FreeIncludeEntry(entry);
+      return list;
+    }
+
+    KV_AddIncludeEntry(entry);
+  }
+
+  /* Files that include this one depend on it as well */
+  if (_entryParsing) KV_AddIncludeStamps(_entryParsing, entry);
+
+  list = KV_CopyCachedPair(doc, entry->list);
+  KV_TrimIncludeCache();
+
+  return list;
+};
+
+#ifdef KV_USE_PTHREADS
+
+static pthread_mutex_t _mtxJobs = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _condJobQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _condJobDone = PTHREAD_COND_INITIALIZER;
+
+static KV_IncludeJob *_jobFirst = NULL; /* Next job to take from the queue */
+static KV_IncludeJob *_jobLast = NULL;
+
+static pthread_t *_aThreads = NULL;
+static size_t _ctThreads = 0;
+static KV_bool _bStopThreads = KV_false;
+
+/* Parses an included file on the current thread */
+static void KV_RunIncludeJob(KV_IncludeJob *job, KV_bool worker) {
+  job->list = KV_ParseFileInternal(&job->ctx, &job->ctxParent, job->iLine);
+
+  /* Pass the error over to the parser thread */
+  if (!job->list && worker) {
+    job->error = _error;
+    KV_ResetError();
+  }
+};
+
+static void *KV_IncludeWorker(void *arg) {
+  KV_IncludeJob *job;
+  (void)arg;
+
+  pthread_mutex_lock(&_mtxJobs);
+
+  for (;;) {
+    while (!_jobFirst && !_bStopThreads) pthread_cond_wait(&_condJobQueued, &_mtxJobs);
+
+    /* Jobs that are still queued are run by their parsers */
+    if (_bStopThreads) break;
+
+    /* Take the next job */
+    job = _jobFirst;
+    _jobFirst = job->next;
+    if (!_jobFirst) _jobLast = NULL;
+
+    job->eState = KV_JOB_RUNNING;
+    pthread_mutex_unlock(&_mtxJobs);
+
+    KV_RunIncludeJob(job, KV_true);
+
+    pthread_mutex_lock(&_mtxJobs);
+    job->eState = KV_JOB_DONE;
+    pthread_cond_broadcast(&_condJobDone);
+  }
+
+  pthread_mutex_unlock(&_mtxJobs);
+  return NULL;
+};
+
+/* Stops and joins all worker threads */
+static void KV_StopIncludeThreads(void) {
+  size_t i;
+
+  pthread_mutex_lock(&_mtxJobs);
+  _bStopThreads = KV_true;
+  pthread_cond_broadcast(&_condJobQueued);
+  pthread_mutex_unlock(&_mtxJobs);
+
+  for (i = 0; i < _ctThreads; ++i) {
+    pthread_join(_aThreads[i], NULL);
+  }
+
+  KV_free(_aThreads);
+  _aThreads = NULL;
+  _ctThreads = 0;
+  _bStopThreads = KV_false;
+};
+
+KV_bool KV_SetIncludeThreads(size_t ct) {
+  if (_ctThreads) KV_StopIncludeThreads();
+  if (!ct) return KV_true;
+
+  _aThreads = (pthread_t *)KV_malloc(ct * sizeof(pthread_t));
+
+  while (_ctThreads < ct) {
+    if (pthread_create(&_aThreads[_ctThreads], NULL, KV_IncludeWorker, NULL) != 0) {
+      KV_StopIncludeThreads();
+      return KV_false;
+    }
+
+    ++_ctThreads;
+  }
+
+  return KV_true;
+};
+
+/* Checks if a file included in some context can be loaded on a worker thread.
+ * Symbol tables and the include cache are shared between all parsers and aren't thread-safe.
+ */
+KV_INLINE KV_bool KV_CanStartIncludeJob(KV_Context *ctx) {
+  return (_ctThreads && !ctx->_symbols && !_ctIncludeCacheLimit) ? KV_true : KV_false;
+};
+
+/* Queues an included file to be loaded on a worker thread */
+static KV_IncludeJob *KV_StartIncludeJob(KV_Context *ctx, KV_Token *file, size_t iOrder) {
+  KV_IncludeJob *job = (KV_IncludeJob *)KV_malloc(sizeof(KV_IncludeJob));
+
+  job->next = NULL;
+  job->file = KV_strdup(file->str);
+  job->ctxParent = *ctx;
+  job->iLine = file->line;
+
+  /* Parse into a separate document that's added to the parent one afterwards */
+  job->docParent = ctx->_document;
+  job->doc = (ctx->_document ? KV_NewDocument(ctx->_document->_blocksize) : NULL);
+
+  KV_ContextSetupFile(&job->ctx, ctx->_directory, job->file);
+  KV_ContextCopyFlags(&job->ctx, ctx);
+  KV_ContextSetDocument(&job->ctx, job->doc);
+
+  job->iOrder = iOrder;
+  job->list = NULL;
+  job->error.code = KV_ERROR_NONE;
+  job->eState = KV_JOB_PENDING;
+
+  pthread_mutex_lock(&_mtxJobs);
+
+  if (_jobLast) {
+    _jobLast->next = job;
+  } else {
+    _jobFirst = job;
+  }
+
+  _jobLast = job;
+
+  pthread_cond_signal(&_condJobQueued);
+  pthread_mutex_unlock(&_mtxJobs);
+
+  return job;
+};
+
+/* Waits for an included file to be loaded and frees the job.
+ * If no worker has taken the job yet, it's taken out of the queue and run right away, which also keeps nested includes
+ * from waiting on each other when all workers are busy.
+ * Returns the included list or NULL on error. If 'cancel' is set, destroys the list and always returns NULL.
+ */
+static KV_Pair *KV_FinishIncludeJob(KV_IncludeJob *job, KV_bool cancel) {
+  KV_IncludeJob *jobPrev;
+  KV_Pair *list;
+
+  pthread_mutex_lock(&_mtxJobs);
+
+  if (job->eState == KV_JOB_PENDING) {
+    /* Take it out of the queue */
+    if (_jobFirst == job) {
+      _jobFirst = job->next;
+      jobPrev = NULL;
+
+    } else {
+      for (jobPrev = _jobFirst; jobPrev->next != job; jobPrev = jobPrev->next);
+      jobPrev->next = job->next;
+    }
+
+    if (_jobLast == job) _jobLast = jobPrev;
+    pthread_mutex_unlock(&_mtxJobs);
+
+    if (!cancel) KV_RunIncludeJob(job, KV_false);
+
+  } else {
+    while (job->eState != KV_JOB_DONE) pthread_cond_wait(&_condJobDone, &_mtxJobs);
+    pthread_mutex_unlock(&_mtxJobs);
+  }
+
+  list = job->list;
+
+  if (cancel) {
+    if (list) KV_PairDestroy(list);
+    list = NULL;
+
+  } else if (job->error.code != KV_ERROR_NONE) {
+    _error = job->error;
+  }
+
+  /* Keep memory of the parsed list in the parent document */
+  if (job->doc) {
+    if (list) {
+      KV_DocumentAdopt(job->docParent, job->doc);
+    } else {
+      KV_DocumentDestroy(job->doc);
+    }
+  }
+
+  KV_free(job->file);
+  KV_free(job);
+
+  return list;
+};
+
+#else
+
+KV_bool KV_SetIncludeThreads(size_t ct) {
+  return (ct == 0) ? KV_true : KV_false;
+};
+
+#endif /* KV_USE_PTHREADS */
+
+KV_INLINE KV_Pair *KV_IncludeFile(KV_Context *ctx, KV_Token *file) {
+  /* Get the list from a file */
+  KV_Context ctxInclude;
+  KV_ContextSetupFile(&ctxInclude, ctx->_directory, file->str);
+  KV_ContextCopyFlags(&ctxInclude, ctx);
+  KV_ContextSetDocument(&ctxInclude, ctx->_document);
+  KV_ContextSetPool(&ctxInclude, ctx->_pool);
+
+  if (_ctIncludeCacheLimit) return KV_IncludeCachedFile(&ctxInclude, ctx, file->line);
+
+  return KV_ParseFileInternal(&ctxInclude, ctx, file->line);
+};
+
+KV_INLINE KV_bool KV_AppendIncludedPairs(KV_Context *ctx, KV_Pair *list, KV_Pair *listInclude, size_t iLine) {
+  KV_Pair *pairIter, *pairFind;
+
+  /* Append all pairs to the current list */
+  pairIter = listInclude->_value.head;
+
+  while (pairIter) {
+    /* Catch duplicate keys */
+    if (!ctx->_multikey && (pairFind = KV_FindSameKeyInBulk(list, pairIter))) {
+      /* Overwrite values under the same key */
+      if (ctx->_overwrite) {
+        KV_Swap(pairFind, pairIter);
+
+        /* Get the next subpair */
+        pairIter = pairIter->_next;
+        continue;
+      }
+
+      /* Or throw an error */
+      KV_SetContextError(ctx, iLine, KV_ERROR_DUPLICATE_INCLUDE, 0);
+      return KV_false;
+    }
+
+    /* Remember the current subpair and get the next one */
+    pairFind = pairIter;
+    pairIter = pairIter->_next;
+
+    /* Move that subpair over to the current list instead of copying it */
+    KV_AddTail(list, pairFind);
+  }
+
+  return KV_true;
+};
+
+KV_INLINE KV_bool KV_MergeBasePairs(KV_Pair *list, KV_Pair *listInclude) {
+  /* Moving nodes over from the temporary list to the current list */
+  KV_MergeNodes(list, listInclude, KV_true);
+  return KV_true;
+};
+
+KV_INLINE KV_bool KV_AddStringPair(KV_Context *ctx, KV_Pair *list, KV_Token *key, KV_Token *value) {
+  KV_Pair *pairFind;
+
+  /* Catch duplicate keys */
+  if (!ctx->_multikey && (pairFind = KV_FindToken(list, key))) {
+    /* Overwrite values under the same key */
+    if (ctx->_overwrite) {
+      KV_SetStringToken(ctx, pairFind, value);
+      return KV_true;
+    }
+
+    /* Or throw an error */
+    KV_SetContextError(ctx, value->line, KV_ERROR_DUPLICATE_KEY, 0);
+    return KV_false;
+  }
+
+  /* Append a new (or a duplicate) pair */
+  KV_AddTail(list, KV_ContextNewString(ctx, key, value));
+  return KV_true;
+};
+
+/* Begins another list under a key that's taken from a token */
+KV_INLINE void KV_BuilderPush(KV_Context *ctx, KV_Builder *builder, KV_Token *key) {
+  KV_Frame *frame;
+
+  /* Expand the stack of lists */
+  if (builder->ctUsed == builder->ctArray) {
+    builder->ctArray += 16;
+
+    if (builder->aFrames) {
+      builder->aFrames = (KV_Frame *)KV_realloc(builder->aFrames, builder->ctArray * sizeof(KV_Frame));
+    } else {
+      builder->aFrames = (KV_Frame *)KV_malloc(builder->ctArray * sizeof(KV_Frame));
+    }
+  }
+
+  frame = &builder->aFrames[builder->ctUsed++];
+  frame->list = KV_ContextNewList(ctx);
+  frame->tokKey = *key;
+  key->str = NULL;
+
+  KV_InitIncludes(&frame->inclIncludeFiles);
+  KV_InitIncludes(&frame->inclBaseFiles);
+};
+
+KV_INLINE void KV_InitBuilder(KV_Context *ctx, KV_Builder *builder) {
+  KV_Token tokGlobal;
+
+  builder->aFrames = NULL;
+  builder->ctArray = builder->ctUsed = 0;
+  builder->tokKey.str = NULL;
+  builder->tokKey.owned = KV_false;
+  builder->tokKey.symbol = KV_false;
+
+#ifdef KV_USE_PTHREADS
+  builder->ctJobs = 0;
+  builder->iFailedJob = (size_t)-1;
+#endif
+
+  /* The global list has no key */
+  tokGlobal.str = NULL;
+  tokGlobal.owned = KV_false;
+  tokGlobal.symbol = KV_false;
+  tokGlobal.line = 0;
+
+  KV_BuilderPush(ctx, builder, &tokGlobal);
+};
+
+#ifdef KV_USE_PTHREADS
+
+/* Finds a job that's still loading a file in some array, if it has been started before the earliest one found so far */
+KV_INLINE void KV_FindEarliestJob(KV_Includes *incl, size_t iBefore, KV_Includes **ppinclFound, size_t *piFound) {
+  size_t i;
+
+  for (i = 0; i < incl->ctUsed; ++i) {
+    if (!incl->aJobs[i]) continue;
+
+    /* Jobs in the same array are started in order */
+    if (incl->aJobs[i]->iOrder >= iBefore) return;
+    if (*ppinclFound && (*ppinclFound)->aJobs[*piFound]->iOrder < incl->aJobs[i]->iOrder) return;
+
+    *ppinclFound = incl;
+    *piFound = i;
+    return;
+  }
+};
+
+/* Waits for files that have been loading since before the parser has failed, in the order of their macros.
+ * If any of them couldn't be loaded, its error replaces the current one, just like it would stop the parser without threads.
+ */
+static void KV_JoinEarlierIncludes(KV_Builder *builder) {
+  KV_Includes *incl;
+  size_t iFrame, iJob, iOrder;
+
+  for (;;) {
+    incl = NULL;
+    iJob = 0;
+
+    for (iFrame = 0; iFrame < builder->ctUsed; ++iFrame) {
+      KV_FindEarliestJob(&builder->aFrames[iFrame].inclIncludeFiles, builder->iFailedJob, &incl, &iJob);
+      KV_FindEarliestJob(&builder->aFrames[iFrame].inclBaseFiles, builder->iFailedJob, &incl, &iJob);
+    }
+
+    if (!incl) return;
+
+    iOrder = incl->aJobs[iJob]->iOrder;
+    incl->aLists[iJob] = KV_FinishIncludeJob(incl->aJobs[iJob], KV_false);
+    incl->aJobs[iJob] = NULL;
+
+    /* Jobs started after this one cannot replace its error anymore */
+    if (!incl->aLists[iJob]) {
+      builder->iFailedJob = iOrder;
+      return;
+    }
+  }
+};
+
+#endif /* KV_USE_PTHREADS */
+
+/* Destroys all lists that are still being constructed after the parser has failed */
+KV_INLINE void KV_DestroyBuilder(KV_Builder *builder) {
+  KV_Frame *frame;
+
+#ifdef KV_USE_PTHREADS
+  KV_JoinEarlierIncludes(builder);
+#endif
+
+  while (builder->ctUsed) {
+    frame = &builder->aFrames[--builder->ctUsed];
+
+    if (frame->tokKey.str) KV_FreeToken(&frame->tokKey);
+    KV_DestroyIncludes(&frame->inclIncludeFiles);
+    KV_DestroyIncludes(&frame->inclBaseFiles);
+    KV_PairDestroy(frame->list);
+  }
+
+  if (builder->tokKey.str) KV_FreeToken(&builder->tokKey);
+
+  KV_free(builder->aFrames);
+  builder->aFrames = NULL;
+  builder->ctArray = 0;
+};
+
+/* Adds pairs from all included files to the innermost list that has been fully parsed */
+KV_INLINE KV_bool KV_FinishFrame(KV_Context *ctx, KV_Builder *builder) {
+  KV_Frame *frame = &builder->aFrames[builder->ctUsed - 1];
+  size_t iInclude;
+  KV_bool bResult = KV_true;
+
+#ifdef KV_USE_PTHREADS
+  /* Wait for files that are being loaded on worker threads */
+  bResult = KV_JoinIncludes(&frame->inclIncludeFiles, &builder->iFailedJob);
+  if (bResult) bResult = KV_JoinIncludes(&frame->inclBaseFiles, &builder->iFailedJob);
+
+  /* Files from earlier macros may still be loading, including the ones in this list */
+  if (!bResult) KV_JoinEarlierIncludes(builder);
+#endif
+
+  /* Append included pairs */
+  for (iInclude = 0; bResult && iInclude < frame->inclIncludeFiles.ctUsed; ++iInclude) {
+    bResult = KV_AppendIncludedPairs(ctx, frame->list, frame->inclIncludeFiles.aLists[iInclude], frame->inclIncludeFiles.aLines[iInclude]);
+  }
+
+  /* Merge base pairs */
+  for (iInclude = 0; bResult && iInclude < frame->inclBaseFiles.ctUsed; ++iInclude) {
+    bResult = KV_MergeBasePairs(frame->list, frame->inclBaseFiles.aLists[iInclude]);
+  }
+
+  KV_DestroyIncludes(&frame->inclIncludeFiles);
+  KV_DestroyIncludes(&frame->inclBaseFiles);
+
+  /* Only keep the index that has been built for catching duplicate keys if lists may be indexed */
+  KV_EndBulkLookups(frame->list, KV_false);
+
+  return bResult;
+};
+
+/* Adds a finished list under a key that's taken from a token to the innermost list */
+KV_INLINE KV_bool KV_BuilderAddList(KV_Context *ctx, KV_Builder *builder, KV_Pair *list, KV_Token *key) {
+  KV_Pair *listParent = builder->aFrames[builder->ctUsed - 1].list;
+  KV_Pair *pairFind;
+
+  /* Catch duplicate keys */
+  if (!ctx->_multikey && (pairFind = KV_FindToken(listParent, key))) {
+    /* Overwrite values under the same key */
+    if (ctx->_overwrite) {
+      /* Swap the found pair with the finished list */
+      KV_SetKeyToken(list, key);
+      KV_Swap(pairFind, list);
+
+      /* Finished list now contains the found pair data, which isn't needed anymore */
+      KV_PairDestroy(list);
+      return KV_true;
+    }
+
+    /* Or throw an error */
+    KV_SetContextError(ctx, ctx->_line, KV_ERROR_DUPLICATE_KEY, 0);
+
+    KV_FreeToken(key);
+    KV_PairDestroy(list);
+    return KV_false;
+  }
+
+  /* Append a new (or a duplicate) list */
+  KV_SetKeyToken(list, key);
+  KV_AddTail(listParent, list);
+
+  return KV_true;
+};
+
+/* Closes the innermost list and adds it to its parent list */
+KV_INLINE KV_bool KV_BuilderPop(KV_Context *ctx, KV_Builder *builder) {
+  KV_Frame *frame = &builder->aFrames[builder->ctUsed - 1];
+
+  assert(builder->ctUsed > 1);
+
+  /* The list is destroyed together with the builder on error */
+  if (!KV_FinishFrame(ctx, builder)) return KV_false;
+
+  --builder->ctUsed;
+  return KV_BuilderAddList(ctx, builder, frame->list, &frame->tokKey);
+};
+
+/* Skips over contents of a list under the pending key and adds it to the innermost list without parsing them */
+KV_INLINE KV_bool KV_BuilderLazy(KV_Context *ctx, KV_Builder *builder) {
+  const char *pchBegin = ctx->_pch;
+  const size_t iLine = ctx->_line;
+  size_t ctLength;
+  KV_Pair *list;
+
+  /* The pending key is freed together with the builder on error */
+  ctLength = KV_SkipList(ctx);
+  if (ctLength == (size_t)-1) return KV_false;
+
+  list = KV_ContextNewList(ctx);
+  list->_flags |= KV_PAIR_LAZY;
+  list->_value.lazy.begin = pchBegin;
+  list->_value.lazy.length = ctLength;
+  list->_value.lazy.line = iLine;
+  list->_value.lazy.source = ctx->_source;
+  ++ctx->_source->refs;
+
+  /* Document pairs need to release their reference together with the document */
+  KV_MarkDirty(list);
+
+  return KV_BuilderAddList(ctx, builder, list, &builder->tokKey);
+};
+
+/* Adds a string value under the pending key to the innermost list or executes a macro */
+KV_INLINE KV_bool KV_BuilderValue(KV_Context *ctx, KV_Builder *builder, KV_Token *value) {
+  KV_Frame *frame = &builder->aFrames[builder->ctUsed - 1];
+  KV_Includes *pinclMacro;
+  KV_Pair *listInclude;
+
+  /* Include macros */
+  if (KV_IsMacro(builder->tokKey.str, (size_t)-1, "#include")) {
+    pinclMacro = &frame->inclIncludeFiles;
+  } else if (KV_IsMacro(builder->tokKey.str, (size_t)-1, "#base")) {
+    pinclMacro = &frame->inclBaseFiles;
+  } else {
+    pinclMacro = NULL;
+  }
+
+  if (pinclMacro) {
+  #ifdef KV_USE_PTHREADS
+    /* Load the file on a worker thread while parsing the rest of the list */
+    if (KV_CanStartIncludeJob(ctx)) {
+      KV_AddInclude(pinclMacro, NULL, value->line);
+      pinclMacro->aJobs[pinclMacro->ctUsed - 1] = KV_StartIncludeJob(ctx, value, builder->ctJobs++);
+
+      KV_FreeToken(&builder->tokKey);
+      KV_FreeToken(value);
+      return KV_true;
+    }
+  #endif
+
+    /* Added pairs from the included list */
+    listInclude = KV_IncludeFile(ctx, value);
+    if (listInclude) KV_AddInclude(pinclMacro, listInclude, value->line);
+
+    /* Free strings after macro execution */
+    KV_FreeToken(&builder->tokKey);
+    KV_FreeToken(value);
+
+    return (listInclude != NULL) ? KV_true : KV_false;
+  }
+
+  /* Added a string value under some key */
+  if (KV_AddStringPair(ctx, frame->list, &builder->tokKey, value)) {
+    /* Free strings that haven't been adopted by a pair */
+    if (builder->tokKey.str) KV_FreeToken(&builder->tokKey);
+    if (value->str) KV_FreeToken(value);
+    return KV_true;
+  }
+
+  /* Or errored out */
+  KV_FreeToken(value);
+  return KV_false;
+};
+
+/* Adds the next token scanned by KV_NextToken() to the lists that are being constructed.
+ * Returns KV_false on error, after which the builder can only be destroyed.
+ */
+KV_INLINE KV_bool KV_BuilderToken(KV_Context *ctx, KV_Builder *builder, KV_TokenType eToken, const KV_Span *span) {
+  KV_Token tokTemp;
+
+  /* Lists: Begin another list under the current key */
+  if (eToken == KV_TOKEN_OPEN) {
+    /* Lists without a key are put under an empty key */
+    if (!builder->tokKey.str) {
+      KV_EmptyToken(ctx, &builder->tokKey, span->line);
+      if (ctx->_symbols) KV_InternToken(&builder->tokKey);
+    }
+
+    /* Only remember where contents of the list are, if recording lazy lists */
+    if (ctx->_source) return KV_BuilderLazy(ctx, builder);
+
+    KV_BuilderPush(ctx, builder, &builder->tokKey);
+    return KV_true;
+  }
+
+  if (eToken == KV_TOKEN_CLOSE) {
+    /* Nothing to close outside of inner lists */
+    if (builder->ctUsed == 1) {
+      KV_SetContextError(ctx, span->line, KV_ERROR_UNEXPECTED_BRACE, 0);
+      return KV_false;
+    }
+
+    /* Otherwise set an empty value before closing the list, if expecting it */
+    if (builder->tokKey.str) {
+      KV_EmptyToken(ctx, &tokTemp, span->line);
+      if (!KV_BuilderValue(ctx, builder, &tokTemp)) return KV_false;
+    }
+
+    return KV_BuilderPop(ctx, builder);
+  }
+
+  /* Remember this key string for future use */
+  if (!builder->tokKey.str) {
+    if (ctx->_symbols) {
+      KV_ParseSymbol(ctx, span, &builder->tokKey);
+    } else {
+      KV_ParseString(ctx, span, &builder->tokKey);
+    }
+
+    return KV_true;
+  }
+
+  KV_ParseString(ctx, span, &tokTemp);
+  return KV_BuilderValue(ctx, builder, &tokTemp);
+};
+
+/* Closes all lists that have been left open and returns the global list or NULL on error.
+ * If the global list has been closed by a brace (contents of a lazy list), the pending key gets an empty value.
+ * The builder is destroyed afterwards either way.
+ */
+KV_INLINE KV_Pair *KV_BuilderFinish(KV_Context *ctx, KV_Builder *builder, KV_bool bClosed) {
+  KV_Token tokTemp;
+  KV_Pair *list;
+
+  if (bClosed && builder->ctUsed == 1 && builder->tokKey.str) {
+    KV_EmptyToken(ctx, &tokTemp, ctx->_line);
+
+    if (!KV_BuilderValue(ctx, builder, &tokTemp)) {
+      KV_DestroyBuilder(builder);
+      return NULL;
+    }
+  }
+
+  /* Free the key that never got a value */
+  if (builder->tokKey.str) KV_FreeToken(&builder->tokKey);
+
+  while (builder->ctUsed > 1) {
+    if (!KV_BuilderPop(ctx, builder)) {
+      KV_DestroyBuilder(builder);
+      return NULL;
+    }
+  }
+
+  if (!KV_FinishFrame(ctx, builder)) {
+    KV_DestroyBuilder(builder);
+    return NULL;
+  }
+
+  /* Done parsing */
+  list = builder->aFrames[0].list;
+  KV_free(builder->aFrames);
+
+  return list;
+};
+
+/* Parses the entire buffer from the context into a global list */
+static KV_Pair *KV_ParseContents(KV_Context *ctx, KV_bool bClosed) {
+  KV_Builder builder;
+  KV_TokenType eToken;
+  KV_Span span;
+  KV_Pair *list;
+
+  /* Record nested lists from the buffer that outlives the parser */
+  if (ctx->_lazy && !ctx->_source) ctx->_source = KV_NewLazySource(ctx, NULL);
+
+  KV_InitBuilder(ctx, &builder);
+
+  while ((eToken = KV_NextToken(ctx, &span)) != KV_TOKEN_END) {
+    /* Couldn't scan a string token or construct a list */
+    if (eToken == KV_TOKEN_ERROR || !KV_BuilderToken(ctx, &builder, eToken, &span)) {
+      KV_DestroyBuilder(&builder);
+      list = NULL;
+      break;
+    }
+  }
+
+  if (eToken == KV_TOKEN_END) list = KV_BuilderFinish(ctx, &builder, bClosed);
+
+  /* Lazy lists keep their own references to the contents */
+  if (ctx->_source) {
+    KV_ReleaseLazySource(ctx->_source);
+    ctx->_source = NULL;
+  }
+
+  return list;
+};
+
+KV_Pair *KV_ParseBufferInternal(KV_Context *ctx) {
+  return KV_ParseContents(ctx, KV_false);
+};
+
+KV_Pair *KV_Parse(KV_Context *ctx) {
+  KV_Pair *list;
+  assert(ctx);
+
+  if (ctx->_file) {
+    list = KV_ParseFileInternal(ctx, NULL, 0);
+  } else {
+    list = KV_ParseBufferInternal(ctx);
+  }
+
+  /* Remember the list in case heap memory will be added to it */
+  if (list && ctx->_document) KV_DocumentAddRoot(ctx->_document, list);
+
+  return list;
+};
+
+KV_Pair *KV_ParseBuffer(const char *buffer, size_t length) {
+  KV_Context ctx;
+
+  assert(buffer);
+  KV_ContextSetupBuffer(&ctx, "", buffer, length);
+
+  return KV_ParseBufferInternal(&ctx);
+};
+
+KV_Pair *KV_ParseFile(const char *path) {
+  KV_Context ctx;
+
+  assert(path);
+  KV_ContextSetupFile(&ctx, "", path);
+
+  return KV_ParseFileInternal(&ctx, NULL, 0);
+};
+
+/* Files that are being parsed together by KV_ParseFilesParallel() */
+typedef struct _KV_ParseBatch {
+  const char **paths;
+  size_t ct;
+  KV_Context *contexts;
+  KV_Pair **results;
+  KV_Error *errors;
+
+  size_t iNext; /* Next file to take by any thread */
+#ifdef KV_USE_PTHREADS
+  KV_bool threaded; /* Files are parsed on multiple threads */
+  pthread_mutex_t mtx;
+#endif
+} KV_ParseBatch;
+
+/* Parses one file from a batch on the current thread */
+static void KV_ParseBatchFile(KV_ParseBatch *batch, size_t i) {
+  KV_Context ctx;
+  KV_Document *doc = NULL;
+
+  if (batch->contexts) {
+    doc = batch->contexts[i]._document;
+
+    KV_ContextSetupFile(&ctx, batch->contexts[i]._directory, batch->paths[i]);
+    KV_ContextCopyFlags(&ctx, &batch->contexts[i]);
+  } else {
+    KV_ContextSetupFile(&ctx, "", batch->paths[i]);
+  }
+
+#ifdef KV_USE_PTHREADS
+  /* Documents may be shared between files, so each one is parsed into a separate document that's added to it afterwards */
+  if (doc && batch->threaded) {
+    KV_ContextSetDocument(&ctx, KV_NewDocument(doc->_blocksize));
+    batch->results[i] = KV_Parse(&ctx);
+
+    if (batch->results[i]) {
+      pthread_mutex_lock(&batch->mtx);
+      KV_DocumentAdopt(doc, ctx._document);
+      pthread_mutex_unlock(&batch->mtx);
+
+    } else {
+      KV_DocumentDestroy(ctx._document);
+    }
+
+  } else
+#endif
+  {
+    KV_ContextSetDocument(&ctx, doc);
+    batch->results[i] = KV_Parse(&ctx);
+  }
+
+  if (batch->errors) batch->errors[i] = _error;
+  KV_ResetError();
+};
+
+/* Keeps taking files from a batch until there are none left, so threads that get smaller files parse more of them */
+static void *KV_ParseBatchWorker(void *arg) {
+  KV_ParseBatch *batch = (KV_ParseBatch *)arg;
+  size_t i;
+
+  for (;;) {
+  #ifdef KV_USE_PTHREADS
+    pthread_mutex_lock(&batch->mtx);
+    i = batch->iNext++;
+    pthread_mutex_unlock(&batch->mtx);
+  #else
+    i = batch->iNext++;
+  #endif
+
+    if (i >= batch->ct) break;
+    KV_ParseBatchFile(batch, i);
+  }
+
+  return NULL;
+};
+
+KV_bool KV_ParseFilesParallel(const char **paths, size_t count, KV_Context *contexts, KV_Pair **results, KV_Error *errors, size_t threads) {
+  KV_ParseBatch batch;
+  size_t i;
+#ifdef KV_USE_PTHREADS
+  pthread_t *aThreads;
+  size_t ctStarted;
+  long ctProcessors;
+#endif
+
+  assert(paths && results);
+
+  batch.paths = paths;
+  batch.ct = count;
+  batch.contexts = contexts;
+  batch.results = results;
+  batch.errors = errors;
+  batch.iNext = 0;
+
+  /* Successfully parsed files keep the error cleared */
+  KV_ResetError();
+
+#ifdef KV_USE_PTHREADS
+  /* One thread per processor */
+  if (!threads) {
+    ctProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (ctProcessors > 0) ? (size_t)ctProcessors : 1;
+  }
+
+  if (threads > count) threads = count;
+
+  /* Symbol tables and the include cache aren't thread-safe */
+  if (_ctIncludeCacheLimit) threads = 1;
+
+  for (i = 0; contexts && threads > 1 && i < count; ++i) {
+    if (contexts[i]._symbols) threads = 1;
+  }
+
+  pthread_mutex_init(&batch.mtx, NULL);
+  batch.threaded = (threads > 1) ? KV_true : KV_false;
+  aThreads = NULL;
+  ctStarted = 0;
+
+  if (threads > 1) {
+    aThreads = (pthread_t *)KV_malloc((threads - 1) * sizeof(pthread_t));
+
+    for (; ctStarted < threads - 1; ++ctStarted) {
+      if (pthread_create(&aThreads[ctStarted], NULL, KV_ParseBatchWorker, &batch) != 0) break;
+    }
+  }
+
+  /* The current thread parses files as well */
+  KV_ParseBatchWorker(&batch);
+
+  for (i = 0; i < ctStarted; ++i) {
+    pthread_join(aThreads[i], NULL);
+  }
+
+  if (aThreads) KV_free(aThreads);
+  pthread_mutex_destroy(&batch.mtx);
+
+#else
+  (void)threads;
+  KV_ParseBatchWorker(&batch);
+#endif
+
+  for (i = 0; i < count; ++i) {
+    if (!results[i]) return KV_false;
+  }
+
+  return KV_true;
+};
+
+void KV_ContextSetupStream(KV_Context *ctx, const char *directory) {
+  KV_Stream *stream;
+
+  /* Chunks are parsed from the stream buffer */
+  KV_ContextSetupBuffer(ctx, directory, NULL, 0);
+
+  stream = (KV_Stream *)KV_malloc(sizeof(KV_Stream));
+  stream->started = KV_false;
+  stream->failed = KV_false;
+  stream->finished = KV_false;
+
+  stream->buffer = NULL;
+  stream->length = stream->size = 0;
+  stream->eComment = KV_COMMENT_NONE;
+
+  ctx->_stream = stream;
+};
+
+/* Parses all complete tokens in the stream buffer and leaves the rest of the characters for the next chunk */
+static KV_bool KV_StreamParse(KV_Context *ctx) {
+  KV_Stream *stream = ctx->_stream;
+  KV_TokenType eToken;
+  KV_Span span;
+
+  /* Set up the builder only now in case the document has been set after setting up the context */
+  if (!stream->started) {
+    KV_InitBuilder(ctx, &stream->builder);
+    stream->started = KV_true;
+  }
+
+  ctx->_buffer = ctx->_pch = stream->buffer;
+  ctx->_length = stream->length;
+
+  /* Finish skipping the comment from the last chunk */
+  if (stream->eComment != KV_COMMENT_NONE) stream->eComment = KV_SkipComment(ctx, stream->eComment);
+
+  while ((eToken = KV_NextToken(ctx, &span)) != KV_TOKEN_END && eToken != KV_TOKEN_MORE) {
+    /* Couldn't scan a string token or construct a list */
+    if (eToken == KV_TOKEN_ERROR || !KV_BuilderToken(ctx, &stream->builder, eToken, &span)) {
+      KV_DestroyBuilder(&stream->builder);
+      stream->failed = KV_true;
+      return KV_false;
+    }
+  }
+
+  /* Move unparsed characters to the beginning */
+  if (ctx->_pch != stream->buffer) {
+    stream->length -= ctx->_pch - stream->buffer;
+    memmove(stream->buffer, ctx->_pch, stream->length);
+  }
+
+  return KV_true;
+};
+
+KV_bool KV_Feed(KV_Context *ctx, const char *chunk, size_t length) {
+  KV_Stream *stream;
+
+  assert(ctx && ctx->_stream);
+  assert(chunk || !length);
+
+  stream = ctx->_stream;
+  if (stream->failed) return KV_false;
+
+  /* Expand the stream buffer to fit the chunk after unparsed characters */
+  if (stream->length + length > stream->size) {
+    stream->size = stream->size * 2;
+    if (stream->size < stream->length + length) stream->size = stream->length + length;
+
+    if (stream->buffer) {
+      stream->buffer = (char *)KV_realloc(stream->buffer, stream->size);
+    } else {
+      stream->buffer = (char *)KV_malloc(stream->size);
+    }
+  }
+
+  if (length) memcpy(stream->buffer + stream->length, chunk, length);
+  stream->length += length;
+
+  return KV_StreamParse(ctx);
+};
+
+KV_Pair *KV_Finish(KV_Context *ctx) {
+  KV_Stream *stream;
+  KV_Pair *list = NULL;
+
+  assert(ctx && ctx->_stream);
+  stream = ctx->_stream;
+
+  /* Parse the rest of the characters as if they were at the end of a regular buffer */
+  if (!stream->failed) {
+    stream->finished = KV_true;
+    if (KV_StreamParse(ctx)) list = KV_BuilderFinish(ctx, &stream->builder, KV_false);
+  }
+
+  /* Remember the list in case heap memory will be added to it */
+  if (list && ctx->_document) KV_DocumentAddRoot(ctx->_document, list);
+
+  KV_free(stream->buffer);
+  KV_free(stream);
+
+  ctx->_stream = NULL;
+  ctx->_buffer = ctx->_pch = NULL;
+  ctx->_length = 0;
+
+  return list;
+};
+
+/* Expanding buffer for decoding strings with escape sequences */
+typedef struct _KV_Scratch {
+  char *buffer;
+  size_t size;
+} KV_Scratch;
+
+/* Sets up an empty string token for keys and values that are omitted before curly braces */
+KV_INLINE void KV_EmptySpan(KV_Span *span, size_t iLine) {
+  span->pch = "";
+  span->ct = 0;
+  span->line = iLine;
+};
+
+/* Returns characters of a scanned string token, decoding escape sequences into a scratch buffer only if there are any */
+KV_INLINE const char *KV_ViewString(KV_Context *ctx, const KV_Span *span, KV_Scratch *scratch, size_t *length) {
+  /* Nothing to decode */
+  if (!ctx->_escapeseq || !memchr(span->pch, '\\', span->ct)) {
+    *length = span->ct;
+    return span->pch;
+  }
+
+  /* Expand the buffer to fit the raw string */
+  if (scratch->size < span->ct) {
+    scratch->size = (span->ct > scratch->size * 2) ? span->ct : scratch->size * 2;
+    KV_free(scratch->buffer);
+    scratch->buffer = (char *)KV_malloc(scratch->size);
+  }
+
+  *length = KV_DecodeString(ctx, scratch->buffer, span->pch, span->ct);
+  return scratch->buffer;
+};
+
+static KV_bool KV_ParseEventsInternal(KV_Context *ctx, const KV_Events *events, void *data) {
+  KV_TokenType eToken;
+  KV_Span span, spanKey;
+  KV_bool bKey, bResult;
+  size_t iDepth;
+
+  KV_Scratch scratchKey, scratchValue;
+  const char *strKey, *strValue;
+  size_t ctKey, ctValue;
+
+  bKey = KV_false; /* Set if expecting a value for the key in 'spanKey' */
+  bResult = KV_true;
+  iDepth = 0;
+  KV_EmptySpan(&spanKey, 0);
+
+  scratchKey.buffer = scratchValue.buffer = NULL;
+  scratchKey.size = scratchValue.size = 0;
+
+  while ((eToken = KV_NextToken(ctx, &span)) != KV_TOKEN_END) {
+    /* Couldn't scan a string token */
+    if (eToken == KV_TOKEN_ERROR) {
+      bResult = KV_false;
+      break;
+    }
+
+    /* Lists: Begin another list under the current key */
+    if (eToken == KV_TOKEN_OPEN) {
+      /* Lists without a key are put under an empty key */
+      if (!bKey) KV_EmptySpan(&spanKey, span.line);
+
+      bKey = KV_false;
+      ++iDepth;
+
+      strKey = KV_ViewString(ctx, &spanKey, &scratchKey, &ctKey);
+
+      if (events->_key && !events->_key(data, strKey, ctKey)) break;
+      if (events->_beginlist && !events->_beginlist(data)) break;
+      continue;
+    }
+
+    if (eToken == KV_TOKEN_CLOSE) {
+      /* Nothing to close outside of inner lists */
+      if (!iDepth) {
+        KV_SetContextError(ctx, span.line, KV_ERROR_UNEXPECTED_BRACE, 0);
+        bResult = KV_false;
+        break;
+      }
+
+      /* List end, if not expecting a value */
+      if (!bKey) {
+        --iDepth;
+
+        if (events->_endlist && !events->_endlist(data)) break;
+        continue;
+      }
+
+      /* Otherwise pass an empty value and close the list on the next token */
+      KV_EmptySpan(&span, span.line);
+      --ctx->_pch;
+    }
+
+    /* Remember this key string for future use */
+    if (!bKey) {
+      spanKey = span;
+      bKey = KV_true;
+      continue;
+    }
+
+    bKey = KV_false;
+
+    strKey = KV_ViewString(ctx, &spanKey, &scratchKey, &ctKey);
+    strValue = KV_ViewString(ctx, &span, &scratchValue, &ctValue);
+
+    /* Include macros */
+    if (KV_IsMacro(strKey, ctKey, "#include")) {
+      if (events->_include && !events->_include(data, KV_false, strValue, ctValue)) break;
+      continue;
+
+    } else if (KV_IsMacro(strKey, ctKey, "#base")) {
+      if (events->_include && !events->_include(data, KV_true, strValue, ctValue)) break;
+      continue;
+    }
+
+    /* String value under some key */
+    if (events->_key && !events->_key(data, strKey, ctKey)) break;
+    if (events->_string && !events->_string(data, strValue, ctValue)) break;
+  }
+
+  /* Close lists that are left open at the end, like the parser does */
+  if (eToken == KV_TOKEN_END && events->_endlist) {
+    for (; iDepth; --iDepth) {
+      if (!events->_endlist(data)) break;
+    }
+  }
+
+  KV_free(scratchKey.buffer);
+  KV_free(scratchValue.buffer);
+
+  return bResult;
+};
+
+KV_bool KV_ParseEvents(KV_Context *ctx, const KV_Events *events, void *data) {
+  KV_FileData file;
+  KV_Context ctxParse;
+  KV_bool bResult;
+
+  assert(ctx && events);
+
+  if (!ctx->_file) return KV_ParseEventsInternal(ctx, events, data);
+
+  if (!KV_ContextLoadFile(ctx, NULL, 0, &file, &ctxParse)) return KV_false;
+
+  bResult = KV_ParseEventsInternal(&ctxParse, events, data);
+  KV_ReleaseFile(&file);
+
+  return bResult;
+};
+
+KV_bool KV_Save(KV_Pair *pair, const char *path) {
+  FILE *file;
+  KV_Sink sink;
+  KV_bool bResult;
+
+  assert(pair && path);
+
+  if (!pair || !path) {
+    KV_SetError(KV_ERROR_NO_ARGUMENT, 0);
+    return KV_false;
+  }
+
+  file = fopen(path, "w");
+
+  if (!file) {
+    KV_SetError(KV_ERROR_SAVE_FILE, errno);
+    return KV_false;
+  }
+
+  /* Write the file as it's being printed */
+  KV_SinkSetupFile(&sink, file);
+  bResult = KV_PrintToSink(pair, &sink, "\t");
+
+  if (fclose(file) != 0 && bResult) {
+    KV_SetError(KV_ERROR_WRITE_SINK, errno);
+    bResult = KV_false;
+  }
+
+  return bResult;
+};
+
+/*********************************************************************************************************************************
+ * Binary format
+ *********************************************************************************************************************************/
+
+/* Sizes of typed values in binary contents */
+static const size_t _actBinaryValues[KV_TYPE_NUMTYPES] = {
+  0, /* KV_TYPE_NONE */
+  0, /* KV_TYPE_STRING */
+  4, /* KV_TYPE_INT */
+  4, /* KV_TYPE_FLOAT */
+  4, /* KV_TYPE_PTR */
+  0, /* KV_TYPE_WSTRING */
+  4, /* KV_TYPE_COLOR */
+  8, /* KV_TYPE_UINT64 */
+};
+
+/* Reads a little-endian 32-bit number from binary contents */
+KV_INLINE unsigned long KV_ReadUint32(const unsigned char *pch) {
+  return (unsigned long)pch[0] | ((unsigned long)pch[1] << 8) | ((unsigned long)pch[2] << 16) | ((unsigned long)pch[3] << 24);
+};
+
+/* Writes a little-endian 32-bit number into binary contents */
+KV_INLINE void KV_PrinterAppendUint32(KV_Printer *ctx, unsigned long value) {
+  char str[4];
+
+  str[0] = (char)(value & 0xFF);
+  str[1] = (char)((value >> 8) & 0xFF);
+  str[2] = (char)((value >> 16) & 0xFF);
+  str[3] = (char)((value >> 24) & 0xFF);
+
+  KV_PrinterAppend(ctx, str, 4);
+};
+
+/* Copies a string of a known length from binary contents into a document or onto the heap */
+KV_INLINE char *KV_CopyBinaryString(KV_Document *doc, const unsigned char *str, size_t length) {
+  char *strNew = (doc ? (char *)KV_DocumentAlloc(doc, length + 1, 1) : (char *)KV_malloc(length + 1));
+
+  memcpy(strNew, str, length + 1);
+  return strNew;
+};
+
+/* Reads a typed value of a pair from binary contents that are long enough */
+KV_INLINE void KV_ReadBinaryValue(KV_Pair *pair, const unsigned char *pch) {
+  unsigned long iValue;
+  unsigned int iBits;
+
+  switch (pair->_type) {
+    case KV_TYPE_INT:
+      iValue = KV_ReadUint32(pch);
+
+      /* Convert from two's complement without relying on implementation-defined conversions */
+      if (iValue & 0x80000000UL) {
+        pair->_value.i = -(int)(~iValue & 0x7FFFFFFFUL) - 1;
+      } else {
+        pair->_value.i = (int)iValue;
+      }
+      break;
+
+    case KV_TYPE_FLOAT:
+      assert(sizeof(iBits) == sizeof(float));
+      iBits = (unsigned int)KV_ReadUint32(pch);
+      memcpy(&pair->_value.f, &iBits, sizeof(float));
+      break;
+
+    case KV_TYPE_PTR:
+      pair->_value.ptr = (void *)(size_t)KV_ReadUint32(pch);
+      break;
+
+    case KV_TYPE_COLOR:
+      pair->_value.color.r = pch[0];
+      pair->_value.color.g = pch[1];
+      pair->_value.color.b = pch[2];
+      pair->_value.color.a = pch[3];
+      break;
+
+    case KV_TYPE_UINT64:
+      pair->_value.u64 = (KV_uint64)KV_ReadUint32(pch) | ((KV_uint64)KV_ReadUint32(pch + 4) << 32);
+      break;
+
+    default:
+      assert(!"Not a typed value");
+      break;
+  }
+};
+
+/* Constructs a list of subpairs out of binary contents in a parser context without recursion.
+ * Errors are located by the byte offset of the value that couldn't be read.
+ */
+static KV_Pair *KV_ParseBinaryInternal(KV_Context *ctx) {
+  KV_Document *doc = ctx->_document;
+  const unsigned char *pch = (const unsigned char *)ctx->_buffer;
+  const unsigned char *pchEnd = pch + ctx->_length;
+  const unsigned char *pchString;
+  KV_Pair *root, *list, *pair;
+  KV_ErrorCode eError;
+  unsigned char iType;
+
+  root = KV_ContextNewList(ctx);
+  list = root;
+
+  for (;;) {
+    /* Top level may end together with the contents */
+    if (pch == pchEnd) {
+      if (list == root) break;
+
+      eError = KV_ERROR_BINARY_END;
+      goto error;
+    }
+
+    iType = *pch;
+
+    /* End of the current list */
+    if (iType == KV_TYPE_NUMTYPES) {
+      ++pch;
+      if (list == root) break;
+
+      list = list->_parent;
+      continue;
+    }
+
+    if (iType > KV_TYPE_NUMTYPES || iType == KV_TYPE_WSTRING) {
+      eError = KV_ERROR_BINARY_TYPE;
+      goto error;
+    }
+
+    /* Key of the next pair */
+    pchString = (const unsigned char *)memchr(pch + 1, '\0', (size_t)(pchEnd - pch - 1));
+
+    if (!pchString) {
+      eError = KV_ERROR_BINARY_END;
+      goto error;
+    }
+
+    /* Add an empty list first to be able to free it on error */
+    pair = KV_ContextNewList(ctx);
+    pair->_key = KV_CopyBinaryString(doc, pch + 1, (size_t)(pchString - pch - 1));
+    if (doc) pair->_flags |= KV_PAIR_KEYREF;
+
+    KV_AddTail(list, pair);
+    pch = pchString + 1;
+
+    switch (iType) {
+      case KV_TYPE_NONE:
+        list = pair;
+        continue;
+
+      case KV_TYPE_STRING:
+        pchString = (const unsigned char *)memchr(pch, '\0', (size_t)(pchEnd - pch));
+
+        if (!pchString) {
+          eError = KV_ERROR_BINARY_END;
+          goto error;
+        }
+
+        pair->_type = KV_TYPE_STRING;
+        pair->_value.str = KV_CopyBinaryString(doc, pch, (size_t)(pchString - pch));
+        if (doc) pair->_flags |= KV_PAIR_STRREF;
+
+        pch = pchString + 1;
+        break;
+
+      default:
+        if ((size_t)(pchEnd - pch) < _actBinaryValues[iType]) {
+          eError = KV_ERROR_BINARY_END;
+          goto error;
+        }
+
+        pair->_type = (KV_DataType)iType;
+        KV_ReadBinaryValue(pair, pch);
+
+        pch += _actBinaryValues[iType];
+        break;
+    }
+  }
+
+  /* Remember the list in case heap memory will be added to it */
+  if (doc) KV_DocumentAddRoot(doc, root);
+
+  return root;
+
+error:
+  ctx->_pch = (const char *)pch;
+  KV_SetContextError(ctx, 0, eError, 0);
+
+  /* Pairs from documents are freed together with them */
+  if (!doc) KV_PairDestroy(root);
+  return NULL;
+};
+
+KV_Pair *KV_ParseBinary(const void *buffer, size_t length, KV_Document *doc) {
+  KV_Context ctx;
+
+  assert(buffer);
+
+  KV_ContextSetupBuffer(&ctx, "", (const char *)buffer, length);
+  KV_ContextSetDocument(&ctx, doc);
+
+  return KV_ParseBinaryInternal(&ctx);
+};
+
+KV_Pair *KV_ParseBinaryFile(const char *path, KV_Document *doc) {
+  KV_Context ctx, ctxParse;
+  KV_FileData data;
+  KV_Pair *list;
+
+  assert(path);
+
+  KV_ContextSetupFile(&ctx, "", path);
+  KV_ContextSetDocument(&ctx, doc);
+
+  if (!KV_ContextLoadFile(&ctx, NULL, 0, &data, &ctxParse)) return NULL;
+
+  list = KV_ParseBinaryInternal(&ctxParse);
+
+  KV_ReleaseFile(&data);
+  return list;
+};
+
+/* Writes a pair with all of its subpairs as binary contents in the same order as KV_PrintInternal() prints them.
+ * Lists without keys only have their subpairs written, so they don't need to be terminated.
+ */
+static KV_bool KV_WriteBinaryInternal(KV_Pair *root, KV_Printer *ctx, const KV_Sink *sink) {
+  KV_Pair *pair = root;
+  char chType;
+
+  assert(root);
+
+  for (;;) {
+    if (!KV_PrinterFlushChunk(ctx, sink)) return KV_false;
+
+    /* Type and key */
+    if (pair->_key) {
+      chType = (char)pair->_type;
+
+      KV_PrinterAppend(ctx, &chType, 1);
+      KV_PrinterAppend(ctx, pair->_key, strlen(pair->_key) + 1);
+
+    /* The value without key cannot be written */
+    } else if (pair->_type != KV_TYPE_NONE) {
+      KV_SetError(KV_ERROR_NO_KEY, 0);
+      return KV_false;
+    }
+
+    /* Value */
+    switch (pair->_type) {
+      case KV_TYPE_NONE:
+        if (!KV_EnsureParsed(pair)) return KV_false;
+
+        if (pair->_value.head) {
+          pair = pair->_value.head;
+          continue;
+        }
+        break;
+
+      case KV_TYPE_STRING:
+        KV_PrinterAppend(ctx, pair->_value.str, strlen(pair->_value.str) + 1);
+        break;
+
+      case KV_TYPE_INT:
+        KV_PrinterAppendUint32(ctx, (unsigned long)pair->_value.i & 0xFFFFFFFFUL);
+        break;
+
+      case KV_TYPE_FLOAT: {
+        unsigned int iBits;
+
+        assert(sizeof(iBits) == sizeof(float));
+        memcpy(&iBits, &pair->_value.f, sizeof(float));
+
+        KV_PrinterAppendUint32(ctx, (unsigned long)iBits);
+      } break;
+
+      case KV_TYPE_PTR:
+        KV_PrinterAppendUint32(ctx, (unsigned long)((size_t)pair->_value.ptr & 0xFFFFFFFFUL));
+        break;
+
+      case KV_TYPE_COLOR: {
+        char str[4];
+
+        str[0] = (char)pair->_value.color.r;
+        str[1] = (char)pair->_value.color.g;
+        str[2] = (char)pair->_value.color.b;
+        str[3] = (char)pair->_value.color.a;
+
+        KV_PrinterAppend(ctx, str, 4);
+      } break;
+
+      case KV_TYPE_UINT64:
+        KV_PrinterAppendUint32(ctx, (unsigned long)(pair->_value.u64 & 0xFFFFFFFFUL));
+        KV_PrinterAppendUint32(ctx, (unsigned long)(pair->_value.u64 >> 32));
+        break;
+
+      default: {
+        /* Unknown value type */
+        assert(!"Unknown value type");
+
+        KV_SetError(KV_ERROR_UNKNOWN_TYPE, 0);
+        return KV_false;
+      }
+    }
+
+    /* Terminate finished lists up the hierarchy until there's a next pair to write */
+    for (;;) {
+      if (pair->_type == KV_TYPE_NONE && pair->_key) {
+        if (!KV_PrinterFlushChunk(ctx, sink)) return KV_false;
+
+        chType = (char)KV_TYPE_NUMTYPES;
+        KV_PrinterAppend(ctx, &chType, 1);
+      }
+
+      if (pair == root) {
+        /* Terminate the top level */
+        chType = (char)KV_TYPE_NUMTYPES;
+        KV_PrinterAppend(ctx, &chType, 1);
+        return KV_true;
+      }
+
+      if (pair->_next) {
+        pair = pair->_next;
+        break;
+      }
+
+      pair = pair->_parent;
+    }
+  }
+};
+
+KV_bool KV_WriteBinary(KV_Pair *pair, const KV_Sink *sink) {
+  KV_Printer printer;
+  KV_bool bResult;
+
+  assert(pair && sink && sink->_write);
+  KV_PrinterInit(&printer, KV_SINK_CHUNKSIZE);
+
+  bResult = KV_WriteBinaryInternal(pair, &printer, sink);
+  if (bResult) bResult = KV_PrinterFlush(&printer, sink);
+
+  KV_PrinterClear(&printer);
+  return bResult;
+};
+
+KV_bool KV_SaveBinary(KV_Pair *pair, const char *path) {
+  FILE *file;
+  KV_Sink sink;
+  KV_bool bResult;
+
+  assert(pair && path);
+
+  if (!pair || !path) {
+    KV_SetError(KV_ERROR_NO_ARGUMENT, 0);
+    return KV_false;
+  }
+
+  file = fopen(path, "wb");
+
+  if (!file) {
+    KV_SetError(KV_ERROR_SAVE_FILE, errno);
+    return KV_false;
+  }
+
+  KV_SinkSetupFile(&sink, file);
+  bResult = KV_WriteBinary(pair, &sink);
+
+  if (fclose(file) != 0 && bResult) {
+    KV_SetError(KV_ERROR_WRITE_SINK, errno);
+    bResult = KV_false;
+  }
+
+  return bResult;
+};
+
+/*********************************************************************************************************************************
+ * Compiled images
+ *********************************************************************************************************************************/
+
+/* Unsigned 32-bit integer for fields of compiled images */
+typedef unsigned int KV_uint32;
+
+/* Fails to compile if the integer isn't 32-bit */
+typedef char KV_CheckUint32[(sizeof(KV_uint32) == 4) ? 1 : -1];
+
+/* Identifier at the beginning of compiled images ("VDFI" in the little-endian byte order) */
+#define KV_IMAGE_MAGIC 0x49464456UL
+
+/* Lists with at least this many subpairs get a table of keys */
+#define KV_IMAGE_TABLE_THRESHOLD 16
+
+/* Flag in the node type that marks the last subpair in a list */
+#define KV_IMAGE_LAST 0x100
+
+/* Mask of the data type in the node type */
+#define KV_IMAGE_TYPE 0xFF
+
+typedef struct _KV_ImageHeader {
+  KV_uint32 magic; /* KV_IMAGE_MAGIC */
+  KV_uint32 version; /* KV_IMAGE_VERSION */
+  KV_uint32 size; /* Size of the entire image in bytes, which is a multiple of 4 */
+  KV_uint32 nodes; /* Amount of nodes right after the header, starting with the root node */
+  KV_uint32 tables; /* Offset of key tables from the beginning of the image, which go right after the nodes */
+  KV_uint32 strings; /* Offset of null-terminated strings from the beginning of the image, which go until the end */
+  KV_uint32 checksum[2]; /* Fletcher-64 checksum of everything after the header */
+} KV_ImageHeader;
+
+/* Offsets within nodes are relative to the nodes themselves, so they can be read without knowing their image */
+struct _KV_ImageNode {
+  KV_uint32 key; /* Offset of the key name or 0 for the root pair */
+  KV_uint32 hash; /* FNV-1a hash of the key name */
+  KV_uint32 type; /* Data type with the KV_IMAGE_LAST flag */
+  KV_uint32 count; /* Amount of subpairs in a list or length of a string */
+  KV_uint32 value; /* Offset of the first subpair in a list or a string, or the value itself (lower half of 64 bits) */
+  KV_uint32 extra; /* Offset of the key table of a list (0 if there's none) or upper half of a 64-bit value */
+};
+
+struct _KV_Image {
+  const char *data;
+  size_t size;
+
+  KV_bool loaded; /* The contents have been loaded from a file and need to be released */
+  KV_FileData file;
+};
+
+/* Returns a pointer at some offset from a node */
+#define KV_IMAGE_AT(node, offset) ((const char *)(node) + (offset))
+
+/* FNV-1a hash of a null-terminated key name, which is the same on all platforms */
+KV_INLINE KV_uint32 KV_HashImageKey(const char *str, size_t *length) {
+  const unsigned char *pch = (const unsigned char *)str;
+  KV_uint32 hash = 2166136261UL;
+
+  while (*pch) {
+    hash ^= *pch++;
+    hash *= 16777619UL;
+  }
+
+  *length = (size_t)(pch - (const unsigned char *)str);
+  return hash;
+};
+
+/* Returns the amount of slots in the key table of a list, which is at most half full */
+KV_INLINE KV_uint32 KV_ImageTableSize(KV_uint32 count) {
+  KV_uint32 ct = 1;
+  while (ct < count * 2) ct <<= 1;
+
+  return ct;
+};
+
+/* Calculates a Fletcher-64 checksum of 32-bit words */
+static void KV_ImageChecksum(const char *data, size_t size, KV_uint32 *checksum) {
+  const KV_uint32 *pWord = (const KV_uint32 *)data;
+  size_t ct = size / 4, ctBatch;
+  KV_uint64 iSum1 = 0, iSum2 = 0;
+
+  while (ct) {
+    /* Sums can't overflow within a batch */
+    ctBatch = (ct < 4096) ? ct : 4096;
+    ct -= ctBatch;
+
+    while (ctBatch--) {
+      iSum1 += *pWord++;
+      iSum2 += iSum1;
+    }
+
+    iSum1 %= 0xFFFFFFFFUL;
+    iSum2 %= 0xFFFFFFFFUL;
+  }
+
+  checksum[0] = (KV_uint32)iSum1;
+  checksum[1] = (KV_uint32)iSum2;
+};
+
+/* String in the table of compiled strings */
+typedef struct _KV_ImageString {
+  KV_uint32 hash;
+  KV_uint32 offset; /* Offset within the strings or (KV_uint32)-1 if the slot is empty */
+  size_t length;
+} KV_ImageString;
+
+/* State of an image that's being compiled.
+ * Until the image is put together, keys and strings are offsets within the strings plus one,
+ * subpairs are indices of the first subpair nodes and key tables are their indices plus one.
+ */
+typedef struct _KV_ImageBuilder {
+  KV_Pair **aPairs; /* Pairs of each node */
+  KV_ImageNode *aNodes;
+  size_t ctNodes, ctNodesArray;
+
+  KV_uint32 *aTables; /* Slots of all key tables */
+  size_t ctTables, ctTablesArray;
+
+  /* Each distinct string is only stored once */
+  KV_Printer strings;
+  KV_ImageString *aStrings; /* Open addressing hash table, which is at most half full */
+  size_t ctStrings, ctStringsArray;
+} KV_ImageBuilder;
+
+/* Reallocates the table of compiled strings with twice as many slots */
+static void KV_ImageGrowStrings(KV_ImageBuilder *builder) {
+  KV_ImageString *aOldStrings = builder->aStrings;
+  size_t ctOldArray = builder->ctStringsArray;
+  size_t i, iSlot;
+
+  builder->ctStringsArray = (ctOldArray ? ctOldArray * 2 : 1024);
+  builder->aStrings = (KV_ImageString *)KV_malloc(builder->ctStringsArray * sizeof(KV_ImageString));
+
+  for (i = 0; i < builder->ctStringsArray; ++i) {
+    builder->aStrings[i].offset = (KV_uint32)-1;
+  }
+
+  for (i = 0; i < ctOldArray; ++i) {
+    if (aOldStrings[i].offset == (KV_uint32)-1) continue;
+
+    iSlot = aOldStrings[i].hash & (builder->ctStringsArray - 1);
+
+    while (builder->aStrings[iSlot].offset != (KV_uint32)-1) {
+      iSlot = (iSlot + 1) & (builder->ctStringsArray - 1);
+    }
+
+    builder->aStrings[iSlot] = aOldStrings[i];
+  }
+
+  KV_free(aOldStrings);
+};
+
+/* Adds a null-terminated string to the image, unless it's already there, and returns its offset within the strings */
+static KV_uint32 KV_ImageAddString(KV_ImageBuilder *builder, const char *str, size_t length, KV_uint32 hash) {
+  KV_ImageString *entry;
+  size_t iSlot = hash & (builder->ctStringsArray - 1);
+  KV_uint32 iOffset;
+
+  for (;;) {
+    entry = &builder->aStrings[iSlot];
+    if (entry->offset == (KV_uint32)-1) break;
+
+    if (entry->hash == hash && entry->length == length && !memcmp(builder->strings._buffer + entry->offset, str, length)) {
+      return entry->offset;
+    }
+
+    iSlot = (iSlot + 1) & (builder->ctStringsArray - 1);
+  }
+
+  iOffset = (KV_uint32)(builder->strings._current - builder->strings._buffer);
+
+  entry->hash = hash;
+  entry->offset = iOffset;
+  entry->length = length;
+
+  KV_PrinterAppend(&builder->strings, str, length + 1);
+
+  if (++builder->ctStrings * 2 > builder->ctStringsArray) KV_ImageGrowStrings(builder);
+  return iOffset;
+};
+
+/* Adds a node for a pair without its subpairs */
+static KV_bool KV_ImageAddNode(KV_ImageBuilder *builder, KV_Pair *pair, KV_bool last) {
+  KV_ImageNode *node;
+  size_t ctLength;
+
+  if (builder->ctNodes == builder->ctNodesArray) {
+    builder->ctNodesArray = (builder->ctNodesArray ? builder->ctNodesArray * 2 : 256);
+    builder->aPairs = (KV_Pair **)KV_realloc(builder->aPairs, builder->ctNodesArray * sizeof(KV_Pair *));
+    builder->aNodes = (KV_ImageNode *)KV_realloc(builder->aNodes, builder->ctNodesArray * sizeof(KV_ImageNode));
+  }
+
+  builder->aPairs[builder->ctNodes] = pair;
+  node = &builder->aNodes[builder->ctNodes++];
+
+  node->key = node->hash = 0;
+  node->type = (KV_uint32)pair->_type | (last ? KV_IMAGE_LAST : 0);
+  node->count = node->value = node->extra = 0;
+
+  if (pair->_key) {
+    node->hash = KV_HashImageKey(pair->_key, &ctLength);
+    node->key = KV_ImageAddString(builder, pair->_key, ctLength, node->hash) + 1;
+  }
+
+  switch (pair->_type) {
+    case KV_TYPE_NONE:
+      /* Subpairs are added later */
+      break;
+
+    case KV_TYPE_STRING: {
+      KV_uint32 hash = KV_HashImageKey(pair->_value.str, &ctLength);
+
+      node->count = (KV_uint32)ctLength;
+      node->value = KV_ImageAddString(builder, pair->_value.str, ctLength, hash) + 1;
+    } break;
+
+    case KV_TYPE_INT:
+      node->value = (KV_uint32)pair->_value.i;
+      break;
+
+    case KV_TYPE_FLOAT:
+      memcpy(&node->value, &pair->_value.f, sizeof(KV_uint32));
+      break;
+
+    case KV_TYPE_PTR:
+      node->value = (KV_uint32)((size_t)pair->_value.ptr & 0xFFFFFFFFUL);
+      break;
+
+    case KV_TYPE_COLOR:
+      node->value = (KV_uint32)pair->_value.color.r | ((KV_uint32)pair->_value.color.g << 8)
+        | ((KV_uint32)pair->_value.color.b << 16) | ((KV_uint32)pair->_value.color.a << 24);
+      break;
+
+    case KV_TYPE_UINT64:
+      node->value = (KV_uint32)(pair->_value.u64 & 0xFFFFFFFFUL);
+      node->extra = (KV_uint32)(pair->_value.u64 >> 32);
+      break;
+
+    default:
+      /* Unknown value type */
+      assert(!"Unknown value type");
+
+      KV_SetError(KV_ERROR_UNKNOWN_TYPE, 0);
+      return KV_false;
+  }
+
+  return KV_true;
+};
+
+/* Adds a table of keys for subpairs of a list node, where each slot holds the index of a subpair plus one.
+ * Only the first subpair under each key is added, just like KV_FindPair() only finds the first one.
+ */
+static void KV_ImageAddTable(KV_ImageBuilder *builder, size_t iList) {
+  KV_ImageNode *list = &builder->aNodes[iList];
+  KV_uint32 ctSlots = KV_ImageTableSize(list->count);
+  KV_uint32 *aSlots;
+  KV_uint32 i, iSlot;
+  KV_Pair *pair;
+
+  if (builder->ctTables + ctSlots > builder->ctTablesArray) {
+    builder->ctTablesArray = (builder->ctTables + ctSlots) * 2;
+    builder->aTables = (KV_uint32 *)KV_realloc(builder->aTables, builder->ctTablesArray * sizeof(KV_uint32));
+  }
+
+  aSlots = builder->aTables + builder->ctTables;
+  memset(aSlots, 0, ctSlots * sizeof(KV_uint32));
+
+  list->extra = (KV_uint32)builder->ctTables + 1;
+  builder->ctTables += ctSlots;
+
+  for (i = 0; i < list->count; ++i) {
+    pair = builder->aPairs[list->value + i];
+    if (!pair->_key) continue;
+
+    iSlot = builder->aNodes[list->value + i].hash & (ctSlots - 1);
+
+    while (aSlots[iSlot] && strcmp(builder->aPairs[list->value + aSlots[iSlot] - 1]->_key, pair->_key)) {
+      iSlot = (iSlot + 1) & (ctSlots - 1);
+    }
+
+    if (!aSlots[iSlot]) aSlots[iSlot] = i + 1;
+  }
+};
+
+/* Puts all parts of a compiled image together into one buffer.
+ * Returns NULL if the image doesn't fit into 32-bit offsets.
+ */
+static char *KV_ImageFinish(KV_ImageBuilder *builder, size_t *size) {
+  KV_ImageHeader *header;
+  KV_ImageNode *node;
+  size_t ctStrings = (size_t)(builder->strings._current - builder->strings._buffer);
+  size_t iTables, iStrings, iNode, i;
+  char *data;
+
+  iTables = sizeof(KV_ImageHeader) + builder->ctNodes * sizeof(KV_ImageNode);
+  iStrings = iTables + builder->ctTables * sizeof(KV_uint32);
+  *size = (iStrings + ctStrings + 3) & ~(size_t)3;
+
+  /* Check for overflows on the way as well */
+  if (builder->ctNodes > 0xFFFFFFFFUL / sizeof(KV_ImageNode) || iStrings < iTables || *size < iStrings
+   || *size > 0xFFFFFFFFUL) {
+    KV_SetError(KV_ERROR_IMAGE_SIZE, 0);
+    return NULL;
+  }
+
+  data = (char *)KV_malloc(*size);
+
+  header = (KV_ImageHeader *)data;
+  header->magic = KV_IMAGE_MAGIC;
+  header->version = KV_IMAGE_VERSION;
+  header->size = (KV_uint32)*size;
+  header->nodes = (KV_uint32)builder->ctNodes;
+  header->tables = (KV_uint32)iTables;
+  header->strings = (KV_uint32)iStrings;
+
+  /* Turn all references into offsets from the nodes */
+  node = (KV_ImageNode *)(data + sizeof(KV_ImageHeader));
+  memcpy(node, builder->aNodes, builder->ctNodes * sizeof(KV_ImageNode));
+
+  for (i = 0; i < builder->ctNodes; ++i, ++node) {
+    iNode = sizeof(KV_ImageHeader) + i * sizeof(KV_ImageNode);
+
+    if (node->key) node->key = (KV_uint32)(iStrings + node->key - 1 - iNode);
+
+    switch (node->type & KV_IMAGE_TYPE) {
+      case KV_TYPE_NONE:
+        if (node->count) node->value = (KV_uint32)((node->value - i) * sizeof(KV_ImageNode));
+        if (node->extra) node->extra = (KV_uint32)(iTables + (node->extra - 1) * sizeof(KV_uint32) - iNode);
+        break;
+
+      case KV_TYPE_STRING:
+        node->value = (KV_uint32)(iStrings + node->value - 1 - iNode);
+        break;
+    }
+  }
+
+  /* There are no tables if no list is wide enough */
+  if (builder->ctTables) memcpy(data + iTables, builder->aTables, builder->ctTables * sizeof(KV_uint32));
+  memcpy(data + iStrings, builder->strings._buffer, ctStrings);
+  memset(data + iStrings + ctStrings, 0, *size - iStrings - ctStrings);
+
+  KV_ImageChecksum(data + sizeof(KV_ImageHeader), *size - sizeof(KV_ImageHeader), header->checksum);
+  return data;
+};
+
+/* Compiles a pair into an image that's allocated on the heap.
+ * Nodes are added in breadth-first order, so that subpairs of each list go right after each other.
+ */
+static char *KV_CompileImageInternal(KV_Pair *root, size_t *size) {
+  KV_ImageBuilder builder;
+  KV_Pair *pair, *pairIter;
+  size_t i, iFirst;
+  char *data = NULL;
+
+  builder.aPairs = NULL;
+  builder.aNodes = NULL;
+  builder.ctNodes = builder.ctNodesArray = 0;
+
+  builder.aTables = NULL;
+  builder.ctTables = builder.ctTablesArray = 0;
+
+  KV_PrinterInit(&builder.strings, 4096);
+  builder.aStrings = NULL;
+  builder.ctStrings = builder.ctStringsArray = 0;
+  KV_ImageGrowStrings(&builder);
+
+  if (!KV_ImageAddNode(&builder, root, KV_true)) goto cleanup;
+
+  for (i = 0; i < builder.ctNodes; ++i) {
+    pair = builder.aPairs[i];
+    if (pair->_type != KV_TYPE_NONE) continue;
+
+    if (!KV_EnsureParsed(pair)) goto cleanup;
+    if (!pair->_value.head) continue;
+
+    /* Add all subpairs at the end */
+    iFirst = builder.ctNodes;
+
+    for (pairIter = pair->_value.head; pairIter; pairIter = pairIter->_next) {
+      if (!KV_ImageAddNode(&builder, pairIter, pairIter->_next ? KV_false : KV_true)) goto cleanup;
+    }
+
+    builder.aNodes[i].value = (KV_uint32)iFirst;
+    builder.aNodes[i].count = (KV_uint32)(builder.ctNodes - iFirst);
+    if (builder.aNodes[i].count >= KV_IMAGE_TABLE_THRESHOLD) KV_ImageAddTable(&builder, i);
+  }
+
+  data = KV_ImageFinish(&builder, size);
+
+cleanup:
+  KV_free(builder.aPairs);
+  KV_free(builder.aNodes);
+  KV_free(builder.aTables);
+  KV_PrinterClear(&builder.strings);
+  KV_free(builder.aStrings);
+
+  return data;
+};
+
+KV_bool KV_CompileImage(KV_Pair *pair, const KV_Sink *sink) {
+  size_t ctSize;
+  char *data;
+  KV_bool bResult = KV_true;
+
+  assert(pair && sink && sink->_write);
+
+  data = KV_CompileImageInternal(pair, &ctSize);
+  if (!data) return KV_false;
+
+  /* Custom sinks may not set errno */
+  errno = 0;
+
+  if (!sink->_write(sink->_data, data, ctSize)) {
+    KV_SetError(KV_ERROR_WRITE_SINK, errno);
+    bResult = KV_false;
+  }
+
+  KV_free(data);
+  return bResult;
+};
+
+KV_bool KV_SaveImage(KV_Pair *pair, const char *path) {
+  FILE *file;
+  KV_Sink sink;
+  KV_bool bResult;
+
+  assert(pair && path);
+
+  if (!pair || !path) {
+    KV_SetError(KV_ERROR_NO_ARGUMENT, 0);
+    return KV_false;
+  }
+
+  file = fopen(path, "wb");
+
+  if (!file) {
+    KV_SetError(KV_ERROR_SAVE_FILE, errno);
+    return KV_false;
+  }
+
+  KV_SinkSetupFile(&sink, file);
+  bResult = KV_CompileImage(pair, &sink);
+
+  if (fclose(file) != 0 && bResult) {
+    KV_SetError(KV_ERROR_WRITE_SINK, errno);
+    bResult = KV_false;
+  }
+
+  return bResult;
+};
+
+/* Makes sure that nothing in an image can be read out of its bounds, even if it has been tampered with.
+ * Returns KV_ERROR_NONE if the image is valid.
+ */
+static KV_ErrorCode KV_ValidateImage(const char *data, size_t size) {
+  const KV_ImageHeader *header = (const KV_ImageHeader *)data;
+  const KV_ImageNode *node;
+  KV_uint32 aChecksum[2];
+  size_t iNode, i, ctNodes;
+  KV_uint32 eType;
+
+  if (((size_t)data & 3) || size < sizeof(KV_ImageHeader) || (size & 3)) return KV_ERROR_IMAGE_INVALID;
+
+  /* Also catches images with a different byte order */
+  if (header->magic != KV_IMAGE_MAGIC) return KV_ERROR_IMAGE_INVALID;
+  if (header->version != KV_IMAGE_VERSION) return KV_ERROR_IMAGE_VERSION;
+  if (header->size != size) return KV_ERROR_IMAGE_INVALID;
+
+  KV_ImageChecksum(data + sizeof(KV_ImageHeader), size - sizeof(KV_ImageHeader), aChecksum);
+  if (aChecksum[0] != header->checksum[0] || aChecksum[1] != header->checksum[1]) return KV_ERROR_IMAGE_CHECKSUM;
+
+  /* Parts of the image */
+  ctNodes = header->nodes;
+
+  if (!ctNodes || ctNodes > (size - sizeof(KV_ImageHeader)) / sizeof(KV_ImageNode)) return KV_ERROR_IMAGE_INVALID;
+  if (header->tables != sizeof(KV_ImageHeader) + ctNodes * sizeof(KV_ImageNode)) return KV_ERROR_IMAGE_INVALID;
+  if (header->strings < header->tables || header->strings > size || (header->strings & 3)) return KV_ERROR_IMAGE_INVALID;
+
+  /* Every string ends before the end of the image */
+  if (header->strings < size && data[size - 1] != '\0') return KV_ERROR_IMAGE_INVALID;
+
+  /* Walking through any list never goes past the last node */
+  node = (const KV_ImageNode *)(data + sizeof(KV_ImageHeader));
+  if (!(node[0].type & KV_IMAGE_LAST) || !(node[ctNodes - 1].type & KV_IMAGE_LAST)) return KV_ERROR_IMAGE_INVALID;
+
+  for (i = 0; i < ctNodes; ++i, ++node) {
+    iNode = sizeof(KV_ImageHeader) + i * sizeof(KV_ImageNode);
+    eType = node->type & KV_IMAGE_TYPE;
+
+    if ((node->type & ~(KV_uint32)(KV_IMAGE_TYPE | KV_IMAGE_LAST)) || eType >= KV_TYPE_NUMTYPES || eType == KV_TYPE_WSTRING) {
+      return KV_ERROR_IMAGE_INVALID;
+    }
+
+    if (node->key && (node->key < header->strings - iNode || node->key >= size - iNode)) return KV_ERROR_IMAGE_INVALID;
+
+    switch (eType) {
+      case KV_TYPE_NONE:
+        if (!node->count) break;
+
+        /* Subpairs go after the list and within the nodes */
+        if (!node->value || node->value % sizeof(KV_ImageNode)) return KV_ERROR_IMAGE_INVALID;
+        if (node->value / sizeof(KV_ImageNode) >= ctNodes - i) return KV_ERROR_IMAGE_INVALID;
+        if (node->count > ctNodes - i - node->value / sizeof(KV_ImageNode)) return KV_ERROR_IMAGE_INVALID;
+
+        if (!(node[node->value / sizeof(KV_ImageNode) + node->count - 1].type & KV_IMAGE_LAST)) return KV_ERROR_IMAGE_INVALID;
+
+        /* Key table is within the tables */
+        if (node->extra) {
+          if (node->extra < header->tables - iNode || node->extra >= header->strings - iNode || (node->extra & 3)) {
+            return KV_ERROR_IMAGE_INVALID;
+          }
+
+          if (KV_ImageTableSize(node->count) > (header->strings - iNode - node->extra) / sizeof(KV_uint32)) {
+            return KV_ERROR_IMAGE_INVALID;
+          }
+        }
+        break;
+
+      case KV_TYPE_STRING:
+        if (node->value < header->strings - iNode || node->value >= size - iNode) return KV_ERROR_IMAGE_INVALID;
+        if (node->count >= size - iNode - node->value || data[iNode + node->value + node->count] != '\0') return KV_ERROR_IMAGE_INVALID;
+        break;
+    }
+  }
+
+  return KV_ERROR_NONE;
+};
+
+KV_Image *KV_LoadImage(const char *path) {
+  KV_Image *image;
+  KV_ErrorCode eError;
+  int iError;
+
+  assert(path);
+
+  image = (KV_Image *)KV_malloc(sizeof(KV_Image));
+  iError = KV_LoadFile(&image->file, path);
+
+  if (iError) {
+    KV_SetError(KV_ERROR_LOAD_FILE, iError);
+    KV_free(image);
+    return NULL;
+  }
+
+  eError = KV_ValidateImage(image->file.buffer, image->file.length);
+
+  if (eError != KV_ERROR_NONE) {
+    KV_SetError(eError, 0);
+    KV_ReleaseFile(&image->file);
+    KV_free(image);
+    return NULL;
+  }
+
+  image->data = image->file.buffer;
+  image->size = image->file.length;
+  image->loaded = KV_true;
+
+  return image;
+};
+
+KV_Image *KV_OpenImage(const void *buffer, size_t length) {
+  KV_Image *image;
+  KV_ErrorCode eError;
+
+  assert(buffer);
+
+  eError = KV_ValidateImage((const char *)buffer, length);
+
+  if (eError != KV_ERROR_NONE) {
+    KV_SetError(eError, 0);
+    return NULL;
+  }
+
+  image = (KV_Image *)KV_malloc(sizeof(KV_Image));
+  image->data = (const char *)buffer;
+  image->size = length;
+  image->loaded = KV_false;
+
+  return image;
+};
+
+void KV_ImageDestroy(KV_Image *image) {
+  assert(image);
+
+  if (image->loaded) KV_ReleaseFile(&image->file);
+  KV_free(image);
+};
+
+const KV_ImageNode *KV_ImageGetRoot(const KV_Image *image) {
+  assert(image);
+  return (const KV_ImageNode *)(image->data + sizeof(KV_ImageHeader));
+};
+
+size_t KV_ImageGetNodeCount(const KV_ImageNode *list) {
+  assert(list);
+  if ((list->type & KV_IMAGE_TYPE) != KV_TYPE_NONE) return (size_t)(-1);
+
+  return list->count;
+};
+
+const KV_ImageNode *KV_ImageGetNode(const KV_ImageNode *list, size_t n) {
+  assert(list);
+  if ((list->type & KV_IMAGE_TYPE) != KV_TYPE_NONE || n >= list->count) return NULL;
+
+  return (const KV_ImageNode *)KV_IMAGE_AT(list, list->value) + n;
+};
+
+const KV_ImageNode *KV_ImageFindNode(const KV_ImageNode *list, const char *key) {
+  const KV_ImageNode *node, *nodeSlot;
+  const KV_uint32 *aSlots;
+  KV_uint32 hash, iMask, iSlot, ct;
+  size_t ctLength;
+
+  assert(list && key);
+  if ((list->type & KV_IMAGE_TYPE) != KV_TYPE_NONE || !list->count) return NULL;
+
+  hash = KV_HashImageKey(key, &ctLength);
+  node = (const KV_ImageNode *)KV_IMAGE_AT(list, list->value);
+
+  /* Look up the key in the table */
+  if (list->extra) {
+    aSlots = (const KV_uint32 *)KV_IMAGE_AT(list, list->extra);
+    iMask = KV_ImageTableSize(list->count) - 1;
+    iSlot = hash & iMask;
+
+    /* Go through each slot at most once, even if the table has been tampered with */
+    for (ct = 0; ct <= iMask && aSlots[iSlot]; ++ct) {
+      if (aSlots[iSlot] <= list->count) {
+        nodeSlot = node + aSlots[iSlot] - 1;
+        if (nodeSlot->hash == hash && nodeSlot->key && !strcmp(KV_IMAGE_AT(nodeSlot, nodeSlot->key), key)) return nodeSlot;
+      }
+
+      iSlot = (iSlot + 1) & iMask;
+    }
+
+    return NULL;
+  }
+
+  /* Go through all subpairs */
+  for (ct = 0; ct < list->count; ++ct, ++node) {
+    if (node->hash == hash && node->key && !strcmp(KV_IMAGE_AT(node, node->key), key)) return node;
+  }
+
+  return NULL;
+};
+
+const KV_ImageNode *KV_ImageGetHead(const KV_ImageNode *list) {
+  return KV_ImageGetNode(list, 0);
 };
 
-/* Comments: Ignore all characters in CPP-styled single-line comments or in C-styled block comments */
-/* NOTE: Single '/' characters with no '/' or '*' afterwards count as "empty" comments and are simply ignored */
-KV_INLINE KV_bool KV_ParseComments(KV_Context *ctx)
-{
-  /* Not a comment */
-  if (*ctx->_pch != '/') return KV_false;
+const KV_ImageNode *KV_ImageGetNext(const KV_ImageNode *node) {
+  assert(node);
+  if (node->type & KV_IMAGE_LAST) return NULL;
 
-  ++ctx->_pch;
-  if (KV_ContextBufferEnded(ctx)) return KV_true;
+  return node + 1;
+};
 
-  /* C++ comments */
-  if (*ctx->_pch == '/') {
-    ++ctx->_pch;
+const char *KV_ImageGetKey(const KV_ImageNode *node) {
+  assert(node);
+  if (!node->key) return NULL;
 
-    /* Expect a line break down the road */
-    while (!KV_ContextBufferEnded(ctx) && *ctx->_pch != '\n') {
-      ++ctx->_pch;
-    }
+  return KV_IMAGE_AT(node, node->key);
+};
 
-  /* C comments */
-  } else if (*ctx->_pch == '*') {
-    ++ctx->_pch;
+KV_DataType KV_ImageGetDataType(const KV_ImageNode *node) {
+  assert(node);
+  return (KV_DataType)(node->type & KV_IMAGE_TYPE);
+};
 
-    /* Expect block comment closing down the road */
-    while (!KV_ContextBufferEnded(ctx)) {
-      /* Keep counting line breaks */
-      if (KV_ParseLineBreak(ctx)) continue;
+const char *KV_ImageGetString(const KV_ImageNode *node) {
+  assert(node);
+  assert((node->type & KV_IMAGE_TYPE) == KV_TYPE_STRING);
+  return KV_IMAGE_AT(node, node->value);
+};
 
-      if (*ctx->_pch == '*') {
-        ++ctx->_pch;
+int KV_ImageGetInt(const KV_ImageNode *node) {
+  assert(node);
+  assert((node->type & KV_IMAGE_TYPE) == KV_TYPE_INT);
 
-        /* Close the block comment or pretend that unclosed ones are still comments */
-        if (KV_ContextBufferEnded(ctx) || *ctx->_pch == '/') break;
-      }
+  /* Convert from two's complement without relying on implementation-defined conversions */
+  if (node->value & 0x80000000UL) return -(int)(~node->value & 0x7FFFFFFFUL) - 1;
+  return (int)node->value;
+};
 
-      ++ctx->_pch;
-    }
-  }
+float KV_ImageGetFloat(const KV_ImageNode *node) {
+  float f;
 
-  /* Ignored enough characters */
-  return KV_true;
-};
+  assert(node);
+  assert((node->type & KV_IMAGE_TYPE) == KV_TYPE_FLOAT);
 
-KV_INLINE KV_Pair *KV_IncludeFile(KV_Context *ctx, const char *strFile) {
-  /* Get the list from a file */
-  KV_Context ctxInclude;
-  KV_ContextSetupFile(&ctxInclude, ctx->_directory, strFile);
-  KV_ContextCopyFlags(&ctxInclude, ctx);
+  memcpy(&f, &node->value, sizeof(float));
+  return f;
+};
 
-  return KV_ParseFileInternal(&ctxInclude, ctx);
+void *KV_ImageGetPointer(const KV_ImageNode *node) {
+  assert(node);
+  assert((node->type & KV_IMAGE_TYPE) == KV_TYPE_PTR);
+  return (void *)(size_t)node->value;
 };
 
-KV_INLINE KV_bool KV_AppendIncludedPairs(KV_Context *ctx, KV_Pair *list, KV_Pair *listInclude, size_t iLine) {
-  KV_Pair *pairIter, *pairFind;
+KV_Color KV_ImageGetColor(const KV_ImageNode *node) {
+  KV_Color color;
 
-  /* Append all pairs to the current list */
-  pairIter = listInclude->_value.head;
+  assert(node);
+  assert((node->type & KV_IMAGE_TYPE) == KV_TYPE_COLOR);
 
-  while (pairIter) {
-    /* Catch duplicate keys */
-    if (!ctx->_multikey && (pairFind = KV_FindPair(list, pairIter->_key))) {
-      /* Overwrite values under the same key */
-      if (ctx->_overwrite) {
-        KV_Swap(pairFind, pairIter);
+  color.r = (unsigned char)(node->value & 0xFF);
+  color.g = (unsigned char)((node->value >> 8) & 0xFF);
+  color.b = (unsigned char)((node->value >> 16) & 0xFF);
+  color.a = (unsigned char)((node->value >> 24) & 0xFF);
+  return color;
+};
 
-        /* Get the next subpair */
-        pairIter = pairIter->_next;
-        continue;
-      }
+KV_uint64 KV_ImageGetUint64(const KV_ImageNode *node) {
+  assert(node);
+  assert((node->type & KV_IMAGE_TYPE) == KV_TYPE_UINT64);
+  return (KV_uint64)node->value | ((KV_uint64)node->extra << 32);
+};
 
-      /* Or throw an error */
-      KV_SetContextError(ctx, iLine, "Included key already exists");
-      return KV_false;
-    }
+/*********************************************************************************************************************************
+ * Flat trees
+ *********************************************************************************************************************************/
 
-    /* Remember the current subpair and get the next one */
-    pairFind = pairIter;
-    pairIter = pairIter->_next;
+/* Value of a node in a flat tree */
+typedef union _KV_FlatValue {
+  size_t str; /* Offset of a string in the string pool */
+  size_t count; /* Amount of subpairs in a list */
+  int i;
+  float f;
+  void *ptr;
+  KV_Color color;
+  KV_uint64 u64;
+} KV_FlatValue;
+
+/* Distinct key in the string pool of a flat tree */
+typedef struct _KV_FlatKey {
+  size_t offset; /* Offset of the key in the string pool or -1 for empty slots */
+  size_t hash;
+} KV_FlatKey;
+
+/* First subpair under some key in a wide list of a flat tree */
+typedef struct _KV_FlatWideKey {
+  size_t list;
+  size_t key; /* Offset of the key in the string pool */
+  size_t node; /* First subpair or 0 for empty slots */
+} KV_FlatWideKey;
+
+struct _KV_Flat {
+  /* Properties of all nodes in the order they would be printed in */
+  size_t *aKeys; /* Offsets of keys in the string pool or -1 for a root pair without a key */
+  unsigned char *aTypes;
+  KV_FlatValue *aValues;
+  size_t *aNext; /* Indices of next neighbors or 0 for the last subpairs */
+  size_t *aSizes; /* Amounts of nodes in each subtree */
+  size_t ctNodes;
+  size_t ctNodesArray;
+
+  /* Null-terminated keys and string values */
+  char *strPool;
+  size_t ctPool;
+  size_t ctPoolArray;
+
+  /* Open addressing hash table of distinct keys, which is at most half full */
+  KV_FlatKey *aKeyTable;
+  size_t ctKeyTable;
+  size_t ctKeys;
+
+  /* Open addressing hash table of first subpairs under each key in wide lists, which is at most half full */
+  KV_FlatWideKey *aWideTable;
+  size_t ctWideTable;
+  size_t ctWide; /* Lists with more subpairs than this are in the table */
+};
 
-    /* Move that subpair over to the current list instead of copying it */
-    KV_AddTail(list, pairFind);
+/* State of a flat tree that's being constructed node by node.
+ * While a list is open, its next neighbor holds its last subpair and its subtree size holds the outer open list.
+ */
+typedef struct _KV_FlatBuilder {
+  KV_Flat *flat;
+  KV_Context *ctx; /* Parser context or NULL if copying pairs */
+  size_t iNode; /* Last added node */
+  size_t iList; /* Innermost open list */
+  size_t ctOpen; /* Amount of open lists */
+} KV_FlatBuilder;
+
+/* Sets up an empty key table with a specific amount of slots */
+KV_INLINE void KV_FlatInitKeys(KV_Flat *flat, size_t ct) {
+  size_t iSlot;
+
+  flat->ctKeyTable = ct;
+  flat->aKeyTable = (KV_FlatKey *)KV_malloc(ct * sizeof(KV_FlatKey));
+
+  for (iSlot = 0; iSlot < ct; ++iSlot) {
+    flat->aKeyTable[iSlot].offset = (size_t)-1;
   }
-
-  return KV_true;
 };
 
-KV_INLINE KV_bool KV_MergeBasePairs(KV_Pair *list, KV_Pair *listInclude) {
-  /* Moving nodes over from the temporary list to the current list */
-  KV_MergeNodes(list, listInclude, KV_true);
-  return KV_true;
-};
+static void KV_InitFlatBuilder(KV_FlatBuilder *builder, KV_Context *ctx) {
+  KV_Flat *flat = (KV_Flat *)KV_malloc(sizeof(KV_Flat));
 
-KV_INLINE KV_bool KV_ParseInnerList(KV_Context *ctx, KV_Pair *list, const char *strKey) {
-  KV_Pair *pairFind;
-  KV_Pair *listTemp = KV_ParseBufferInternal(ctx, KV_true);
+  flat->ctNodes = 0;
+  flat->ctNodesArray = 64;
+  flat->aKeys = (size_t *)KV_malloc(flat->ctNodesArray * sizeof(size_t));
+  flat->aTypes = (unsigned char *)KV_malloc(flat->ctNodesArray);
+  flat->aValues = (KV_FlatValue *)KV_malloc(flat->ctNodesArray * sizeof(KV_FlatValue));
+  flat->aNext = (size_t *)KV_malloc(flat->ctNodesArray * sizeof(size_t));
+  flat->aSizes = (size_t *)KV_malloc(flat->ctNodesArray * sizeof(size_t));
 
-  /* Couldn't parse an inner list */
-  if (!listTemp) return KV_false;
+  flat->ctPool = 0;
+  flat->ctPoolArray = 256;
+  flat->strPool = (char *)KV_malloc(flat->ctPoolArray);
 
-  /* Catch duplicate keys */
-  if (!ctx->_multikey && (pairFind = KV_FindPair(list, strKey))) {
-    /* Overwrite values under the same key */
-    if (ctx->_overwrite) {
-      /* Swap the found pair with this temporary list */
-      KV_SetKey(listTemp, strKey);
-      KV_Swap(pairFind, listTemp);
+  flat->ctKeys = 0;
+  KV_FlatInitKeys(flat, 64);
 
-      /* Temporary list now contains the found pair data, which isn't needed anymore */
-      KV_PairDestroy(listTemp);
-      return KV_true;
-    }
+  flat->aWideTable = NULL;
+  flat->ctWideTable = 0;
+  flat->ctWide = KV_GetBulkThreshold();
 
-    /* Or throw an error */
-    KV_SetContextError(ctx, ctx->_line, "Key already exists");
+  builder->flat = flat;
+  builder->ctx = ctx;
+  builder->iNode = builder->iList = builder->ctOpen = 0;
+};
 
-    KV_PairDestroy(listTemp);
-    return KV_false;
+void KV_FlatDestroy(KV_Flat *flat) {
+  assert(flat);
+
+  KV_free(flat->aKeys);
+  KV_free(flat->aTypes);
+  KV_free(flat->aValues);
+  KV_free(flat->aNext);
+  KV_free(flat->aSizes);
+  KV_free(flat->strPool);
+  KV_free(flat->aKeyTable);
+  KV_free(flat->aWideTable);
+  KV_free(flat);
+};
+
+/* Appends a specific amount of characters with a null terminator to the string pool and returns their offset */
+static size_t KV_FlatAddString(KV_Flat *flat, const char *str, size_t length) {
+  size_t offset = flat->ctPool;
+
+  if (offset + length + 1 > flat->ctPoolArray) {
+    while (offset + length + 1 > flat->ctPoolArray) flat->ctPoolArray *= 2;
+    flat->strPool = (char *)KV_realloc(flat->strPool, flat->ctPoolArray);
   }
 
-  /* Append a new (or a duplicate) list */
-  KV_SetKey(listTemp, strKey);
-  KV_AddTail(list, listTemp);
+  memcpy(flat->strPool + offset, str, length);
+  flat->strPool[offset + length] = '\0';
+  flat->ctPool += length + 1;
 
-  return KV_true;
+  return offset;
 };
 
-KV_INLINE KV_bool KV_AddStringPair(KV_Context *ctx, KV_Pair *list, const char *strKey, const char *strValue) {
-  KV_Pair *pairFind;
+/* Finds a slot in the key table that either holds a key or should hold it */
+KV_INLINE KV_FlatKey *KV_FlatKeySlot(const KV_Flat *flat, const char *key, size_t length, size_t hash) {
+  size_t iSlot = hash & (flat->ctKeyTable - 1);
+  KV_FlatKey *entry;
 
-  /* Catch duplicate keys */
-  if (!ctx->_multikey && (pairFind = KV_FindPair(list, strKey))) {
-    /* Overwrite values under the same key */
-    if (ctx->_overwrite) {
-      KV_SetString(pairFind, strValue);
-      return KV_true;
-    }
+  for (;;) {
+    entry = &flat->aKeyTable[iSlot];
 
-    /* Or throw an error */
-    KV_SetContextError(ctx, ctx->_line, "Key already exists");
-    return KV_false;
-  }
+    if (entry->offset == (size_t)-1) return entry;
 
-  /* Append a new (or a duplicate) pair */
-  KV_AddTail(list, KV_NewString(strKey, strValue));
-  return KV_true;
+    if (entry->hash == hash && !strncmp(flat->strPool + entry->offset, key, length)
+     && flat->strPool[entry->offset + length] == '\0') return entry;
+
+    iSlot = (iSlot + 1) & (flat->ctKeyTable - 1);
+  }
 };
 
-/* Expanding array of lists to include in the current list */
-typedef struct _KV_Includes {
-  KV_Pair **aLists;
-  size_t *aLines;
+/* Returns the offset of a key in the string pool, adding it there if it's not in the key table yet */
+static size_t KV_FlatAddKey(KV_Flat *flat, const char *key, size_t length) {
+  size_t hash = KV_HashString(key, length);
+  KV_FlatKey *entry = KV_FlatKeySlot(flat, key, length, hash);
+  KV_FlatKey *aOldKeys;
+  size_t ctOldTable, iSlot;
 
-  size_t ctArray;
-  size_t ctUsed;
-} KV_Includes;
+  if (entry->offset != (size_t)-1) return entry->offset;
 
-KV_INLINE void KV_InitIncludes(KV_Includes *incl) {
-  incl->aLists = NULL;
-  incl->aLines = NULL;
-  incl->ctArray = incl->ctUsed = 0;
-};
+  /* Double the table before it gets more than half full */
+  if ((flat->ctKeys + 1) * 2 > flat->ctKeyTable) {
+    aOldKeys = flat->aKeyTable;
+    ctOldTable = flat->ctKeyTable;
+    KV_FlatInitKeys(flat, ctOldTable * 2);
 
-KV_INLINE void KV_DestroyIncludes(KV_Includes *incl) {
-  size_t i;
+    /* Keys are already unique */
+    for (iSlot = 0; iSlot < ctOldTable; ++iSlot) {
+      if (aOldKeys[iSlot].offset == (size_t)-1) continue;
 
-  if (!incl->aLists) return;
+      entry = &flat->aKeyTable[aOldKeys[iSlot].hash & (flat->ctKeyTable - 1)];
+      while (entry->offset != (size_t)-1) entry = (entry == &flat->aKeyTable[flat->ctKeyTable - 1]) ? flat->aKeyTable : entry + 1;
 
-  /* Destroy all lists */
-  for (i = 0; i < incl->ctUsed; ++i) {
-    KV_PairDestroy(incl->aLists[i]);
+      *entry = aOldKeys[iSlot];
+    }
+
+    KV_free(aOldKeys);
+    entry = KV_FlatKeySlot(flat, key, length, hash);
   }
 
-  /* Free the arrays */
-  KV_free(incl->aLists);
-  KV_free(incl->aLines);
+  entry->offset = KV_FlatAddString(flat, key, length);
+  entry->hash = hash;
+  ++flat->ctKeys;
+
+  return entry->offset;
 };
 
-KV_INLINE void KV_AddInclude(KV_Includes *incl, KV_Pair *list, size_t iLine) {
-  assert(incl->ctUsed <= incl->ctArray);
+/* Appends a node under some key to the innermost open list. Its value needs to be set afterwards. */
+static void KV_FlatBuilderNode(KV_FlatBuilder *builder, const char *key, size_t length) {
+  KV_Flat *flat = builder->flat;
+  size_t iNode = flat->ctNodes;
+
+  if (iNode == flat->ctNodesArray) {
+    flat->ctNodesArray *= 2;
+    flat->aKeys = (size_t *)KV_realloc(flat->aKeys, flat->ctNodesArray * sizeof(size_t));
+    flat->aTypes = (unsigned char *)KV_realloc(flat->aTypes, flat->ctNodesArray);
+    flat->aValues = (KV_FlatValue *)KV_realloc(flat->aValues, flat->ctNodesArray * sizeof(KV_FlatValue));
+    flat->aNext = (size_t *)KV_realloc(flat->aNext, flat->ctNodesArray * sizeof(size_t));
+    flat->aSizes = (size_t *)KV_realloc(flat->aSizes, flat->ctNodesArray * sizeof(size_t));
+  }
 
-  /* If all array slots have been used up */
-  if (incl->ctUsed == incl->ctArray) {
-    incl->ctArray += 32;
+  flat->aKeys[iNode] = key ? KV_FlatAddKey(flat, key, length) : (size_t)-1;
+  flat->aTypes[iNode] = KV_TYPE_STRING;
+  flat->aValues[iNode].u64 = 0;
+  flat->aNext[iNode] = 0;
+  flat->aSizes[iNode] = 1;
+  ++flat->ctNodes;
 
-    /* Expand the arrays */
-    if (incl->aLists) {
-      incl->aLists = (KV_Pair **)KV_realloc(incl->aLists, incl->ctArray * sizeof(KV_Pair *));
-      incl->aLines = (size_t   *)KV_realloc(incl->aLines, incl->ctArray * sizeof(size_t));
+  /* Link it after the last subpair of the innermost list */
+  if (builder->ctOpen) {
+    if (flat->aNext[builder->iList]) flat->aNext[flat->aNext[builder->iList]] = iNode;
 
-    /* Allocate new arrays */
-    } else {
-      incl->aLists = (KV_Pair **)KV_malloc(incl->ctArray * sizeof(KV_Pair *));
-      incl->aLines = (size_t   *)KV_malloc(incl->ctArray * sizeof(size_t));
-    }
+    flat->aNext[builder->iList] = iNode;
+    ++flat->aValues[builder->iList].count;
   }
 
-  /* Add a new list at the end at the current line */
-  incl->aLists[incl->ctUsed] = list;
-  incl->aLines[incl->ctUsed] = iLine;
-
-  ++incl->ctUsed;
+  builder->iNode = iNode;
 };
 
-KV_Pair *KV_ParseBufferInternal(KV_Context *ctx, KV_bool inner) {
-  KV_Pair *list;
-  const char *pchCheck;
+/* Turns the last added node into a list that subsequent nodes are added to */
+KV_INLINE void KV_FlatBuilderBeginList(KV_FlatBuilder *builder) {
+  KV_Flat *flat = builder->flat;
 
-  char *strTemp;
-  char *strKey;
+  flat->aTypes[builder->iNode] = KV_TYPE_NONE;
+  flat->aValues[builder->iNode].count = 0;
+  flat->aSizes[builder->iNode] = builder->iList;
 
-  KV_Includes inclIncludeFiles, inclBaseFiles;
-  KV_Pair *listInclude;
-  size_t iInclude;
+  builder->iList = builder->iNode;
+  ++builder->ctOpen;
+};
 
-  list = KV_NewList(NULL);
-  strKey = NULL; /* Set to a valid string if expecting a value for a complete pair */
+/* Closes the innermost open list */
+KV_INLINE void KV_FlatBuilderEndList(KV_FlatBuilder *builder) {
+  KV_Flat *flat = builder->flat;
+  size_t iList = builder->iList;
 
-  KV_InitIncludes(&inclIncludeFiles);
-  KV_InitIncludes(&inclBaseFiles);
+  builder->iList = flat->aSizes[iList];
+  --builder->ctOpen;
 
-  while (!KV_ContextBufferEnded(ctx)) {
-    /* Parse line breaks and comments */
-    if (KV_ParseLineBreak(ctx)) continue;
-    if (KV_ParseComments(ctx)) continue;
+  flat->aSizes[iList] = flat->ctNodes - iList;
+  flat->aNext[iList] = 0;
+};
 
-    /* Skip whitespaces */
-    if (isspace(*ctx->_pch)) {
-      ++ctx->_pch;
-      continue;
-    }
+/* Finds a slot in the table of wide lists that either holds a key of a list or should hold it */
+KV_INLINE KV_FlatWideKey *KV_FlatWideSlot(const KV_Flat *flat, size_t list, size_t key) {
+  size_t hash = (key ^ (list * (size_t)2654435761UL)) * (size_t)2654435761UL;
+  size_t iSlot = (hash ^ (hash >> 15)) & (flat->ctWideTable - 1);
+  KV_FlatWideKey *entry;
 
-    pchCheck = ctx->_pch++;
+  for (;;) {
+    entry = &flat->aWideTable[iSlot];
 
-    /* Lists: Parse another list between curly braces */
-    if (strKey && *pchCheck == '{') {
-      /* Parsed an inner list under some key */
-      if (KV_ParseInnerList(ctx, list, strKey)) {
-        KV_free(strKey);
-        strKey = NULL;
-        continue;
-      }
+    if (!entry->node || (entry->list == list && entry->key == key)) return entry;
 
-      /* Or errored out */
-      KV_free(strKey);
+    iSlot = (iSlot + 1) & (flat->ctWideTable - 1);
+  }
+};
 
-      KV_DestroyIncludes(&inclIncludeFiles);
-      KV_DestroyIncludes(&inclBaseFiles);
-      KV_PairDestroy(list);
-      return NULL;
-    }
+/* Puts first subpairs under each key of all wide lists into a table after the flat tree is constructed */
+static void KV_FlatIndexWideLists(KV_Flat *flat) {
+  KV_FlatWideKey *entry;
+  size_t iList, iNode, ct = 0;
 
-    /* List end, if not expecting a value */
-    if (inner && !strKey && *pchCheck == '}') break;
+  for (iList = 0; iList < flat->ctNodes; ++iList) {
+    if (flat->aTypes[iList] == KV_TYPE_NONE && flat->aValues[iList].count > flat->ctWide) ct += flat->aValues[iList].count;
+  }
 
-    /* Strings: Parse all characters until another double quote */
-    if (*pchCheck == '"') {
-      strTemp = KV_ParseString(ctx, KV_true);
+  if (!ct) return;
 
-    /* Strings: Parse all characters until another token or whitespace */
-    } else {
-      --ctx->_pch;
-      strTemp = KV_ParseString(ctx, KV_false);
-    }
+  for (flat->ctWideTable = 64; flat->ctWideTable < ct * 2; flat->ctWideTable *= 2);
+  flat->aWideTable = (KV_FlatWideKey *)KV_calloc(flat->ctWideTable, sizeof(KV_FlatWideKey));
 
-    /* Couldn't parse a string token */
-    if (!strTemp) {
-      /* Free remembered key string */
-      if (strKey) KV_free(strKey);
+  for (iList = 0; iList < flat->ctNodes; ++iList) {
+    if (flat->aTypes[iList] != KV_TYPE_NONE || flat->aValues[iList].count <= flat->ctWide) continue;
 
-      KV_DestroyIncludes(&inclIncludeFiles);
-      KV_DestroyIncludes(&inclBaseFiles);
-      KV_PairDestroy(list);
-      return NULL;
-    }
+    for (iNode = iList + 1; iNode; iNode = flat->aNext[iNode]) {
+      entry = KV_FlatWideSlot(flat, iList, flat->aKeys[iNode]);
+      if (entry->node) continue;
 
-    /* Remember this key string for future use */
-    if (!strKey) {
-      strKey = strTemp;
-      continue;
+      entry->list = iList;
+      entry->key = flat->aKeys[iNode];
+      entry->node = iNode;
     }
+  }
+};
 
-    /* Include macros */
-    if (!strncasecmp(strKey, "#include", 8)) {
-      /* Added pairs from the included list */
-      listInclude = KV_IncludeFile(ctx, strTemp);
+KV_Flat *KV_FlattenPair(KV_Pair *root) {
+  KV_FlatBuilder builder;
+  KV_Flat *flat;
+  KV_Pair *pair = root;
+  size_t iNode;
 
-      /* Free strings after macro execution */
-      KV_free(strKey);
-      KV_free(strTemp);
-      strKey = NULL;
+  assert(root);
 
-      if (listInclude) {
-        KV_AddInclude(&inclIncludeFiles, listInclude, ctx->_line);
-        continue;
-      }
+  KV_InitFlatBuilder(&builder, NULL);
+  flat = builder.flat;
 
-      /* Or errored out */
-      KV_DestroyIncludes(&inclIncludeFiles);
-      KV_DestroyIncludes(&inclBaseFiles);
-      KV_PairDestroy(list);
-      return NULL;
+  /* Walk subpairs in order by following links to neighboring and parent pairs */
+  for (;;) {
+    KV_FlatBuilderNode(&builder, pair->_key, pair->_key ? strlen(pair->_key) : 0);
+    iNode = builder.iNode;
+    flat->aTypes[iNode] = (unsigned char)pair->_type;
+
+    switch (pair->_type) {
+      case KV_TYPE_NONE: {
+        /* Lists that couldn't be parsed cannot be copied either */
+        if (!KV_EnsureParsed(pair)) {
+          KV_FlatDestroy(flat);
+          return NULL;
+        }
 
-    } else if (!strncasecmp(strKey, "#base", 5)) {
-      /* Added pairs from the included list */
-      listInclude = KV_IncludeFile(ctx, strTemp);
+        KV_FlatBuilderBeginList(&builder);
 
-      /* Free strings after macro execution */
-      KV_free(strKey);
-      KV_free(strTemp);
-      strKey = NULL;
+        if (pair->_value.head) {
+          pair = pair->_value.head;
+          continue;
+        }
 
-      if (listInclude) {
-        KV_AddInclude(&inclBaseFiles, listInclude, ctx->_line);
-        continue;
-      }
+        KV_FlatBuilderEndList(&builder);
+      } break;
 
-      /* Or errored out */
-      KV_DestroyIncludes(&inclIncludeFiles);
-      KV_DestroyIncludes(&inclBaseFiles);
-      KV_PairDestroy(list);
-      return NULL;
-    }
+      case KV_TYPE_STRING: flat->aValues[iNode].str = KV_FlatAddString(flat, pair->_value.str, strlen(pair->_value.str)); break;
+      case KV_TYPE_INT: flat->aValues[iNode].i = pair->_value.i; break;
+      case KV_TYPE_FLOAT: flat->aValues[iNode].f = pair->_value.f; break;
+      case KV_TYPE_PTR: flat->aValues[iNode].ptr = pair->_value.ptr; break;
+      case KV_TYPE_COLOR: flat->aValues[iNode].color = pair->_value.color; break;
+      case KV_TYPE_UINT64: flat->aValues[iNode].u64 = pair->_value.u64; break;
 
-    /* Added a string value under some key */
-    if (KV_AddStringPair(ctx, list, strKey, strTemp)) {
-      KV_free(strKey);
-      KV_free(strTemp);
-      strKey = NULL;
-      continue;
+      default: {
+        /* Unknown value type */
+        assert(!"Unknown value type");
+
+        KV_FlatDestroy(flat);
+        KV_SetError(KV_ERROR_UNKNOWN_TYPE, 0);
+        return NULL;
+      }
     }
 
-    /* Or errored out */
-    KV_free(strKey);
-    KV_free(strTemp);
+    /* Close finished lists up the hierarchy until there's a next pair to copy */
+    for (;;) {
+      if (pair == root) {
+        KV_FlatIndexWideLists(flat);
+        return flat;
+      }
 
-    KV_DestroyIncludes(&inclIncludeFiles);
-    KV_DestroyIncludes(&inclBaseFiles);
-    KV_PairDestroy(list);
-    return NULL;
-  }
+      if (pair->_next) {
+        pair = pair->_next;
+        break;
+      }
 
-  /* Append included pairs */
-  for (iInclude = 0; iInclude < inclIncludeFiles.ctUsed; ++iInclude)
-  {
-    if (!KV_AppendIncludedPairs(ctx, list, inclIncludeFiles.aLists[iInclude], inclIncludeFiles.aLines[iInclude]))
-    {
-      /* We were so close */
-      KV_DestroyIncludes(&inclIncludeFiles);
-      KV_DestroyIncludes(&inclBaseFiles);
-      KV_PairDestroy(list);
-      return NULL;
+      pair = pair->_parent;
+      KV_FlatBuilderEndList(&builder);
     }
   }
+};
 
-  /* Merge base pairs */
-  for (iInclude = 0; iInclude < inclBaseFiles.ctUsed; ++iInclude)
-  {
-    if (!KV_MergeBasePairs(list, inclBaseFiles.aLists[iInclude]))
-    {
-      /* We were so close */
-      KV_DestroyIncludes(&inclIncludeFiles);
-      KV_DestroyIncludes(&inclBaseFiles);
-      KV_PairDestroy(list);
-      return NULL;
+/* Event callbacks for parsing contents directly into a flat tree */
+static KV_bool KV_FlatEventKey(void *data, const char *key, size_t length) {
+  KV_FlatBuilderNode((KV_FlatBuilder *)data, key, length);
+  return KV_true;
+};
+
+static KV_bool KV_FlatEventString(void *data, const char *value, size_t length) {
+  KV_FlatBuilder *builder = (KV_FlatBuilder *)data;
+  KV_Flat *flat = builder->flat;
+  size_t iNode = builder->iNode;
+  size_t offset;
+  KV_Number num;
+  KV_DataType eType;
+
+  offset = KV_FlatAddString(flat, value, length);
+
+  /* Discard the string if it's a number */
+  if (builder->ctx->_types && (eType = KV_ParseNumber(flat->strPool + offset, &num)) != KV_TYPE_NONE) {
+    flat->ctPool = offset;
+    flat->aTypes[iNode] = (unsigned char)eType;
+
+    switch (eType) {
+      case KV_TYPE_INT: flat->aValues[iNode].i = num.i; break;
+      case KV_TYPE_FLOAT: flat->aValues[iNode].f = num.f; break;
+      default: flat->aValues[iNode].u64 = num.u64; break;
     }
+
+    return KV_true;
   }
 
-  /* Done parsing the buffer */
-  KV_DestroyIncludes(&inclIncludeFiles);
-  KV_DestroyIncludes(&inclBaseFiles);
-  return list;
+  flat->aValues[iNode].str = offset;
+  return KV_true;
 };
 
-KV_Pair *KV_Parse(KV_Context *ctx) {
+static KV_bool KV_FlatEventBeginList(void *data) {
+  KV_FlatBuilderBeginList((KV_FlatBuilder *)data);
+  return KV_true;
+};
+
+static KV_bool KV_FlatEventEndList(void *data) {
+  KV_FlatBuilderEndList((KV_FlatBuilder *)data);
+  return KV_true;
+};
+
+KV_Flat *KV_ParseFlat(KV_Context *ctx) {
+  KV_FlatBuilder builder;
+  KV_Events events;
+
   assert(ctx);
 
-  if (ctx->_file) {
-    return KV_ParseFileInternal(ctx, NULL);
+  events._key = KV_FlatEventKey;
+  events._string = KV_FlatEventString;
+  events._beginlist = KV_FlatEventBeginList;
+  events._endlist = KV_FlatEventEndList;
+  events._include = NULL;
+
+  /* Global list */
+  KV_InitFlatBuilder(&builder, ctx);
+  KV_FlatBuilderNode(&builder, NULL, 0);
+  KV_FlatBuilderBeginList(&builder);
+
+  if (!KV_ParseEvents(ctx, &events, &builder)) {
+    KV_FlatDestroy(builder.flat);
+    return NULL;
   }
 
-  return KV_ParseBufferInternal(ctx, KV_false);
+  /* Close the global list */
+  while (builder.ctOpen) KV_FlatBuilderEndList(&builder);
+
+  KV_FlatIndexWideLists(builder.flat);
+  return builder.flat;
 };
 
-KV_Pair *KV_ParseBuffer(const char *buffer, size_t length) {
-  KV_Context ctx;
+size_t KV_FlatGetSize(const KV_Flat *flat) {
+  assert(flat);
+  return flat->ctNodes;
+};
 
-  assert(buffer);
-  KV_ContextSetupBuffer(&ctx, "", buffer, length);
+size_t KV_FlatGetSubtreeSize(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  return flat->aSizes[node];
+};
 
-  return KV_ParseBufferInternal(&ctx, KV_false);
+size_t KV_FlatGetNodeCount(const KV_Flat *flat, size_t list) {
+  assert(flat && list < flat->ctNodes);
+  if (flat->aTypes[list] != KV_TYPE_NONE) return (size_t)-1;
+
+  return flat->aValues[list].count;
 };
 
-KV_Pair *KV_ParseFile(const char *path) {
-  KV_Context ctx;
+size_t KV_FlatGetHead(const KV_Flat *flat, size_t list) {
+  assert(flat && list < flat->ctNodes);
+  if (flat->aTypes[list] != KV_TYPE_NONE || !flat->aValues[list].count) return 0;
 
-  assert(path);
-  KV_ContextSetupFile(&ctx, "", path);
+  return list + 1;
+};
 
-  return KV_ParseFileInternal(&ctx, NULL);
+size_t KV_FlatGetNext(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  return flat->aNext[node];
 };
 
-KV_bool KV_Save(KV_Pair *pair, const char *path) {
-  FILE *file;
-  char *str;
+size_t KV_FlatFindNode(const KV_Flat *flat, size_t list, const char *key) {
+  const KV_FlatKey *entry;
+  size_t length, iNode;
 
-  assert(pair && path);
+  assert(flat && list < flat->ctNodes && key);
+  if (flat->aTypes[list] != KV_TYPE_NONE || !flat->aValues[list].count) return 0;
 
-  if (!pair || !path) {
-    KV_SetError("No pair or path specified");
-    return KV_false;
-  }
+  length = strlen(key);
+  entry = KV_FlatKeySlot(flat, key, length, KV_HashString(key, length));
 
-  file = fopen(path, "w");
+  /* No subpairs under this key anywhere in the tree */
+  if (entry->offset == (size_t)-1) return 0;
 
-  if (!file) {
-    str = (char *)KV_malloc(strlen(strerror(errno)) + 31);
-    strcpy(str, "Cannot open file for writing: ");
-    strcat(str, strerror(errno));
+  if (flat->aValues[list].count > flat->ctWide) return KV_FlatWideSlot(flat, list, entry->offset)->node;
 
-    KV_SetError(str);
-    KV_free(str);
-    return KV_false;
+  for (iNode = list + 1; iNode; iNode = flat->aNext[iNode]) {
+    if (flat->aKeys[iNode] == entry->offset) return iNode;
   }
 
-  str = KV_Print(pair, NULL, 1048576, "\t"); /* 1MB step */
+  return 0;
+};
 
-  if (!str) {
-    fclose(file);
-    return KV_false;
-  }
+const char *KV_FlatGetKey(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  if (flat->aKeys[node] == (size_t)-1) return NULL;
 
-  fputs(str, file);
-  KV_free(str);
+  return flat->strPool + flat->aKeys[node];
+};
 
-  fclose(file);
-  return KV_true;
+KV_DataType KV_FlatGetDataType(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  return (KV_DataType)flat->aTypes[node];
+};
+
+const char *KV_FlatGetString(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  assert(flat->aTypes[node] == KV_TYPE_STRING);
+  return flat->strPool + flat->aValues[node].str;
+};
+
+int KV_FlatGetInt(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  assert(flat->aTypes[node] == KV_TYPE_INT);
+  return flat->aValues[node].i;
+};
+
+float KV_FlatGetFloat(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  assert(flat->aTypes[node] == KV_TYPE_FLOAT);
+  return flat->aValues[node].f;
+};
+
+void *KV_FlatGetPointer(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  assert(flat->aTypes[node] == KV_TYPE_PTR);
+  return flat->aValues[node].ptr;
+};
+
+KV_Color KV_FlatGetColor(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  assert(flat->aTypes[node] == KV_TYPE_COLOR);
+  return flat->aValues[node].color;
+};
+
+KV_uint64 KV_FlatGetUint64(const KV_Flat *flat, size_t node) {
+  assert(flat && node < flat->ctNodes);
+  assert(flat->aTypes[node] == KV_TYPE_UINT64);
+  return flat->aValues[node].u64;
 };
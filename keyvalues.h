@@ -51,6 +51,7 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #endif
 
 #include <stddef.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -95,17 +96,32 @@ typedef enum _KV_bool {
 } KV_bool;
 
 
+/* Unsigned 64-bit integer for KV_TYPE_UINT64 values */
+#if defined(_MSC_VER)
+  typedef unsigned __int64 KV_uint64;
+#elif defined(__GNUC__)
+  __extension__ typedef unsigned long long KV_uint64;
+#else
+  typedef unsigned long long KV_uint64;
+#endif
+
+
+/* Color for KV_TYPE_COLOR values */
+typedef struct _KV_Color {
+  unsigned char r, g, b, a;
+} KV_Color;
+
+
 /* Supported data types, synced with KeyValues::types_t from Source SDK 2013 */
 typedef enum _KV_DataType {
   KV_TYPE_NONE = 0, /* Acts as a list of subpairs; empty by default */
   KV_TYPE_STRING,
-  /* TODO: Support the rest of the types */
-  KV_TYPE_INT,
-  KV_TYPE_FLOAT,
-  KV_TYPE_PTR,
-  KV_TYPE_WSTRING,
-  KV_TYPE_COLOR,
-  KV_TYPE_UINT64,
+  KV_TYPE_INT, /* Signed 32-bit integer */
+  KV_TYPE_FLOAT, /* 32-bit floating point number */
+  KV_TYPE_PTR, /* Pointer; only its lower 32 bits are kept in binary contents and compiled images */
+  KV_TYPE_WSTRING, /* Wide string; unsupported */
+  KV_TYPE_COLOR, /* RGBA color */
+  KV_TYPE_UINT64, /* Unsigned 64-bit integer */
 
   KV_TYPE_NUMTYPES,
 } KV_DataType;
@@ -113,7 +129,15 @@ typedef enum _KV_DataType {
 
 typedef struct _KV_Printer KV_Printer; /* Context for printing strings in infinite character buffers */
 typedef struct _KV_Context KV_Context; /* Parser context for reading VDF contents */
+typedef struct _KV_Document KV_Document; /* Memory owner that allocates pairs and strings in large blocks */
+typedef struct _KV_Pool KV_Pool; /* Allocator that reuses memory of destroyed pairs and short strings */
 typedef struct _KV_Pair KV_Pair; /* Value of a specific type under a key */
+typedef struct _KV_Events KV_Events; /* Callbacks for parsing VDF contents without constructing pairs */
+typedef struct _KV_Sink KV_Sink; /* Destination for writing printed VDF contents */
+typedef struct _KV_Image KV_Image; /* Compiled tree of pairs that's read in place without parsing */
+typedef struct _KV_ImageNode KV_ImageNode; /* Read-only pair within a compiled image */
+typedef struct _KV_Query KV_Query; /* Compiled path to subpairs that can be looked up many times */
+typedef struct _KV_Flat KV_Flat; /* Read-only tree of pairs stored in flat arrays */
 
 
 /*********************************************************************************************************************************
@@ -121,16 +145,76 @@ typedef struct _KV_Pair KV_Pair; /* Value of a specific type under a key */
  *********************************************************************************************************************************/
 
 
-/* Clears any previous error message and frees all memory used by it. */
+/* Kinds of errors, each of which has its own message */
+typedef enum _KV_ErrorCode {
+  KV_ERROR_NONE = 0,          /* "No error" */
+  KV_ERROR_UNCLOSED_STRING,   /* "Unclosed string" */
+  KV_ERROR_UNEXPECTED_BRACE,  /* "Unexpected closing brace" */
+  KV_ERROR_DUPLICATE_KEY,     /* "Key already exists" */
+  KV_ERROR_DUPLICATE_INCLUDE, /* "Included key already exists" */
+  KV_ERROR_LOAD_FILE,         /* "Cannot include file" */
+  KV_ERROR_SAVE_FILE,         /* "Cannot open file for writing" */
+  KV_ERROR_NO_KEY,            /* "Subpair has no key" */
+  KV_ERROR_UNKNOWN_TYPE,      /* "Unknown value type" */
+  KV_ERROR_NO_ARGUMENT,       /* "No pair or path specified" */
+  KV_ERROR_WRITE_SINK,        /* "Cannot write printed contents" */
+  KV_ERROR_BINARY_END,        /* "Unexpected end of binary contents" */
+  KV_ERROR_BINARY_TYPE,       /* "Unsupported binary value type" */
+  KV_ERROR_IMAGE_INVALID,     /* "Invalid compiled image" */
+  KV_ERROR_IMAGE_VERSION,     /* "Unsupported compiled image version" */
+  KV_ERROR_IMAGE_CHECKSUM,    /* "Compiled image checksum mismatch" */
+  KV_ERROR_IMAGE_SIZE,        /* "Compiled image is too large" */
+  KV_ERROR_QUERY_SYNTAX,      /* "Invalid query path" */
+
+  KV_ERROR_NUMCODES
+} KV_ErrorCode;
+
+
+/* Maximum length of a file path in an error record, including the null terminator */
+#define KV_ERROR_PATH_LENGTH 260
+
+
+/* Record of an error that's kept as is and only formatted into a message on demand */
+typedef struct _KV_Error {
+  KV_ErrorCode code;
+  int errnum; /* Value of errno for file errors, otherwise 0; its description is appended to the message, e.g. ": No such file" */
+
+  KV_bool located; /* The error occurred within a parsed file or a character buffer */
+  size_t line; /* Line at which the error occurred, if it's located, or 0 for binary contents, which have no lines */
+  size_t offset; /* Byte offset from the beginning of the parsed file or buffer, or (size_t)-1 if it's unknown */
+  char file[KV_ERROR_PATH_LENGTH]; /* Path to the parsed file (truncated if it's too long) or an empty string for buffers */
+} KV_Error;
+
+
+/* Clears the last error. */
 void KV_ResetError(void);
 
 
 /* Returns a null-terminated string with the last set error.
+ * Each thread has its own error, unless the library has been built without threads (see VDF_USE_THREADS).
+ * Setting an error never allocates memory; the message is only formatted by this function.
  * This string is always temporary and should *not* be stored by pointer!
  */
 const char *KV_GetError(void);
 
 
+/* Returns the record of the last set error on the current thread, the code of which is KV_ERROR_NONE if there's no error.
+ * This record is always temporary and should *not* be stored by pointer!
+ */
+const KV_Error *KV_GetLastError(void);
+
+
+/* Formats an error record into a message, e.g. "path/to/file.vdf" at line 5 : Key already exists
+ * Errors in binary contents are located by byte offset instead, e.g. (buffer) at byte 42 : Unexpected end of binary contents
+ * Returns length of the formatted message, which is truncated if it doesn't fit into the buffer.
+ *
+ * error - Error record to format.
+ * buffer - Character buffer to write a null-terminated message into.
+ * size - Size of the character buffer in bytes.
+ */
+size_t KV_FormatError(const KV_Error *error, char *buffer, size_t size);
+
+
 /*********************************************************************************************************************************
  * String printer
  *********************************************************************************************************************************/
@@ -152,7 +236,8 @@ struct _KV_Printer {
  * The initialized printer must be cleared using KV_PrinterClear() when not needed anymore.
  *
  * ctx - String printer to initialize.
- * expansionstep - Amount of bytes to add to the string each time it is expanded and reallocated.
+ * expansionstep - Initial size of the buffer and the minimum amount of bytes to add to it each time it is expanded and
+ *                 reallocated. The buffer at least doubles in size each time, so the step doesn't need to be large.
  */
 void KV_PrinterInit(KV_Printer *ctx, size_t expansionstep);
 
@@ -188,6 +273,33 @@ void KV_PrinterResetString(KV_Printer *ctx);
 void KV_PrinterFormat(KV_Printer *ctx, const char *format, ...);
 
 
+/* Append raw characters at the end of the current character buffer of a string printer.
+ *
+ * ctx - String printer to append characters to.
+ * str - Characters to append. Doesn't need to be null-terminated.
+ * length - Amount of characters to append.
+ */
+void KV_PrinterAppend(KV_Printer *ctx, const char *str, size_t length);
+
+
+/* Append the same null-terminated string multiple times in a row, e.g. for indentation.
+ *
+ * ctx - String printer to append the string to.
+ * str - Null-terminated string to repeat.
+ * ct - Amount of times to append the string.
+ */
+void KV_PrinterAppendRepeated(KV_Printer *ctx, const char *str, size_t ct);
+
+
+/* Append a null-terminated string enclosed in double quotes.
+ *
+ * ctx - String printer to append the string to.
+ * str - Null-terminated string to enclose.
+ * escapeseq - Convert special characters into escape sequences, e.g. line breaks into \n and quotes into \".
+ */
+void KV_PrinterAppendQuoted(KV_Printer *ctx, const char *str, KV_bool escapeseq);
+
+
 /*********************************************************************************************************************************
  * Parser context
  *********************************************************************************************************************************/
@@ -210,10 +322,22 @@ struct _KV_Context {
   KV_bool _escapeseq : 1; /* (default: KV_true) Parse escape sequences in strings */
   KV_bool _multikey  : 1; /* (default: KV_true) Allow adding multiple values under the same key */
   KV_bool _overwrite : 1; /* (default: KV_true) Overwrite values of duplicate keys, if '_multikey' is disabled */
+  KV_bool _insitu    : 1; /* (default: KV_false) Parse strings right inside the character buffer, see KV_ContextSetupInSitu() */
+  KV_bool _symbols   : 1; /* (default: KV_false) Intern parsed keys in the symbol table, see KV_ContextSetSymbols() */
+  KV_bool _types     : 1; /* (default: KV_false) Store numeric values as typed values, see KV_ContextSetTypes() */
+  KV_bool _lazy      : 1; /* (default: KV_false) Parse nested lists only when they're accessed, see KV_ContextSetLazy() */
+
+  /* (default: NULL) Document to allocate parsed pairs and strings from instead of allocating each one separately */
+  KV_Document *_document;
+
+  /* (default: NULL) Pool to allocate parsed pairs and short strings from, if there's no document */
+  KV_Pool *_pool;
 
   /* Temporary parser data */
   const char *_pch; /* Currently parsed character */
   size_t _line; /* Currently parsed line */
+  struct _KV_Stream *_stream; /* State of an incremental parser, see KV_ContextSetupStream() */
+  struct _KV_LazySource *_source; /* Contents that lazy lists are being recorded from, see KV_ContextSetLazy() */
 };
 
 
@@ -228,6 +352,21 @@ struct _KV_Context {
 void KV_ContextSetupBuffer(KV_Context *ctx, const char *directory, const char *buffer, size_t length);
 
 
+/* Setup context for parsing a writable character buffer in place.
+ * Parsed keys and string values point directly into the buffer instead of being copied, which makes the parser
+ * only allocate the pairs themselves. To make room for null terminators and decoded escape sequences, the buffer
+ * is modified during parsing and cannot be parsed again afterwards.
+ * The buffer must outlive all pairs parsed from it, unless they're copied using KV_PairCopy().
+ * Setting new keys or values on these pairs is safe and doesn't affect the buffer.
+ *
+ * directory - Where to include files from when using #base and #include macros.
+   Empty or non-absolute paths are treated as relative to the current working directory.
+ * buffer - Writable character buffer to parse in place. May or may not be null-terminated.
+ * length - Maximum length of the specified character buffer. If set to -1, reads the buffer until a null character.
+ */
+void KV_ContextSetupInSitu(KV_Context *ctx, const char *directory, char *buffer, size_t length);
+
+
 /* Setup context for a new file.
  * Each string argument is borrowed for the lifetime of a KV_Context struct instead of copying its content.
  *
@@ -238,6 +377,17 @@ void KV_ContextSetupBuffer(KV_Context *ctx, const char *directory, const char *b
 void KV_ContextSetupFile(KV_Context *ctx, const char *directory, const char *path);
 
 
+/* Setup context for parsing VDF contents that arrive in chunks, e.g. from a pipe or over the network.
+ * Chunks are passed into KV_Feed() as soon as they arrive and the list is constructed by KV_Finish() at the end.
+ * Tokens, comments and keys can be split between chunks at any character.
+ * IMPORTANT: KV_Finish() needs to be called at the end to free the parser state, even after an error!
+ *
+ * directory - Where to include files from when using #base and #include macros.
+   Empty or non-absolute paths are treated as relative to the current working directory.
+ */
+void KV_ContextSetupStream(KV_Context *ctx, const char *directory);
+
+
 /* Customize parser behavior by toggling context flags.
  * This function can only be called after KV_ContextSetupBuffer() or KV_ContextSetupFile().
  */
@@ -249,6 +399,229 @@ void KV_ContextSetFlags(KV_Context *ctx, KV_bool escapeseq, KV_bool multikey, KV
 void KV_ContextCopyFlags(KV_Context *ctx, KV_Context *other);
 
 
+/* Make the parser intern all parsed keys in the global symbol table instead of allocating a copy for each pair.
+ * Each distinct key is stored only once and duplicate keys of parsed pairs are compared by pointer.
+ * This function can only be called after KV_ContextSetupBuffer() or KV_ContextSetupFile().
+ */
+void KV_ContextSetSymbols(KV_Context *ctx, KV_bool symbols);
+
+
+/* Make the parser infer types of parsed values the same way as KeyValues from Source SDK 2013 does.
+ * Decimal integers that fit into an int are stored as KV_TYPE_INT, numbers with a decimal point or an exponent are
+ * stored as KV_TYPE_FLOAT and "0x" followed by exactly 16 hexadecimal digits is stored as KV_TYPE_UINT64.
+ * Numbers are read the same way regardless of the current locale. All other values are stored as strings.
+ * Since typed pairs aren't strings, use KV_FindInt() and other typed getters instead of KV_FindString() to read them.
+ * This function can only be called after KV_ContextSetupBuffer() or KV_ContextSetupFile().
+ */
+void KV_ContextSetTypes(KV_Context *ctx, KV_bool types);
+
+
+/* Make the parser allocate all pairs and strings from a document instead of allocating each one separately.
+ * This function can only be called after KV_ContextSetupBuffer() or KV_ContextSetupFile().
+ * Lists returned by KV_Parse() within this context are owned by the document and are freed together with it.
+ *
+ * doc - Document to allocate from or NULL to allocate each pair separately (default behavior).
+ */
+void KV_ContextSetDocument(KV_Context *ctx, KV_Document *doc);
+
+
+/* Make the parser allocate pairs and short strings from a pool instead of allocating each one separately.
+ * Unlike with documents, parsed lists are still destroyed using KV_PairDestroy(), which returns their memory to the pool.
+ * Documents take precedence over pools. Files that are loaded on include threads, files that are stored in the include
+ * cache and files that are parsed by KV_ParseFilesParallel() are never parsed into the pool.
+ * This function can only be called after KV_ContextSetupBuffer() or KV_ContextSetupFile().
+ *
+ * pool - Pool to allocate from or NULL to use the pool of the current thread, if any (default behavior).
+ */
+void KV_ContextSetPool(KV_Context *ctx, KV_Pool *pool);
+
+
+/* Make the parser skip over contents of nested lists and parse them only when they're accessed for the first time.
+ * Each nested list only remembers where its contents are, which are found by quickly skipping over them while only
+ * keeping track of curly braces, quoted strings, escape sequences and comments. Once subpairs of such list are needed,
+ * e.g. by KV_GetHead(), KV_FindPair(), KV_Print() or other functions, its contents are parsed within the same context
+ * flags and document, and lists nested inside of it become lazy in turn.
+ * Lazy parsing makes loading large contents nearly instant if only a few of the lists are ever accessed.
+ * - Files are kept loaded until all of their lazy lists are either parsed or destroyed.
+ * - Character buffers are borrowed instead and need to outlive all lazy lists parsed from them.
+ * - Errors inside nested lists, such as duplicate keys or files that cannot be included, are only reported when
+ *   these lists are parsed. Use KV_Materialize() to parse them all at once.
+ *   Unclosed quoted strings are still reported right away because they're found while skipping.
+ * - Lists that couldn't be parsed keep their contents and report the error again whenever they're accessed. Until then
+ *   they act as empty lists that cannot be modified, and printing or saving them fails instead of leaving them out.
+ * - If there are errors both inside and outside of nested lists, the one outside is reported first, even if the other
+ *   one comes earlier in the contents, unlike when parsing everything at once.
+ * - Streams and files included through the include cache (see KV_SetIncludeCacheLimit()) are always parsed fully.
+ * This function can only be called after KV_ContextSetupBuffer() or KV_ContextSetupFile().
+ */
+void KV_ContextSetLazy(KV_Context *ctx, KV_bool lazy);
+
+
+/* Ways of scanning through quoted strings and comments in the parser */
+typedef enum _KV_ScanMode {
+  KV_SCAN_AUTO = 0, /* The fastest mode supported by the compiler and the CPU */
+  KV_SCAN_SCALAR,   /* One character at a time */
+  KV_SCAN_SWAR,     /* One machine word at a time using bitwise operations */
+  KV_SCAN_SSE2,     /* 16 characters at a time using SSE2 instructions (x86 only) */
+  KV_SCAN_AVX2,     /* 32 characters at a time using AVX2 instructions (x86 only) */
+} KV_ScanMode;
+
+
+/* Selects how the parser scans through quoted strings and comments in all contexts.
+ * The fastest supported mode is detected once when the first parser context is set up, even if it happens on several threads.
+ * Changing the mode isn't synchronized, so it shouldn't be done while other threads are parsing anything.
+ * Returns KV_false if the mode isn't supported by the compiler or the CPU, in which case the previous mode remains.
+ */
+KV_bool KV_SetScanMode(KV_ScanMode mode);
+
+
+/* Returns the mode that the parser currently scans with. Never returns KV_SCAN_AUTO. */
+KV_ScanMode KV_GetScanMode(void);
+
+
+/*********************************************************************************************************************************
+ * Documents
+ *********************************************************************************************************************************/
+
+
+/* Creates a new document that allocates memory for pairs and strings in large blocks.
+ * Documents are used for parsing big files, where allocating and freeing each pair separately takes most of the time.
+ * The returned document must be manually freed using KV_DocumentDestroy() when not needed anymore.
+ *
+ * blocksize - Amount of bytes to allocate for each new block. If set to 0, uses a default size of 64 KiB.
+ */
+KV_Document *KV_NewDocument(size_t blocksize);
+
+
+/* Frees all memory used by a document, including all pairs that have been allocated by it.
+ * Pairs from the document may still be modified before this, including calls to KV_PairDestroy() on them.
+ * Any pair that has been allocated by the document becomes invalid afterwards, even if it has been moved into another list!
+ */
+void KV_DocumentDestroy(KV_Document *doc);
+
+
+/*********************************************************************************************************************************
+ * Pools
+ *********************************************************************************************************************************/
+
+
+/* Creates a new pool that allocates pairs and short strings in large blocks and reuses them once they're freed.
+ * Pools are used by code that keeps creating and destroying pairs, where each separate allocation would go through the
+ * memory management functions. Pairs and strings are taken from lists of freed ones of the same size or cut out of
+ * the current block, and new blocks are only allocated once the free lists run out.
+ * Pooled pairs are destroyed as usual using KV_PairDestroy() and remember which pool they belong to, so they may be
+ * moved between lists, swapped or mixed with pairs that have been allocated in any other way.
+ * Pools aren't thread-safe. A pool may only be used by one thread at a time, which includes destroying its pairs.
+ * The returned pool must be manually freed using KV_PoolDestroy() when not needed anymore.
+ *
+ * blocksize - Amount of bytes to allocate for each new block. If set to 0, uses a default size of 64 KiB.
+ */
+KV_Pool *KV_NewPool(size_t blocksize);
+
+
+/* Frees all memory used by a pool at once.
+ * Any pair or string that has been allocated by the pool becomes invalid afterwards, even if it's in another list!
+ */
+void KV_PoolDestroy(KV_Pool *pool);
+
+
+/* Sets a pool that all pairs and their strings are allocated from on the current thread.
+ * It's used by all functions that create pairs or set their keys and string values, e.g. KV_NewString(),
+ * KV_PairCopy() or KV_SetKey(), as well as by the parser, unless its context has a document or a pool of its own.
+ * Strings that are longer than 55 characters are always allocated separately.
+ * Each thread has its own pool, unless the library has been built without threads (see VDF_USE_THREADS).
+ *
+ * pool - Pool to allocate from or NULL to allocate each pair separately (default behavior).
+ */
+void KV_SetThreadPool(KV_Pool *pool);
+
+
+/* Returns the pool of the current thread or NULL if there's none. */
+KV_Pool *KV_GetThreadPool(void);
+
+
+/* Returns the amount of bytes that are allocated by a pool, including freed pairs and strings that may be reused. */
+size_t KV_PoolGetSize(const KV_Pool *pool);
+
+
+/*********************************************************************************************************************************
+ * Symbols
+ *********************************************************************************************************************************/
+
+
+/* Returns an interned copy of a key name from the global symbol table, adding it to the table if needed.
+ * The same pointer is returned for all equal key names, which makes it very cheap to look them up using KV_FindPair().
+ * Interned strings remain valid until KV_ClearSymbols() is called. The symbol table isn't thread-safe.
+ */
+const char *KV_Intern(const char *key);
+
+
+/* Returns the amount of distinct key names in the global symbol table. */
+size_t KV_GetSymbolCount(void);
+
+
+/* Frees all memory used by the global symbol table, as well as the include cache (see KV_SetIncludeCacheLimit()).
+ * All pairs with interned keys, i.e. parsed with KV_ContextSetSymbols() enabled, must be destroyed beforehand.
+ */
+void KV_ClearSymbols(void);
+
+
+/*********************************************************************************************************************************
+ * Include cache
+ *********************************************************************************************************************************/
+
+
+/* Statistics of the global include cache */
+typedef struct _KV_IncludeCacheStats {
+  size_t hits;      /* Included files that have been copied from the cache */
+  size_t misses;    /* Included files that have been parsed because they weren't cached or have changed since */
+  size_t evictions; /* Cached files that have been removed in order to stay within the memory limit */
+  size_t files;     /* Amount of currently cached files */
+  size_t bytes;     /* Approximate amount of memory used by currently cached files */
+} KV_IncludeCacheStats;
+
+
+/* Sets the maximum amount of memory for keeping files from #base and #include macros parsed between includes.
+ * Cached files are looked up by their resolved path and parser flags and are only used if their size and modification
+ * time, as well as the ones of all files they include themselves, haven't changed since. Each includer gets its own copy.
+ * Least recently used files are removed from the cache when it exceeds the limit.
+ * Setting it to 0 disables the cache and frees it. The cache is disabled by default and isn't thread-safe.
+ */
+void KV_SetIncludeCacheLimit(size_t bytes);
+
+
+/* Removes a file from the include cache, along with all cached files that include it.
+ *
+ * path - Path to the file, relative to the current working directory. If NULL, removes all files.
+ */
+void KV_InvalidateIncludeCache(const char *path);
+
+
+/* Retrieves statistics of the include cache. Hit and miss counters are never reset. */
+void KV_GetIncludeCacheStats(KV_IncludeCacheStats *stats);
+
+
+/*********************************************************************************************************************************
+ * Include threads
+ *********************************************************************************************************************************/
+
+
+/* Sets the amount of worker threads that load files from #base and #include macros while the parser keeps going through
+ * the rest of the file. Included pairs are still added in the same order once the list with the macros is closed, so the
+ * parsed lists are identical to the ones loaded without threads. Nested includes are loaded on the workers as well.
+ * Files are loaded on the parser thread if the context interns keys (see KV_ContextSetSymbols()) or if the include cache
+ * is enabled. If memory functions are replaced (see VDF_MANAGE_MEMORY), they must be thread-safe.
+ * Errors are the same as well: if the parser fails, it waits for files from the macros before the error and reports the
+ * first one of them that couldn't be loaded instead, like it would've stopped there without threads.
+ *
+ * ct - Amount of threads to start. 0 (default) stops all threads and loads included files on the parser thread.
+ *
+ * Must not be called while any file is being parsed. Returns KV_false if the library has been built without threads
+ * or if the threads couldn't be started, in which case included files are loaded on the parser thread.
+ */
+KV_bool KV_SetIncludeThreads(size_t ct);
+
+
 /*********************************************************************************************************************************
  * One pair of key & value
  *********************************************************************************************************************************/
@@ -271,6 +644,19 @@ KV_Pair *KV_NewList(const char *key);
 KV_Pair *KV_NewString(const char *key, const char *value);
 
 
+/* Creates a new key-value pair with a typed value.
+ * The returned pair must be manually freed using KV_PairDestroy() when not needed anymore.
+ *
+ * key - Name of this pair or NULL for the root pair.
+ * value - Value of the respective type (see KV_DataType).
+ */
+KV_Pair *KV_NewInt(const char *key, int value);
+KV_Pair *KV_NewFloat(const char *key, float value);
+KV_Pair *KV_NewPointer(const char *key, void *value);
+KV_Pair *KV_NewColor(const char *key, KV_Color value);
+KV_Pair *KV_NewUint64(const char *key, KV_uint64 value);
+
+
 /* Creates a new key-value pair with a list of subpairs from another pair.
  * The entire list of subpairs is copied from 'other' and assigned to the new pair.
  * The returned pair must be manually freed using KV_PairDestroy() when not needed anymore.
@@ -282,6 +668,7 @@ KV_Pair *KV_NewListFrom(const char *key, KV_Pair *list);
 
 
 /* Frees all memory used by a pair, including itself and the potential subpairs recursively.
+ * Pairs allocated by a document are only unlinked and cleared because their memory is freed together with the document.
  */
 void KV_PairDestroy(KV_Pair *pair);
 
@@ -312,6 +699,18 @@ void KV_SetKey(KV_Pair *pair, const char *key);
 void KV_SetString(KV_Pair *pair, const char *value);
 
 
+/* Sets a new typed value.
+ * If the pair was already set up, the previous data is automatically cleared.
+ *
+ * value - Value of the respective type (see KV_DataType).
+ */
+void KV_SetInt(KV_Pair *pair, int value);
+void KV_SetFloat(KV_Pair *pair, float value);
+void KV_SetPointer(KV_Pair *pair, void *value);
+void KV_SetColor(KV_Pair *pair, KV_Color value);
+void KV_SetUint64(KV_Pair *pair, KV_uint64 value);
+
+
 /* Sets a new list of subpairs from another pair.
  * The entire list of subpairs is copied from 'other' and assigned to 'pair'.
  * If the pair was already set up, the previous data is automatically cleared.
@@ -360,25 +759,64 @@ void KV_Swap(KV_Pair *pair1, KV_Pair *pair2);
  * Returns NULL on error; call KV_GetError() for more information.
  *
  * pair - A pair to print out. If its key is NULL (a root pair), the value is printed as is.
- * length - An optional pointer to that will be filled with the returned buffer length afterwards.
- * expansionstep - Amount of bytes to add to the string each time it is expanded and reallocated.
+ * length - An optional pointer to that will be filled with the length of the printed string afterwards.
+ * expansionstep - Initial size of the buffer and the minimum amount of bytes to add to it each time it is expanded, which
+ *                 at least doubles it in size (see KV_PrinterInit()).
  * indentation - A string to use for indenting each nested subpair, e.g. one tab character.
  */
 char *KV_Print(KV_Pair *pair, size_t *length, size_t expansionstep, const char *indentation);
 
 
+/* Callback that receives printed VDF contents in chunks, along with a custom pointer */
+struct _KV_Sink {
+  /* Writes 'length' characters that *aren't* null-terminated. Returns KV_false on error, preferably setting errno. */
+  KV_bool (*_write)(void *data, const char *str, size_t length);
+  void *_data;
+};
+
+
+/* Prints a formatted pair into a sink in chunks of a fixed size, so only a small buffer is kept in memory regardless of
+ * the amount of printed contents. The output is the same as the one of KV_Print().
+ * Returns KV_false on error; call KV_GetError() for more information.
+ *
+ * pair - A pair to print out. If its key is NULL (a root pair), the value is printed as is.
+ * sink - Destination to write printed contents into.
+ * indentation - A string to use for indenting each nested subpair, e.g. one tab character.
+ */
+KV_bool KV_PrintToSink(KV_Pair *pair, const KV_Sink *sink, const char *indentation);
+
+
+/* Set up a sink that writes into an open file stream. */
+void KV_SinkSetupFile(KV_Sink *sink, FILE *file);
+
+
+/* Set up a sink that writes into an open file descriptor, where available. */
+void KV_SinkSetupDescriptor(KV_Sink *sink, int fd);
+
+
+/* Set up a sink that appends to the character buffer of a string printer, which grows as needed. */
+void KV_SinkSetupPrinter(KV_Sink *sink, KV_Printer *printer);
+
+
 /*********************************************************************************************************************************
  * Doubly linked lists
  *********************************************************************************************************************************/
 
 
+/* Parses contents of a lazy list and of all lists nested inside of it right away, see KV_ContextSetLazy().
+ * Returns KV_false if any of them couldn't be parsed, in which case these lists are left unparsed and the error is set.
+ * Pairs that have never been lazy are left as is.
+ */
+KV_bool KV_Materialize(KV_Pair *pair);
+
+
 /* Checks whether a list has any subpairs.
  * If the pair value isn't a list, always returns KV_false.
  */
 KV_bool KV_HasNodes(KV_Pair *list);
 
 
-/* Returns amount of subpairs in a list.
+/* Returns amount of subpairs in a list, which is kept track of without going through them.
  * If the pair value isn't a list, always returns -1.
  */
 size_t KV_GetNodeCount(KV_Pair *list);
@@ -386,16 +824,30 @@ size_t KV_GetNodeCount(KV_Pair *list);
 
 /* Returns n-th subpair from a list (if n >= 0) or NULL (if n >= KV_GetNodeCount()).
  * If the pair value isn't a list, always returns NULL.
+ * Wide lists put their subpairs into an array on the first access far from both ends, see KV_SetIndexThreshold().
  */
 KV_Pair *KV_GetPair(KV_Pair *list, size_t n);
 
 
 /* Returns the first subpair under the specified key, otherwise NULL.
  * If the pair value isn't a list, always returns NULL.
+ * Wide lists are indexed by key on the first lookup that goes through many subpairs, see KV_SetIndexThreshold().
  */
 KV_Pair *KV_FindPair(KV_Pair *list, const char *key);
 
 
+/* Sets the amount of subpairs that a key lookup may go through in a list before the list gets indexed by key.
+ * Indexed lists find subpairs under any key in constant time and keep their index up to date while they're modified.
+ * The same amount applies to KV_GetPair() walking through a list before putting its subpairs into an array.
+ * The array is kept when subpairs are added to or removed from the end and rebuilt on demand after other changes.
+ * Setting it to 0 stops indexing new lists. The default amount is 32.
+ * Lists that are searched for many keys at once (when catching duplicate keys during parsing, merging #base files,
+ * appending #include files, or in KV_CopyNodes() and KV_MergeNodes()) are still indexed when they get wide,
+ * but if it's set to 0, such an index is freed as soon as it's not needed anymore.
+ */
+void KV_SetIndexThreshold(size_t ct);
+
+
 /* Returns the first subpair of a specific type under the specified key, otherwise NULL.
  * If the pair value isn't a list, always returns NULL.
  */
@@ -413,6 +865,23 @@ KV_bool KV_IsEmpty(KV_Pair *list, const char *key);
 const char *KV_FindString(KV_Pair *list, const char *key, const char *defaultValue);
 
 
+/* Returns a number from the first subpair under the specified key or 'defaultValue' if not found or if it's not a number.
+ * Numbers are converted from int, float and 64-bit integer pairs, as well as strings with numbers in the same format
+ * as the one used by KV_ContextSetTypes(), which lets these work regardless of whether the types have been inferred.
+ * Converted numbers are clamped to the range of the returned type and fractions are discarded when returning integers.
+ */
+int KV_FindInt(KV_Pair *list, const char *key, int defaultValue);
+float KV_FindFloat(KV_Pair *list, const char *key, float defaultValue);
+KV_uint64 KV_FindUint64(KV_Pair *list, const char *key, KV_uint64 defaultValue);
+
+
+/* Returns a color from the first subpair under the specified key or 'defaultValue' if not found or if it's not a color.
+ * Colors are read from color pairs and strings with three or four integers from 0 to 255, e.g. "255 128 0".
+ * Alpha is set to 255 if it's omitted from a string.
+ */
+KV_Color KV_FindColor(KV_Pair *list, const char *key, KV_Color defaultValue);
+
+
 /* Returns the first subpair from a pair.
  * If the pair value isn't a list, always returns NULL.
  */
@@ -459,6 +928,45 @@ KV_Pair *KV_GetPrev(KV_Pair *pair);
 KV_Pair *KV_GetNext(KV_Pair *pair);
 
 
+/*********************************************************************************************************************************
+ * Queries
+ *********************************************************************************************************************************/
+
+
+/* Compiles a path to subpairs into a query that can be run on any list any amount of times.
+ * The query must be destroyed using KV_QueryDestroy() when not needed anymore.
+ * Returns NULL if the path is invalid; call KV_GetError() for more information.
+ *
+ * path - Keys of nested subpairs separated by slashes, e.g. "a/b/c" instead of looking up "a", "b" and "c" one by one.
+ *        Each key matches all subpairs under it, which is relevant for lists with multiple values under the same key.
+ *        A single asterisk instead of a key matches all subpairs under any key.
+ *        An index selector after a key ("a/b[2]/c") only matches the n-th subpair under it, counting from 0.
+ *        An index selector after an asterisk ("*[2]") only matches the n-th subpair in the list (see KV_GetPair()).
+ *        Slashes, brackets, asterisks and backslashes in keys are escaped using a backslash, e.g. "models\\/player"
+ *        in a C string literal matches the "models/player" key.
+ */
+KV_Query *KV_CompileQuery(const char *path);
+
+
+/* Destroys a compiled query. */
+void KV_QueryDestroy(KV_Query *query);
+
+
+/* Returns the first subpair that matches a query within a list, otherwise NULL.
+ * Subpairs are matched in the order they would be printed in, skipping intermediate pairs that aren't lists.
+ * Wide lists are indexed by key like in KV_FindPair() and looked up using keys that have been hashed beforehand.
+ */
+KV_Pair *KV_QueryFirst(const KV_Query *query, KV_Pair *list);
+
+
+/* Looks up all subpairs that match a query within a list in the same order as KV_QueryFirst().
+ * Returns the total amount of matched subpairs, which may be larger than 'count'.
+ *
+ * results - Array for the first 'count' matched subpairs or NULL to only count them.
+ */
+size_t KV_QueryAll(const KV_Query *query, KV_Pair *list, KV_Pair **results, size_t count);
+
+
 /*********************************************************************************************************************************
  * Pair values
  * NOTE: These functions *do not* perform any safety checks and may lead to undefined behavior if not used properly!
@@ -477,12 +985,21 @@ KV_DataType KV_GetDataType(KV_Pair *pair);
 char *KV_GetString(KV_Pair *pair);
 
 
+/* Returns the typed value of a pair, which must be of the respective type (see KV_DataType). */
+int KV_GetInt(KV_Pair *pair);
+float KV_GetFloat(KV_Pair *pair);
+void *KV_GetPointer(KV_Pair *pair);
+KV_Color KV_GetColor(KV_Pair *pair);
+KV_uint64 KV_GetUint64(KV_Pair *pair);
+
+
 /*********************************************************************************************************************************
  * Serialization
  *********************************************************************************************************************************/
 
 
 /* Constructs a list of subpairs by parsing within certain context.
+ * If the context has a document set, the returned list is owned by it and is freed by KV_DocumentDestroy().
  * Returns NULL on error; call KV_GetError() for more information.
  */
 KV_Pair *KV_Parse(KV_Context *ctx);
@@ -505,7 +1022,78 @@ KV_Pair *KV_ParseBuffer(const char *buffer, size_t length);
 KV_Pair *KV_ParseFile(const char *path);
 
 
-/* Save contents of a pair into a file.
+/* Parses multiple independent files at once on several threads, each of which keeps taking the next unparsed file.
+ * Returns KV_false if any of the files couldn't be parsed, in which case its result is NULL and its error is set.
+ * Errors of individual files aren't reported by KV_GetError(), which is reset by this function.
+ *
+ * paths - Array of 'count' paths to physical files on disk.
+ * count - Amount of files to parse.
+ * contexts - Array of 'count' contexts for each file or NULL to parse files in the current working directory.
+ *            Files are parsed from the directories of their contexts with their flags and into their documents,
+ *            which may be shared between multiple contexts. Pools of the contexts aren't used, since they aren't thread-safe.
+ * results - Array of 'count' lists for each parsed file. Lists must be manually freed using KV_PairDestroy().
+ * errors - Array of 'count' error records for each file (KV_ERROR_NONE on success) or NULL to discard them.
+ *          Use KV_FormatError() to get their messages.
+ * threads - Maximum amount of threads to parse files on, including the current one. If 0, uses one per processor.
+ *           Files are parsed on the current thread if the library has been built without threads, if the include
+ *           cache is enabled or if any of the contexts interns keys (see KV_ContextSetSymbols()).
+ */
+KV_bool KV_ParseFilesParallel(const char **paths, size_t count, KV_Context *contexts, KV_Pair **results, KV_Error *errors, size_t threads);
+
+
+/* Parses the next chunk of VDF contents within a context that has been set up using KV_ContextSetupStream().
+ * Everything up to the last complete token is parsed right away, while the rest waits for the next chunk.
+ * Returns KV_false on error, after which the context only needs to be finished; call KV_GetError() for more information.
+ *
+ * chunk - Characters to parse. They aren't null-terminated and don't need to outlive this call.
+ * length - Amount of characters in the chunk.
+ */
+KV_bool KV_Feed(KV_Context *ctx, const char *chunk, size_t length);
+
+
+/* Parses the rest of the characters after the last chunk and constructs a list of subpairs out of everything that's
+ * been passed into KV_Feed(). Frees the parser state within the context, which cannot be fed anymore afterwards.
+ * If the context has a document set, the returned list is owned by it and is freed by KV_DocumentDestroy().
+ * Returns NULL on error, including any earlier errors from KV_Feed(); call KV_GetError() for more information.
+ */
+KV_Pair *KV_Finish(KV_Context *ctx);
+
+
+/* Callbacks that are called by KV_ParseEvents() for each parsed element in order of appearance.
+ * Strings are passed as a pointer to 'length' characters that *aren't* null-terminated. They point directly into
+ * the parsed buffer, unless they contain escape sequences, and are only valid during the callback.
+ * Each callback returns KV_true to continue parsing or KV_false to stop immediately. Any of them may be NULL.
+ */
+struct _KV_Events {
+  /* Key of the next pair, which is followed by either a string value or a list */
+  KV_bool (*_key)(void *data, const char *key, size_t length);
+
+  /* String value of the pair after its key */
+  KV_bool (*_string)(void *data, const char *value, size_t length);
+
+  /* Beginning and end of a list of subpairs after the key of a pair. Lists left open at the end of the contents are ended too. */
+  KV_bool (*_beginlist)(void *data);
+  KV_bool (*_endlist)(void *data);
+
+  /* #base or #include macro with a path to the file. These files aren't parsed automatically.
+   * Macros are passed without calling '_key' and '_string' for them.
+   */
+  KV_bool (*_include)(void *data, KV_bool base, const char *path, size_t length);
+};
+
+
+/* Parses VDF contents within certain context by calling event callbacks instead of constructing a list of subpairs.
+ * The parser only allocates small temporary buffers for strings with escape sequences, regardless of the input size.
+ * Context flags for duplicate keys and the document are disregarded because no pairs are created.
+ * Returns KV_false on error, but not when stopped by a callback; call KV_GetError() for more information.
+ *
+ * events - Callbacks to call for each parsed element.
+ * data - Custom pointer that's passed into each callback.
+ */
+KV_bool KV_ParseEvents(KV_Context *ctx, const KV_Events *events, void *data);
+
+
+/* Save contents of a pair into a file, writing it in chunks as it's being printed (see KV_PrintToSink()).
  * Returns KV_false on error; call KV_GetError() for more information.
  *
  * path - Absolute or relative path to a physical file on disk.
@@ -513,6 +1101,251 @@ KV_Pair *KV_ParseFile(const char *path);
 KV_bool KV_Save(KV_Pair *pair, const char *path);
 
 
+/*********************************************************************************************************************************
+ * Binary format
+ * Compatible with KeyValues::ReadAsBinary() and KeyValues::WriteAsBinary() from Source SDK 2013.
+ * Each pair is stored as a byte with its type, a null-terminated key and its value: a null-terminated string,
+ * a little-endian number or color, or subpairs of a list that end with a KV_TYPE_NUMTYPES byte.
+ *********************************************************************************************************************************/
+
+
+/* Constructs a list of subpairs from binary contents in a character buffer.
+ * Typed values are kept as is, e.g. KV_TYPE_INT pairs, which are printed in VDF contents as decimal strings.
+ * Returns NULL on error; call KV_GetError() for more information.
+ *
+ * buffer - Binary contents to read from.
+ * length - Size of the binary contents in bytes.
+ * doc - Document to allocate pairs and strings from or NULL to allocate them separately.
+ *       If set, the returned list is owned by it and is freed by KV_DocumentDestroy().
+ */
+KV_Pair *KV_ParseBinary(const void *buffer, size_t length, KV_Document *doc);
+
+
+/* Constructs a list of subpairs by directly reading binary contents from a file in the current working directory.
+ * Returns NULL on error; call KV_GetError() for more information.
+ *
+ * path - Absolute or relative path to a physical file on disk.
+ * doc - Document to allocate pairs and strings from or NULL to allocate them separately.
+ */
+KV_Pair *KV_ParseBinaryFile(const char *path, KV_Document *doc);
+
+
+/* Writes a pair with all of its subpairs as binary contents into a sink in chunks.
+ * A root pair (with a NULL key) has its subpairs written instead, just like when printing it.
+ * Returns KV_false on error; call KV_GetError() for more information.
+ *
+ * sink - Destination to write binary contents into (see KV_SinkSetupFile()).
+ */
+KV_bool KV_WriteBinary(KV_Pair *pair, const KV_Sink *sink);
+
+
+/* Save contents of a pair into a file in the binary format.
+ * Returns KV_false on error; call KV_GetError() for more information.
+ *
+ * path - Absolute or relative path to a physical file on disk.
+ */
+KV_bool KV_SaveBinary(KV_Pair *pair, const char *path);
+
+
+/*********************************************************************************************************************************
+ * Compiled images
+ * A compiled image is a flat copy of a tree of pairs that uses offsets instead of pointers, so it can be mapped from
+ * a file and read in place without parsing it or constructing any pairs. Subpairs of each list are stored next to
+ * each other and wide lists come with a table of keys for finding subpairs in constant time.
+ * Images begin with a header that has a version and a checksum of the contents, which are validated when opening them.
+ * Images are stored in the native byte order and cannot be opened on platforms with a different one.
+ *********************************************************************************************************************************/
+
+
+/* Current version of compiled images, which is increased with each incompatible change to their layout */
+#define KV_IMAGE_VERSION 1
+
+
+/* Compiles a pair with all of its subpairs into an image and writes it into a sink.
+ * Includes should be applied beforehand by parsing the contents normally, after which the image needs no other files.
+ * Returns KV_false on error; call KV_GetError() for more information.
+ *
+ * pair - Pair that becomes the root node of the image, usually a list returned by the parser.
+ * sink - Destination to write the image into (see KV_SinkSetupFile()).
+ */
+KV_bool KV_CompileImage(KV_Pair *pair, const KV_Sink *sink);
+
+
+/* Compiles a pair with all of its subpairs into an image file (see KV_CompileImage()).
+ * Returns KV_false on error; call KV_GetError() for more information.
+ *
+ * path - Absolute or relative path to a physical file on disk.
+ */
+KV_bool KV_SaveImage(KV_Pair *pair, const char *path);
+
+
+/* Loads a compiled image from a file and validates it.
+ * Regular files are mapped into memory where possible, so loading an image costs no more than reading through it once.
+ * The returned image must be destroyed using KV_ImageDestroy() when not needed anymore.
+ * Returns NULL on error; call KV_GetError() for more information.
+ *
+ * path - Absolute or relative path to a physical file on disk.
+ */
+KV_Image *KV_LoadImage(const char *path);
+
+
+/* Validates a compiled image in memory and opens it for reading in place.
+ * The returned image must be destroyed using KV_ImageDestroy() when not needed anymore.
+ * Returns NULL on error; call KV_GetError() for more information.
+ *
+ * buffer - Image contents that are borrowed until the image is destroyed. Must be aligned to 4 bytes.
+ * length - Size of the image contents in bytes.
+ */
+KV_Image *KV_OpenImage(const void *buffer, size_t length);
+
+
+/* Destroys a compiled image and unmaps or frees its contents, if they have been loaded from a file.
+ * All nodes of the image become invalid.
+ */
+void KV_ImageDestroy(KV_Image *image);
+
+
+/* Returns the root node of a compiled image, which is the pair that the image has been compiled from. */
+const KV_ImageNode *KV_ImageGetRoot(const KV_Image *image);
+
+
+/* Returns amount of subpairs in a list node.
+ * If the node value isn't a list, always returns -1.
+ */
+size_t KV_ImageGetNodeCount(const KV_ImageNode *list);
+
+
+/* Returns n-th subpair node from a list node (if n >= 0) or NULL (if n >= KV_ImageGetNodeCount()).
+ * If the node value isn't a list, always returns NULL.
+ */
+const KV_ImageNode *KV_ImageGetNode(const KV_ImageNode *list, size_t n);
+
+
+/* Returns the first subpair node under the specified key, otherwise NULL.
+ * If the node value isn't a list, always returns NULL.
+ */
+const KV_ImageNode *KV_ImageFindNode(const KV_ImageNode *list, const char *key);
+
+
+/* Returns the first subpair node of a list node.
+ * If the node value isn't a list or it's empty, returns NULL.
+ */
+const KV_ImageNode *KV_ImageGetHead(const KV_ImageNode *list);
+
+
+/* Returns the next neighbor of a subpair node or NULL if it's the last one in its list. */
+const KV_ImageNode *KV_ImageGetNext(const KV_ImageNode *node);
+
+
+/* Returns the key name of a node or NULL for the root pair. */
+const char *KV_ImageGetKey(const KV_ImageNode *node);
+
+
+/* Returns data type of a node value. */
+KV_DataType KV_ImageGetDataType(const KV_ImageNode *node);
+
+
+/* Returns the value of a node, which must be of the respective type (see KV_DataType).
+ * Strings point directly into the image and are valid until it's destroyed.
+ */
+const char *KV_ImageGetString(const KV_ImageNode *node);
+int KV_ImageGetInt(const KV_ImageNode *node);
+float KV_ImageGetFloat(const KV_ImageNode *node);
+void *KV_ImageGetPointer(const KV_ImageNode *node);
+KV_Color KV_ImageGetColor(const KV_ImageNode *node);
+KV_uint64 KV_ImageGetUint64(const KV_ImageNode *node);
+
+
+/*********************************************************************************************************************************
+ * Flat trees
+ * A flat tree is a read-only copy of a tree of pairs that stores all of its nodes in memory next to each other in the order
+ * they would be printed in. Each property of the nodes (key, type, value, next neighbor and subtree size) has its own array,
+ * so going through all nodes or all subpairs of a list only touches the arrays that are needed for it.
+ * Nodes are referred to by their indices, where the root node is always at 0. Since the root node can never be a subpair,
+ * functions that return subpair nodes return 0 when there are none.
+ * Keys and string values are kept in one string pool, where each distinct key is only stored once.
+ *********************************************************************************************************************************/
+
+
+/* Copies a pair with all of its subpairs into a new flat tree.
+ * The flat tree must be destroyed using KV_FlatDestroy() when not needed anymore.
+ * Returns NULL on error; call KV_GetError() for more information.
+ *
+ * pair - Pair that becomes the root node of the flat tree, usually a list returned by the parser.
+ */
+KV_Flat *KV_FlattenPair(KV_Pair *pair);
+
+
+/* Parses VDF contents within certain context directly into a new flat tree without constructing any pairs.
+ * Like KV_ParseEvents(), it keeps all duplicate keys and doesn't include files from #base and #include macros, which
+ * are skipped; parse the contents normally and use KV_FlattenPair() if they're needed.
+ * Numeric values are inferred if the context is set up to do it (see KV_ContextSetTypes()).
+ * The flat tree must be destroyed using KV_FlatDestroy() when not needed anymore.
+ * Returns NULL on error; call KV_GetError() for more information.
+ */
+KV_Flat *KV_ParseFlat(KV_Context *ctx);
+
+
+/* Destroys a flat tree. All of its strings become invalid. */
+void KV_FlatDestroy(KV_Flat *flat);
+
+
+/* Returns the total amount of nodes in a flat tree, including the root node.
+ * Going through all indices from 0 to this amount visits every node in the order they would be printed in.
+ */
+size_t KV_FlatGetSize(const KV_Flat *flat);
+
+
+/* Returns the amount of nodes in the subtree of a node, including the node itself.
+ * The node after its subtree is at 'node + KV_FlatGetSubtreeSize(flat, node)', which lets nested lists be skipped at once.
+ */
+size_t KV_FlatGetSubtreeSize(const KV_Flat *flat, size_t node);
+
+
+/* Returns amount of subpairs in a list node.
+ * If the node value isn't a list, always returns -1.
+ */
+size_t KV_FlatGetNodeCount(const KV_Flat *flat, size_t list);
+
+
+/* Returns the first subpair node of a list node, which is always right after it.
+ * If the node value isn't a list or it's empty, returns 0.
+ */
+size_t KV_FlatGetHead(const KV_Flat *flat, size_t list);
+
+
+/* Returns the next neighbor of a subpair node or 0 if it's the last one in its list. */
+size_t KV_FlatGetNext(const KV_Flat *flat, size_t node);
+
+
+/* Returns the first subpair node under the specified key, otherwise 0.
+ * If the node value isn't a list, always returns 0.
+ * The key is looked up among distinct keys of the flat tree once, after which subpairs are compared by key offset only.
+ * Lists that are wider than the index threshold at the time of constructing the flat tree (see KV_SetIndexThreshold())
+ * are put into a table that finds subpairs under any of their keys in constant time.
+ */
+size_t KV_FlatFindNode(const KV_Flat *flat, size_t list, const char *key);
+
+
+/* Returns the key name of a node or NULL for a root pair without a key. */
+const char *KV_FlatGetKey(const KV_Flat *flat, size_t node);
+
+
+/* Returns data type of a node value. */
+KV_DataType KV_FlatGetDataType(const KV_Flat *flat, size_t node);
+
+
+/* Returns the value of a node, which must be of the respective type (see KV_DataType).
+ * Strings are stored in the flat tree and are valid until it's destroyed.
+ */
+const char *KV_FlatGetString(const KV_Flat *flat, size_t node);
+int KV_FlatGetInt(const KV_Flat *flat, size_t node);
+float KV_FlatGetFloat(const KV_Flat *flat, size_t node);
+void *KV_FlatGetPointer(const KV_Flat *flat, size_t node);
+KV_Color KV_FlatGetColor(const KV_Flat *flat, size_t node);
+KV_uint64 KV_FlatGetUint64(const KV_Flat *flat, size_t node);
+
+
 #ifdef __cplusplus
 }
 #endif
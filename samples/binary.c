@@ -0,0 +1,96 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include "../keyvalues.h"
+
+int main(int argc, char *argv[]) {
+  printf("---------------- BINARY ----------------\n");
+
+  // Create a list with typed values
+  KV_Pair *list = KV_NewList(NULL);
+  KV_Pair *sub = KV_NewList("Player");
+  KV_AddTail(list, sub);
+
+  KV_Color color = { 255, 128, 0, 255 };
+
+  KV_AddTail(sub, KV_NewString("Name", "Gordon"));
+  KV_AddTail(sub, KV_NewInt("Health", 100));
+  KV_AddTail(sub, KV_NewFloat("Speed", 1.5f));
+  KV_AddTail(sub, KV_NewColor("Color", color));
+  KV_AddTail(sub, KV_NewUint64("SteamID", 76561197960265728ULL));
+
+  // Save list into a file in the binary format
+  if (!KV_SaveBinary(list, "out.bin")) {
+    printf("Cannot save binary file: %s\n", KV_GetError());
+    KV_PairDestroy(list);
+    return 1;
+  }
+
+  KV_PairDestroy(list);
+
+  // Read it back with all the types intact
+  list = KV_ParseBinaryFile("out.bin", NULL);
+
+  if (!list) {
+    printf("Cannot read binary file: %s\n", KV_GetError());
+    return 1;
+  }
+
+  sub = KV_FindPair(list, "Player");
+  printf("-- Health: %d\n", KV_GetInt(KV_FindPair(sub, "Health")));
+  printf("-- Speed: %g\n", KV_GetFloat(KV_FindPair(sub, "Speed")));
+
+  // Typed values are printed as strings
+  char *buffer = KV_Print(list, NULL, 1024, "\t");
+  printf("-- Contents of 'out.bin':\n%s", buffer);
+  KV_free(buffer);
+
+  KV_PairDestroy(list);
+  remove("out.bin");
+
+  return 0;
+};
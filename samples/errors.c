@@ -104,6 +104,10 @@ int main(int argc, char *argv[]) {
 
   if (!list) {
     printf("SUCCESS (string value) - %s\n", KV_GetError());
+
+    // Inspect the error record instead of the message
+    const KV_Error *err = KV_GetLastError();
+    printf("  code %d in \"%s\" at line %lu, byte %lu\n", (int)err->code, err->file, (unsigned long)err->line, (unsigned long)err->offset);
   } else {
     printf("FAIL (string value) - No error occurred\n");
     KV_PairDestroy(list);
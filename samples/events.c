@@ -0,0 +1,126 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include <stdio.h>
+#include "../keyvalues.h"
+
+// State that's passed into each callback
+typedef struct {
+  int depth;
+  int pairs;
+} Stats;
+
+static void Indent(Stats *stats) {
+  for (int i = 0; i < stats->depth; ++i) printf("  ");
+};
+
+static KV_bool OnKey(void *data, const char *key, size_t length) {
+  Stats *stats = (Stats *)data;
+  ++stats->pairs;
+
+  // Strings aren't null-terminated, so their length needs to be specified
+  Indent(stats);
+  printf("%.*s: ", (int)length, key);
+  return KV_true;
+};
+
+static KV_bool OnString(void *data, const char *value, size_t length) {
+  // Escape sequences are already parsed in strings
+  printf("\"%.*s\"\n", (int)length, value);
+  return KV_true;
+};
+
+static KV_bool OnBeginList(void *data) {
+  Stats *stats = (Stats *)data;
+  ++stats->depth;
+
+  printf("[\n");
+  return KV_true;
+};
+
+static KV_bool OnEndList(void *data) {
+  Stats *stats = (Stats *)data;
+  --stats->depth;
+
+  Indent(stats);
+  printf("]\n");
+  return KV_true;
+};
+
+static KV_bool OnFirstKey(void *data, const char *key, size_t length) {
+  printf("First key: %.*s\n", (int)length, key);
+
+  // Stop parsing after the first key
+  return KV_false;
+};
+
+int main(int argc, char *argv[]) {
+  printf("---------------- EVENTS ----------------\n");
+
+  // Callbacks that aren't needed can be left as NULL
+  KV_Events events = { OnKey, OnString, OnBeginList, OnEndList, NULL };
+  Stats stats = { 0, 0 };
+
+  KV_Context ctx;
+  KV_ContextSetupFile(&ctx, "", "sample.vdf");
+
+  // Parse the file without constructing any pairs
+  if (!KV_ParseEvents(&ctx, &events, &stats)) {
+    fprintf(stderr, "%s\n", KV_GetError());
+    return 1;
+  }
+
+  printf("-- Parsed %d pairs\n", stats.pairs);
+
+  // Parsing can be stopped at any point
+  KV_Events first = { OnFirstKey, NULL, NULL, NULL, NULL };
+
+  KV_ContextSetupFile(&ctx, "", "sample.vdf");
+  KV_ParseEvents(&ctx, &first, NULL);
+
+  return 0;
+};
@@ -0,0 +1,91 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include "../keyvalues.h"
+
+int main(int argc, char *argv[]) {
+  printf("---------------- FLAT ----------------\n");
+
+  // Parse the file straight into flat arrays without constructing any pairs
+  KV_Context ctx;
+  KV_ContextSetupFile(&ctx, "", "sample.vdf");
+
+  KV_Flat *flat = KV_ParseFlat(&ctx);
+
+  if (!flat) {
+    fprintf(stderr, "%s\n", KV_GetError());
+    return 1;
+  }
+
+  // Visit every node in order by simply going through all indices
+  size_t i;
+
+  for (i = 1; i < KV_FlatGetSize(flat); ++i) {
+    if (KV_FlatGetDataType(flat, i) == KV_TYPE_NONE) {
+      printf("%s: list of %d subpairs\n", KV_FlatGetKey(flat, i), (int)KV_FlatGetNodeCount(flat, i));
+    } else {
+      printf("%s = %s\n", KV_FlatGetKey(flat, i), KV_FlatGetString(flat, i));
+    }
+  }
+
+  // Look up subpairs by key and skip over the rest of the tree after the list
+  size_t list = KV_FlatFindNode(flat, 0, "secret list");
+  printf("'Half-Life 3' = %s\n", KV_FlatGetString(flat, KV_FlatFindNode(flat, list, "Half-Life 3")));
+  printf("nodes after the list: %d\n", (int)(KV_FlatGetSize(flat) - list - KV_FlatGetSubtreeSize(flat, list)));
+
+  KV_FlatDestroy(flat);
+
+  // Flatten pairs that have already been parsed
+  KV_Pair *pairs = KV_ParseFile("sample.vdf");
+  flat = KV_FlattenPair(pairs);
+  KV_PairDestroy(pairs);
+
+  printf("'key2' = %s\n", KV_FlatGetString(flat, KV_FlatFindNode(flat, 0, "key2")));
+
+  KV_FlatDestroy(flat);
+  return 0;
+};
@@ -89,7 +89,10 @@ int main(int argc, char *argv[]) {
 
   KV_Pair *list;
   char *buffer;
+  KV_IncludeCacheStats stats;
 
+  // Keep included files parsed, since both lists include the same ones
+  KV_SetIncludeCacheLimit(1024 * 1024);
 
   // Parse #include macros
   list = KV_ParseBuffer(_include, -1);
@@ -122,5 +125,12 @@ int main(int argc, char *argv[]) {
 
   KV_PairDestroy(list);
 
+
+  // Each file has only been parsed once
+  KV_GetIncludeCacheStats(&stats);
+  printf("\n-- Include cache: %zu hits, %zu misses\n", stats.hits, stats.misses);
+
+  KV_SetIncludeCacheLimit(0);
+
   return 0;
 };
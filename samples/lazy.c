@@ -0,0 +1,133 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include "../keyvalues.h"
+
+int main(int argc, char *argv[]) {
+  printf("---------------- LAZY ----------------\n");
+
+  const char *example =
+    "settings\n"
+    "{\n"
+    "  width  1280\n"
+    "  height 720\n"
+    "}\n"
+    "levels\n"
+    "{\n"
+    "  \"level 1\" { map \"c1a0\" }\n"
+    "  \"level 2\" { map \"c1a1\" }\n"
+    "}\n"
+    "broken\n"
+    "{\n"
+    "  #include \"missing.vdf\"\n"
+    "}";
+
+  // Skip over the contents of each list until it's accessed for the first time
+  KV_Context ctx;
+  KV_ContextSetupBuffer(&ctx, "", example, -1);
+  KV_ContextSetLazy(&ctx, KV_true);
+
+  KV_Pair *list = KV_Parse(&ctx);
+
+  if (!list) {
+    fprintf(stderr, "%s\n", KV_GetError());
+    return 1;
+  }
+
+  // Only the top-level pairs are parsed at this point
+  printf("top-level pairs: %d\n", (int)KV_GetNodeCount(list));
+
+  // Looking inside of a list parses it on the spot
+  KV_Pair *settings = KV_FindPair(list, "settings");
+  printf("width = %s\n", KV_FindString(settings, "width", "?"));
+
+  // Errors inside of lists are only reported once they're accessed (except for unclosed strings that stop the skipping)
+  KV_Pair *broken = KV_FindPair(list, "broken");
+
+  if (!KV_GetHead(broken)) {
+    printf("broken list: %s\n", KV_GetError());
+  }
+
+  // Parse all remaining lists at once, e.g. before the source buffer goes away
+  KV_Materialize(KV_FindPair(list, "levels"));
+
+  // Lists that couldn't be parsed keep their contents, so printing them fails instead of leaving them out
+  char *str = KV_Print(list, NULL, 256, "  ");
+
+  if (!str) {
+    printf("cannot print: %s\n", KV_GetError());
+
+    KV_PairDestroy(broken);
+    str = KV_Print(list, NULL, 256, "  ");
+  }
+
+  printf("%s", str);
+  free(str);
+
+  KV_PairDestroy(list);
+
+  // Skipped lists are read the same way as the parser reads them, even right after comments
+  const char *tricky = "\"a\" { /* x *//}\n\"k\" \"v\" }";
+
+  for (int lazy = 0; lazy < 2; ++lazy) {
+    KV_ContextSetupBuffer(&ctx, "", tricky, -1);
+    KV_ContextSetLazy(&ctx, (KV_bool)lazy);
+
+    list = KV_Parse(&ctx);
+
+    if (!list || !KV_Materialize(list)) {
+      printf("%s: %s\n", lazy ? "lazy" : "eager", KV_GetError());
+      if (list) KV_PairDestroy(list);
+      continue;
+    }
+
+    printf("%s: k = %s\n", lazy ? "lazy" : "eager", KV_FindString(KV_FindPair(list, "a"), "k", "?"));
+    KV_PairDestroy(list);
+  }
+
+  return 0;
+};
@@ -0,0 +1,126 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../keyvalues.h"
+
+// Keeps replacing random entities in a list with new ones, like an editor that's constantly changing the contents
+static double MeasureChurn(KV_Pool *pool) {
+  KV_Pair *aEntities[1000];
+  const size_t ctEntities = sizeof(aEntities) / sizeof(aEntities[0]);
+  const size_t ctEdits = 1000000;
+  char key[32];
+
+  // Pairs and their strings are allocated from the pool of the current thread, if there's any
+  KV_SetThreadPool(pool);
+
+  clock_t start = clock();
+  KV_Pair *list = KV_NewList(NULL);
+
+  for (size_t i = 0; i < ctEntities + ctEdits; ++i) {
+    // Destroy a random entity together with its subpairs
+    size_t iEntity = (i < ctEntities) ? i : (size_t)rand() % ctEntities;
+    if (i >= ctEntities) KV_PairDestroy(aEntities[iEntity]);
+
+    KV_Pair *entity = KV_NewList("entity");
+    sprintf(key, "ent_%u", (unsigned)i);
+
+    KV_AddTail(entity, KV_NewString("targetname", key));
+    KV_AddTail(entity, KV_NewString("classname", "prop_physics"));
+    KV_AddTail(entity, KV_NewString("origin", "128 -64 32"));
+    KV_AddTail(entity, KV_NewInt("health", 100));
+
+    KV_AddTail(list, entity);
+    aEntities[iEntity] = entity;
+  }
+
+  KV_PairDestroy(list);
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  KV_SetThreadPool(NULL);
+  return seconds * 1000.0;
+};
+
+int main(int argc, char *argv[]) {
+  printf("---------------- POOLS ----------------\n");
+
+  // Create a pool that reuses memory of destroyed pairs and short strings
+  KV_Pool *pool = KV_NewPool(0);
+
+  // Pairs from the pool are used and destroyed like any other pairs
+  KV_SetThreadPool(pool);
+
+  KV_Pair *list = KV_NewList(NULL);
+  KV_AddTail(list, KV_NewString("key1", "value"));
+  KV_AddTail(list, KV_NewString("key2", "This value is too long to be pooled, so it's allocated separately"));
+  KV_AddTail(list, KV_NewList("dummy"));
+
+  // Pairs allocated in other ways may be mixed with pooled ones
+  KV_SetThreadPool(NULL);
+  KV_AddTail(list, KV_NewString("key3", "not pooled"));
+
+  char *str = KV_Print(list, NULL, 256, "  ");
+  printf("%s", str);
+  free(str);
+
+  KV_PairDestroy(list);
+
+  // Freed memory is reused by the churn below
+  srand(1);
+  double msPool = MeasureChurn(pool);
+  printf("Pool memory: %u KiB\n", (unsigned)(KV_PoolGetSize(pool) / 1024));
+
+  KV_PoolDestroy(pool);
+
+  srand(1);
+  double msHeap = MeasureChurn(NULL);
+
+  printf("Churn without a pool: %.1f ms\n", msHeap);
+  printf("Churn with a pool:    %.1f ms\n", msPool);
+  return 0;
+};
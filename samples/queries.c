@@ -0,0 +1,100 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include "../keyvalues.h"
+
+int main(int argc, char *argv[]) {
+  printf("---------------- QUERIES ----------------\n");
+
+  const char *example =
+    "entities\n"
+    "{\n"
+    "  light  { origin \"0 0 64\"   brightness 200 }\n"
+    "  light  { origin \"128 0 64\" brightness 300 }\n"
+    "  player { origin \"0 0 0\" }\n"
+    "}\n"
+    "\"models/player\" { model \"gordon.mdl\" }";
+
+  KV_Pair *list = KV_ParseBuffer(example, -1);
+
+  if (!list) {
+    fprintf(stderr, "%s\n", KV_GetError());
+    return 1;
+  }
+
+  // Compile paths once and reuse them as many times as needed
+  KV_Query *queryOrigin = KV_CompileQuery("entities/player/origin");
+  KV_Query *queryLights = KV_CompileQuery("entities/light/brightness");
+  KV_Query *querySecond = KV_CompileQuery("entities/*[1]/origin");
+  KV_Query *queryModel  = KV_CompileQuery("models\\/player/model");
+
+  printf("player origin = %s\n", KV_GetString(KV_QueryFirst(queryOrigin, list)));
+  printf("second entity origin = %s\n", KV_GetString(KV_QueryFirst(querySecond, list)));
+  printf("player model = %s\n", KV_GetString(KV_QueryFirst(queryModel, list)));
+
+  // Find all pairs that match a path under duplicate keys
+  KV_Pair *apResults[8];
+  size_t ct = KV_QueryAll(queryLights, list, apResults, 8);
+  size_t i;
+
+  for (i = 0; i < ct; ++i) {
+    printf("light %d brightness = %s\n", (int)i, KV_GetString(apResults[i]));
+  }
+
+  KV_QueryDestroy(queryOrigin);
+  KV_QueryDestroy(queryLights);
+  KV_QueryDestroy(querySecond);
+  KV_QueryDestroy(queryModel);
+
+  // Invalid paths aren't compiled
+  if (!KV_CompileQuery("entities/light[")) {
+    printf("%s\n", KV_GetError());
+  }
+
+  KV_PairDestroy(list);
+  return 0;
+};
@@ -0,0 +1,121 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../keyvalues.h"
+
+// Generates a big buffer with lots of comments and long string values
+static char *GenerateBuffer(size_t *length) {
+  const size_t ctPairs = 100000;
+  char *buffer = (char *)malloc(ctPairs * 200 + 16);
+  char *pch = buffer;
+
+  pch += sprintf(pch, "root\n{\n");
+
+  for (size_t i = 0; i < ctPairs; ++i) {
+    pch += sprintf(pch, "\t// Comment number %u that describes the following pair in great detail\n", (unsigned)i);
+    pch += sprintf(pch, "\t\"key_%u\"\t\"Quite a long string value with \\\"escape sequences\\\" in it\"\n", (unsigned)i);
+  }
+
+  pch += sprintf(pch, "}\n");
+
+  *length = pch - buffer;
+  return buffer;
+};
+
+// Returns parsing throughput in megabytes per second
+static double MeasureThroughput(const char *buffer, size_t length, KV_bool bounded) {
+  double best = 0.0;
+
+  for (int i = 0; i < 5; ++i) {
+    KV_Document *doc = KV_NewDocument(0);
+
+    KV_Context ctx;
+    KV_ContextSetupBuffer(&ctx, "", buffer, bounded ? length : (size_t)-1);
+    KV_ContextSetDocument(&ctx, doc);
+
+    clock_t start = clock();
+    KV_Parse(&ctx);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    KV_DocumentDestroy(doc);
+
+    if (seconds > 0.0 && length / seconds / 1e6 > best) best = length / seconds / 1e6;
+  }
+
+  return best;
+};
+
+int main(int argc, char *argv[]) {
+  printf("---------------- SCANNING ----------------\n");
+
+  static const char *astrModes[] = { "Auto", "Scalar", "SWAR", "SSE2", "AVX2" };
+
+  size_t length;
+  char *buffer = GenerateBuffer(&length);
+
+  // The fastest supported mode is used by default
+  printf("Default mode: %s\n", astrModes[KV_GetScanMode()]);
+
+  for (int mode = KV_SCAN_SCALAR; mode <= KV_SCAN_AVX2; ++mode) {
+    // Modes may not be supported by the compiler or the CPU
+    if (!KV_SetScanMode((KV_ScanMode)mode)) {
+      printf("%-8s unsupported\n", astrModes[mode]);
+      continue;
+    }
+
+    printf("%-8s %6.0f MB/s (null-terminated), %6.0f MB/s (bounded)\n", astrModes[mode],
+      MeasureThroughput(buffer, length, KV_false), MeasureThroughput(buffer, length, KV_true));
+  }
+
+  KV_SetScanMode(KV_SCAN_AUTO);
+  free(buffer);
+  return 0;
+};
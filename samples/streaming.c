@@ -0,0 +1,124 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../keyvalues.h"
+
+// Feeds a string into the parser a few characters at a time, as if it was arriving over the network
+static KV_Pair *FeedString(const char *str, size_t chunk) {
+  KV_Context ctx;
+  KV_ContextSetupStream(&ctx, "");
+
+  size_t length = strlen(str);
+
+  for (size_t i = 0; i < length; i += chunk) {
+    size_t size = (length - i < chunk) ? length - i : chunk;
+
+    // Stop feeding after an error but still finish parsing to free the parser state
+    if (!KV_Feed(&ctx, str + i, size)) break;
+  }
+
+  return KV_Finish(&ctx);
+};
+
+int main(int argc, char *argv[]) {
+  printf("---------------- STREAMING ----------------\n");
+
+  // Chunks can be read from any source, e.g. from a pipe
+  FILE *file = fopen("sample.vdf", "rb");
+
+  if (!file) {
+    fprintf(stderr, "Cannot open sample.vdf\n");
+    return 1;
+  }
+
+  KV_Context ctx;
+  KV_ContextSetupStream(&ctx, "");
+
+  char chunk[16];
+  size_t size;
+
+  while ((size = fread(chunk, 1, sizeof(chunk), file)) != 0) {
+    if (!KV_Feed(&ctx, chunk, size)) break;
+  }
+
+  fclose(file);
+
+  // Construct the list out of everything that's been fed so far
+  KV_Pair *list = KV_Finish(&ctx);
+
+  if (!list) {
+    fprintf(stderr, "%s\n", KV_GetError());
+    return 1;
+  }
+
+  char *str = KV_Print(list, NULL, 1024, "  ");
+  printf("%s", str);
+
+  free(str);
+  KV_PairDestroy(list);
+
+  // Tokens, comments and keys may be split between chunks at any character
+  printf("-- Split tokens:\n");
+
+  list = FeedString("\"key\" /* comment */ \"value\" // comment\n list { \"subkey\" \"subvalue\" }", 1);
+
+  str = KV_Print(list, NULL, 1024, "  ");
+  printf("%s", str);
+
+  free(str);
+  KV_PairDestroy(list);
+
+  // Errors point at the line within the entire stream
+  printf("-- Errors:\n");
+
+  list = FeedString("\"key\" \"value\"\n\n\"unclosed string\n", 4);
+  if (!list) printf("%s\n", KV_GetError());
+
+  return 0;
+};
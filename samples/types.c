@@ -0,0 +1,99 @@
+/* This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+
+Copyright (c) 2025 Dreamy Cecil
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (https://unlicense.org)
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute
+this software, either in source code form or as a compiled binary, for any
+purpose, commercial or non-commercial, and by any means.
+
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdio.h>
+#include "../keyvalues.h"
+
+int main(int argc, char *argv[]) {
+  printf("---------------- TYPES ----------------\n");
+
+  const char *example =
+    "player\n"
+    "{\n"
+    "  health  100\n"
+    "  speed   \"2.5\"\n"
+    "  steamid 0x0110000100000001\n"
+    "  tint    \"255 128 0\"\n"
+    "  name    Gordon\n"
+    "}";
+
+  // Store numbers as integers, floats and 64-bit integers instead of strings
+  KV_Context ctx;
+  KV_ContextSetupBuffer(&ctx, "", example, -1);
+  KV_ContextSetTypes(&ctx, KV_true);
+
+  KV_Pair *list = KV_Parse(&ctx);
+
+  if (!list) {
+    fprintf(stderr, "%s\n", KV_GetError());
+    return 1;
+  }
+
+  KV_Pair *player = KV_FindPair(list, "player");
+
+  // Read typed values directly without converting them from strings
+  printf("health = %d (type %d)\n", KV_FindInt(player, "health", 0), KV_GetDataType(KV_FindPair(player, "health")));
+  printf("speed = %g\n", KV_FindFloat(player, "speed", 1.0f));
+
+  // Colors aren't inferred but can still be read from strings
+  KV_Color white = { 255, 255, 255, 255 };
+  KV_Color tint = KV_FindColor(player, "tint", white);
+  printf("tint = %d %d %d %d\n", tint.r, tint.g, tint.b, tint.a);
+
+  // Non-numeric strings fall back to the default value
+  printf("name as a number = %d\n", KV_FindInt(player, "name", -1));
+
+  // Change some values and print them back, which keeps them readable as the same types
+  KV_SetFloat(KV_FindPair(player, "speed"), 0.1f);
+  KV_SetUint64(KV_FindPair(player, "steamid"), KV_FindUint64(player, "steamid", 0) + 1);
+
+  char *str = KV_Print(list, NULL, 256, "  ");
+  printf("%s", str);
+  free(str);
+
+  KV_PairDestroy(list);
+  return 0;
+};
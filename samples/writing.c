@@ -74,6 +74,13 @@ int main(int argc, char *argv[]) {
   // Save list into a file
   KV_Save(list, "out.txt");
 
+  // Stream the list straight into the standard output with different indentation
+  KV_Sink sink;
+  KV_SinkSetupFile(&sink, stdout);
+
+  printf("\n-- Writing the same list into the standard output:\n");
+  KV_PrintToSink(list, &sink, "  ");
+
   // Destroy created list
   KV_PairDestroy(list);
 